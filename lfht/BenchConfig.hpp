@@ -0,0 +1,568 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "Topology.hpp"
+#include "Workload.hpp"
+
+// Settings for a headless benchmark run.
+struct BenchConfig
+{
+	int threads = 4;
+	double durationSec = 5.0;
+	uint64_t keyRange = 1 << 16;
+	WorkloadSpec workload;
+	uint64_t seed = 1;
+	std::vector<std::string> engines{ "lockfree" };
+	size_t segments = 64;
+	bool recordLatency = true;
+	double targetRate = 0.0;  // total ops/sec for open-loop load, 0 = closed loop
+	std::vector<int> pinCpus; // worker t runs on pinCpus[t % size], empty = not pinned
+	std::string placement = "none";  // policy pinCpus is built from, see PLACEMENT_NAMES
+	bool perf = false;        // collect hardware counters with perf_event_open
+	std::string chromeTracePath;  // write the table's event trace here at the end
+	bool publish = false;     // live metrics in shared memory for lfht --attach
+
+	// Sweep mode
+	bool sweep = false;
+	int maxThreads = 0;       // 0 = all CPUs
+	int reps = 3;
+	std::vector<std::string> layouts;  // placements, empty = "cores", plus "smt" when the machine has SMT
+	bool pin = true;
+	std::string csvPath;
+	std::string jsonPath;
+
+	// Regression gate
+	std::string comparePath;
+	std::string saveBaselinePath;
+	double throughputThreshold = 5.0;  // percent
+	double latencyThreshold = 10.0;    // percent
+	bool repsSet = false;
+
+	// Micro benchmarks
+	bool micro = false;
+	std::string microFilter;
+
+	// Soak mode
+	double soakSec = 0.0;        // 0 = off
+	double soakPhaseSec = 60.0;  // length of each phase of the soak cycle
+
+	// Preemption scenarios
+	std::vector<int> oversubFactors;   // threads per CPU, empty = off
+	std::vector<std::string> delayPoints;
+	double delayProbability = 0.001;   // per pass through a delay point
+	double delayMicros = 50.0;
+
+	// Trace capture and replay
+	std::string recordPath;
+	std::string replayPath;
+	bool replayFast = false;
+
+	// Scenario file
+	std::string scenarioPath;
+
+	// Hash quality report
+	bool hashReport = false;
+	std::string hashKeysPath;                // key sample file, empty = generate
+	uint64_t hashStride = 0;                 // generate keys i * stride, 0 = use the workload
+	uint64_t hashSample = 0;                 // generated keys, 0 = --keys
+	std::vector<std::string> hashPolicies;   // empty = all
+};
+
+// @brief Print the command line usage of lfht_bench.
+// @param exe The name of the executable.
+inline void PrintBenchUsage(const char* exe)
+{
+	std::printf(
+		"Usage: %s [options]\n"
+		"  --threads N        Worker threads (default 4)\n"
+		"  --duration SEC     Measured run time in seconds (default 5)\n"
+		"  --keys N           Key range [0, N) (default 65536)\n"
+		"  --mix R:I:D[:U[:M]] Percent of contains/insert/remove/update/read-modify-write\n"
+		"                     ops (default 50:25:25). Update is remove + insert.\n"
+		"  --ycsb A-F         YCSB core workload preset (zipfian, full prefill).\n"
+		"                     Give it before other options to override parts of it\n"
+		"  --dist NAME        Key distribution: uniform, zipfian, hotspot, sequential,\n"
+		"                     latest (default uniform)\n"
+		"  --theta X          Zipfian skew, 0 < X < 1 (default 0.99)\n"
+		"  --hot K:O          Hotspot: fraction K of keys gets fraction O of ops (default 0.2:0.8)\n"
+		"  --prefill X        Fraction of the key range inserted before measuring (default 0.5)\n"
+		"  --key-offset N     Add N to every generated key, to move the key space\n"
+		"  --seed N           Base seed for the per-thread generators (default 1)\n"
+		"  --engine LIST      Comma separated engines, or 'all' (default lockfree)\n"
+		"                     lockfree, visual, mutex, shared_mutex, striped\n"
+		"  --segments N       Lock segments of the striped engine (default 64)\n"
+		"  --rate N           Open loop: issue N ops/sec in total on a fixed schedule and\n"
+		"                     measure latency from the intended start (default closed loop)\n"
+		"  --no-latency       Do not time individual ops (closed loop only)\n"
+		"  --placement NAME   Pin workers: none, compact (fill a socket's CPUs in order),\n"
+		"                     scatter (one per core, alternating sockets), cores (one per\n"
+		"                     physical core first), smt (SMT siblings together). Default none\n"
+		"  --perf             Count cycles, instructions, cache, TLB and branch misses\n"
+		"                     per op for the prefill and run phases (Linux only)\n"
+		"  --chrome-trace F   Write the table's resize, scan and retry events of the run as\n"
+		"                     Chrome trace JSON (chrome://tracing, Perfetto).\n"
+		"                     Needs the lfht_bench_stats build\n"
+		"  --publish          Publish live table metrics to the shared memory segment\n"
+		"                     /lfht.PID (Local\\lfht.PID on Windows) every 100 ms, for\n"
+		"                     the visualizer's --attach PID\n"
+		"  --sweep            Run 1, 2, 4, ... max threads for every engine and layout\n"
+		"  --max-threads N    Largest thread count of the sweep (default: all CPUs)\n"
+		"  --reps N           Repetitions per sweep point (default 3)\n"
+		"  --layouts LIST     Sweep thread placements, as for --placement\n"
+		"  --no-pin           Do not pin sweep threads to CPUs\n"
+		"  --csv FILE         Write sweep results as CSV\n"
+		"  --json FILE        Write sweep results as JSON\n"
+		"  --save-baseline F  Run the standard workload set and store it as a baseline\n"
+		"  --compare F        Run the standard workload set and compare against baseline F.\n"
+		"                     Exits with status 2 on a significant regression\n"
+		"  --threshold PCT    Allowed throughput drop for --compare (default 5)\n"
+		"  --latency-threshold PCT  Allowed p99 increase for --compare (default 10)\n"
+		"  --micro            Time the table's primitives (MarkedPtr, hash, find_bucket,\n"
+		"                     retire, scan, rehash) instead of running a workload\n"
+		"  --micro-filter S   Only run the micro benchmarks whose name contains S\n"
+		"  --soak SEC         Run the lockfree table for SEC seconds, cycling through mixed,\n"
+		"                     grow and shrink phases, and sample RSS, retired nodes, hazard\n"
+		"                     records, live nodes and buckets every second. Exits with\n"
+		"                     status 2 if any of them keeps growing. --csv stores the samples\n"
+		"  --soak-phase SEC   Length of each soak phase (default 60)\n"
+		"  --oversub LIST     Run 'threads = CPUs x factor' for each factor (e.g. 2,4,8),\n"
+		"                     unpinned, next to the mutex baseline\n"
+		"  --delay LIST       Sleep at these table points to mimic preemption: insert\n"
+		"                     (before the link CAS), remove (between mark and unlink),\n"
+		"                     resize (halfway through moving the buckets) or all.\n"
+		"                     Needs the lfht_bench_faults build\n"
+		"  --delay-prob P     Chance of a delay per pass through a point (default 0.001)\n"
+		"  --delay-us N       Length of an injected delay in microseconds (default 50)\n"
+		"  --record FILE      Record every operation of the run (one engine) to a trace\n"
+		"  --replay FILE      Replay a recorded trace on --threads threads, keeping the\n"
+		"                     recorded timing, against each engine\n"
+		"  --replay-fast      Replay as fast as possible instead\n"
+		"  --scenario FILE    Run the phases of an INI scenario file back to back on one\n"
+		"                     table per engine and report each phase (see scenarios/)\n"
+		"  --hash-report      Report chain lengths and probe counts of hash policies for\n"
+		"                     every bucket count the table resizes through, then exit\n"
+		"  --hash LIST        Policies to report: identity, multiply-shift, mix64, murmur3\n"
+		"  --hash-keys FILE   Key sample, one integer per line (default: generated)\n"
+		"  --hash-stride N    Generate keys 0, N, 2N, ... instead of using --dist\n"
+		"  --hash-sample N    Number of generated keys (default --keys)\n"
+		"  --help             Show this message\n",
+		exe);
+}
+
+// @brief Split a comma separated list.
+// @param text The text to split.
+// @return The non-empty items of the list.
+inline std::vector<std::string> SplitList(const std::string& text)
+{
+	std::vector<std::string> items;
+	size_t start = 0;
+	while (start <= text.size())
+	{
+		size_t end = text.find(',', start);
+		if (end == std::string::npos)
+			end = text.size();
+		if (end > start)
+			items.push_back(text.substr(start, end - start));
+		start = end + 1;
+	}
+	return items;
+}
+
+// @brief Parse an op mix of the form "R:I:D[:U[:M]]".
+// @param text The text to parse.
+// @param spec The workload to store the percentages in.
+// @return True if the mix was valid and adds up to 100.
+inline bool ParseOpMix(const std::string& text, WorkloadSpec& spec)
+{
+	int r = 0, i = 0, d = 0, u = 0, m = 0;
+	int n = std::sscanf(text.c_str(), "%d:%d:%d:%d:%d", &r, &i, &d, &u, &m);
+	if (n < 3)
+		return false;
+	if (r < 0 || i < 0 || d < 0 || u < 0 || m < 0 || r + i + d + u + m != 100)
+		return false;
+	spec.readPct = r;
+	spec.insertPct = i;
+	spec.removePct = d;
+	spec.updatePct = u;
+	spec.rmwPct = m;
+	return true;
+}
+
+// @brief Parse the lfht_bench command line.
+// @param argc Argument count.
+// @param argv Argument values.
+// @param config The config to fill in.
+// @param error Set to a description of the problem when parsing fails.
+// @return True if the command line was valid.
+inline bool ParseBenchArgs(int argc, char** argv, BenchConfig& config, std::string& error)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		auto next = [&](const char*& out) -> bool
+		{
+			if (i + 1 >= argc)
+			{
+				error = "missing value for " + arg;
+				return false;
+			}
+			out = argv[++i];
+			return true;
+		};
+
+		const char* value = nullptr;
+		if (arg == "--help" || arg == "-h")
+		{
+			error.clear();
+			return false;
+		}
+		else if (arg == "--threads")
+		{
+			if (!next(value)) return false;
+			config.threads = std::atoi(value);
+		}
+		else if (arg == "--duration")
+		{
+			if (!next(value)) return false;
+			config.durationSec = std::atof(value);
+		}
+		else if (arg == "--keys")
+		{
+			if (!next(value)) return false;
+			config.keyRange = std::strtoull(value, nullptr, 10);
+		}
+		else if (arg == "--mix")
+		{
+			if (!next(value)) return false;
+			if (!ParseOpMix(value, config.workload))
+			{
+				error = "invalid --mix '" + std::string(value) + "', expected R:I:D[:U[:M]] adding up to 100";
+				return false;
+			}
+		}
+		else if (arg == "--ycsb")
+		{
+			if (!next(value)) return false;
+			if (!ApplyYcsbPreset(value, config.workload))
+			{
+				error = "unknown YCSB workload '" + std::string(value) + "', expected A-F";
+				return false;
+			}
+		}
+		else if (arg == "--dist")
+		{
+			if (!next(value)) return false;
+			if (!ParseKeyDist(value, config.workload.dist))
+			{
+				error = "unknown key distribution '" + std::string(value) + "'";
+				return false;
+			}
+		}
+		else if (arg == "--theta")
+		{
+			if (!next(value)) return false;
+			config.workload.zipfTheta = std::atof(value);
+		}
+		else if (arg == "--hot")
+		{
+			if (!next(value)) return false;
+			if (std::sscanf(value, "%lf:%lf", &config.workload.hotKeyFraction, &config.workload.hotOpFraction) != 2)
+			{
+				error = "invalid --hot '" + std::string(value) + "', expected K:O";
+				return false;
+			}
+		}
+		else if (arg == "--prefill")
+		{
+			if (!next(value)) return false;
+			config.workload.prefill = std::atof(value);
+		}
+		else if (arg == "--key-offset")
+		{
+			if (!next(value)) return false;
+			config.workload.keyOffset = std::strtoull(value, nullptr, 10);
+		}
+		else if (arg == "--scenario")
+		{
+			if (!next(value)) return false;
+			config.scenarioPath = value;
+		}
+		else if (arg == "--seed")
+		{
+			if (!next(value)) return false;
+			config.seed = std::strtoull(value, nullptr, 10);
+		}
+		else if (arg == "--engine")
+		{
+			if (!next(value)) return false;
+			config.engines = SplitList(value);
+		}
+		else if (arg == "--rate")
+		{
+			if (!next(value)) return false;
+			config.targetRate = std::atof(value);
+		}
+		else if (arg == "--no-latency")
+		{
+			config.recordLatency = false;
+		}
+		else if (arg == "--perf")
+		{
+			config.perf = true;
+		}
+		else if (arg == "--sweep")
+		{
+			config.sweep = true;
+		}
+		else if (arg == "--max-threads")
+		{
+			if (!next(value)) return false;
+			config.maxThreads = std::atoi(value);
+		}
+		else if (arg == "--reps")
+		{
+			if (!next(value)) return false;
+			config.reps = std::atoi(value);
+			config.repsSet = true;
+		}
+		else if (arg == "--compare")
+		{
+			if (!next(value)) return false;
+			config.comparePath = value;
+		}
+		else if (arg == "--save-baseline")
+		{
+			if (!next(value)) return false;
+			config.saveBaselinePath = value;
+		}
+		else if (arg == "--threshold")
+		{
+			if (!next(value)) return false;
+			config.throughputThreshold = std::atof(value);
+		}
+		else if (arg == "--latency-threshold")
+		{
+			if (!next(value)) return false;
+			config.latencyThreshold = std::atof(value);
+		}
+		else if (arg == "--chrome-trace")
+		{
+			if (!next(value)) return false;
+			config.chromeTracePath = value;
+		}
+		else if (arg == "--publish")
+		{
+			config.publish = true;
+		}
+		else if (arg == "--placement")
+		{
+			if (!next(value)) return false;
+			config.placement = value;
+		}
+		else if (arg == "--layouts")
+		{
+			if (!next(value)) return false;
+			config.layouts = SplitList(value);
+		}
+		else if (arg == "--no-pin")
+		{
+			config.pin = false;
+		}
+		else if (arg == "--csv")
+		{
+			if (!next(value)) return false;
+			config.csvPath = value;
+		}
+		else if (arg == "--json")
+		{
+			if (!next(value)) return false;
+			config.jsonPath = value;
+		}
+		else if (arg == "--micro")
+		{
+			config.micro = true;
+		}
+		else if (arg == "--micro-filter")
+		{
+			if (!next(value)) return false;
+			config.micro = true;
+			config.microFilter = value;
+		}
+		else if (arg == "--soak")
+		{
+			if (!next(value)) return false;
+			config.soakSec = std::atof(value);
+		}
+		else if (arg == "--soak-phase")
+		{
+			if (!next(value)) return false;
+			config.soakPhaseSec = std::atof(value);
+		}
+		else if (arg == "--oversub")
+		{
+			if (!next(value)) return false;
+			config.oversubFactors.clear();
+			for (const auto& item : SplitList(value))
+				config.oversubFactors.push_back(std::atoi(item.c_str()));
+		}
+		else if (arg == "--delay")
+		{
+			if (!next(value)) return false;
+			config.delayPoints = SplitList(value);
+		}
+		else if (arg == "--delay-prob")
+		{
+			if (!next(value)) return false;
+			config.delayProbability = std::atof(value);
+		}
+		else if (arg == "--delay-us")
+		{
+			if (!next(value)) return false;
+			config.delayMicros = std::atof(value);
+		}
+		else if (arg == "--record")
+		{
+			if (!next(value)) return false;
+			config.recordPath = value;
+		}
+		else if (arg == "--replay")
+		{
+			if (!next(value)) return false;
+			config.replayPath = value;
+		}
+		else if (arg == "--replay-fast")
+		{
+			config.replayFast = true;
+		}
+		else if (arg == "--hash-report")
+		{
+			config.hashReport = true;
+		}
+		else if (arg == "--hash")
+		{
+			if (!next(value)) return false;
+			config.hashReport = true;
+			config.hashPolicies = SplitList(value);
+		}
+		else if (arg == "--hash-keys")
+		{
+			if (!next(value)) return false;
+			config.hashReport = true;
+			config.hashKeysPath = value;
+		}
+		else if (arg == "--hash-stride")
+		{
+			if (!next(value)) return false;
+			config.hashReport = true;
+			config.hashStride = std::strtoull(value, nullptr, 10);
+		}
+		else if (arg == "--hash-sample")
+		{
+			if (!next(value)) return false;
+			config.hashReport = true;
+			config.hashSample = std::strtoull(value, nullptr, 10);
+		}
+		else if (arg == "--segments")
+		{
+			if (!next(value)) return false;
+			config.segments = std::strtoull(value, nullptr, 10);
+		}
+		else
+		{
+			error = "unknown option " + arg;
+			return false;
+		}
+	}
+
+	if (config.threads < 1)
+	{
+		error = "--threads must be at least 1";
+		return false;
+	}
+	if (config.durationSec <= 0.0)
+	{
+		error = "--duration must be positive";
+		return false;
+	}
+	if (config.keyRange < 1)
+	{
+		error = "--keys must be at least 1";
+		return false;
+	}
+	if (config.workload.zipfTheta <= 0.0 || config.workload.zipfTheta >= 1.0)
+	{
+		error = "--theta must be between 0 and 1";
+		return false;
+	}
+	if (config.workload.hotKeyFraction <= 0.0 || config.workload.hotKeyFraction > 1.0 ||
+		config.workload.hotOpFraction < 0.0 || config.workload.hotOpFraction > 1.0)
+	{
+		error = "--hot fractions must be between 0 and 1";
+		return false;
+	}
+	if (config.workload.prefill < 0.0 || config.workload.prefill > 1.0)
+	{
+		error = "--prefill must be between 0 and 1";
+		return false;
+	}
+	if (config.targetRate < 0.0)
+	{
+		error = "--rate must not be negative";
+		return false;
+	}
+	if (config.reps < 1)
+	{
+		error = "--reps must be at least 1";
+		return false;
+	}
+	for (const auto& layout : config.layouts)
+	{
+		if (!IsPlacementName(layout) || layout == "none")
+		{
+			error = "unknown layout '" + layout + "'";
+			return false;
+		}
+	}
+	if (!IsPlacementName(config.placement))
+	{
+		error = "unknown placement '" + config.placement + "'";
+		return false;
+	}
+	if (config.soakSec < 0.0 || config.soakPhaseSec <= 0.0)
+	{
+		error = "--soak must not be negative and --soak-phase must be positive";
+		return false;
+	}
+	for (int factor : config.oversubFactors)
+	{
+		if (factor < 1)
+		{
+			error = "--oversub factors must be at least 1";
+			return false;
+		}
+	}
+	if (config.delayProbability < 0.0 || config.delayProbability > 1.0 || config.delayMicros < 0.0)
+	{
+		error = "--delay-prob must be between 0 and 1 and --delay-us must not be negative";
+		return false;
+	}
+	if (config.segments < 1)
+	{
+		error = "--segments must be at least 1";
+		return false;
+	}
+	if (config.engines.empty())
+	{
+		error = "--engine needs at least one engine";
+		return false;
+	}
+	if (!config.recordPath.empty() && (config.engines.size() != 1 || config.engines[0] == "all"))
+	{
+		error = "--record needs exactly one engine";
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,495 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include "BenchConfig.hpp"
+#include "LatencyHistogram.hpp"
+#include "LockFreeHashTable.hpp"
+#include "MetricsSegment.hpp"
+#include "PerfCounters.hpp"
+#include "SystemStats.hpp"
+#include "Topology.hpp"
+#include "Workload.hpp"
+
+constexpr int OP_TYPE_COUNT = 5;
+
+// Latency is kept apart per op type, lookups are split by outcome
+enum class LatencyType
+{
+	Insert,
+	Remove,
+	ContainsHit,
+	ContainsMiss,
+	Update,
+	ReadModifyWrite
+};
+
+constexpr int LATENCY_TYPE_COUNT = 6;
+static const char* LATENCY_TYPE_NAMES[LATENCY_TYPE_COUNT] = { "insert", "remove", "contains hit", "contains miss", "update", "rmw" };
+
+// @brief Latency bucket of a finished operation.
+inline LatencyType LatencyTypeOf(OpType op, bool ok)
+{
+	switch (op)
+	{
+	case OpType::Read: return ok ? LatencyType::ContainsHit : LatencyType::ContainsMiss;
+	case OpType::Insert: return LatencyType::Insert;
+	case OpType::Remove: return LatencyType::Remove;
+	case OpType::Update: return LatencyType::Update;
+	default: return LatencyType::ReadModifyWrite;
+	}
+}
+
+// Per-thread results, padded so that workers never share a cache line.
+struct alignas(64) WorkerResult
+{
+	uint64_t ops = 0;
+	uint64_t opCounts[OP_TYPE_COUNT] = {};
+	uint64_t succeeded = 0;
+	uint64_t late = 0;
+	int64_t sizeDelta = 0;     // successful inserts minus successful removes
+	double elapsedSec = 0.0;
+	bool pinned = false;
+	LatencyHistogram latency[LATENCY_TYPE_COUNT];
+	PerfCounts perf;
+};
+
+// Aggregated results of one benchmark run.
+struct BenchResult
+{
+	uint64_t ops = 0;
+	uint64_t opCounts[OP_TYPE_COUNT] = {};
+	uint64_t succeeded = 0;
+	uint64_t late = 0;          // open loop: ops scheduled before the end but never issued
+	double prefillSec = 0.0;
+	double elapsedSec = 0.0;
+	double opsPerSec = 0.0;
+	double nsPerOp = 0.0;
+	size_t resizes = 0;        // during the measured phase
+	size_t retiredPeak = 0;    // highest retired-but-unfreed node count seen
+	uint64_t rssBytes = 0;     // at the end of the run
+	int pinned = 0;            // workers that were pinned to their CPU
+	LatencyHistogram latency[LATENCY_TYPE_COUNT];
+	uint64_t prefillOps = 0;
+	PerfCounts prefillPerf;    // hardware counters, only with config.perf
+	PerfCounts runPerf;
+	TableStats tableStats;     // of the measured phase, only in a build with LFHT_ENABLE_STATS
+	MemoryUsage memory;        // at the end of the run, engines other than lockfree report 0
+	HotSpots<uint64_t> hotSpots;  // since the table was created, only with LFHT_ENABLE_STATS
+	int64_t sizeDelta = 0;     // entries the measured phase added, from the results of its operations
+	uint64_t expectedSize = 0; // RunBenchmark: successful prefill inserts + sizeDelta
+	uint64_t finalSize = 0;    // RunBenchmark: entries the table reports at the end
+
+	// @brief All latency types merged into one histogram.
+	LatencyHistogram AllLatency() const
+	{
+		LatencyHistogram all;
+		for (const auto& h : latency)
+			all.Merge(h);
+		return all;
+	}
+};
+
+// Table internals sampled by the driver. Engines without them report 0,
+// except Size, which every engine has.
+template <typename Table>
+struct TableProbe
+{
+	static size_t Size(Table& table) { return table.size(); }
+	static size_t Resizes(Table&) { return 0; }
+	static size_t Retired(Table&) { return 0; }
+	static size_t HazardRecords(Table&) { return 0; }
+	static size_t Live(Table&) { return 0; }
+	static size_t Buckets(Table&) { return 0; }
+	static TableStats Stats(Table&) { return TableStats(); }
+	static MemoryUsage Memory(Table&) { return MemoryUsage(); }
+	static HotSpots<uint64_t> Hot(Table&) { return HotSpots<uint64_t>(); }
+	static std::vector<size_t> ChainLengths(Table&, size_t) { return {}; }
+};
+
+template <typename K, typename V, typename H>
+struct TableProbe<LockFreeHashTable<K, V, H>>
+{
+	using Table = LockFreeHashTable<K, V, H>;
+	static size_t Size(Table& table) { return table.getCount(); }
+	static size_t Resizes(Table& table) { return table.getResizeCount(); }
+	static size_t Retired(Table&) { return Table::getRetiredCount(); }
+	static size_t HazardRecords(Table&) { return Table::getHazardRecordCount(); }
+	static size_t Live(Table& table) { return table.getCount(); }
+	static size_t Buckets(Table& table) { return table.getBucketSize(); }
+	static TableStats Stats(Table& table) { return table.stats(); }
+	static MemoryUsage Memory(Table& table) { return table.memory_usage(); }
+	static HotSpots<K> Hot(Table& table) { return table.hot_spots(5); }
+	static std::vector<size_t> ChainLengths(Table& table, size_t maxLength) { return table.chain_length_histogram(maxLength); }
+};
+
+// @brief Issue one operation against a table.
+// @param table The table.
+// @param op The operation type.
+// @param key The key.
+// @param sizeDelta Incremented by each successful insert, decremented by each successful remove.
+// @return Whether the operation found/changed what it was after.
+template <typename Table>
+inline bool ExecuteOp(Table& table, OpType op, uint64_t key, int64_t& sizeDelta)
+{
+	bool inserted;
+	switch (op)
+	{
+	case OpType::Read:
+		return table.contains(key);
+	case OpType::Insert:
+		inserted = table.insert(key, key);
+		sizeDelta += inserted ? 1 : 0;
+		return inserted;
+	case OpType::Remove:
+		if (!table.remove(key))
+			return false;
+		sizeDelta--;
+		return true;
+	case OpType::Update:
+		sizeDelta -= table.remove(key) ? 1 : 0;
+		inserted = table.insert(key, key);
+		sizeDelta += inserted ? 1 : 0;
+		return inserted;
+	default:
+		if (!table.contains(key))
+			return false;
+		sizeDelta -= table.remove(key) ? 1 : 0;
+		inserted = table.insert(key, key);
+		sizeDelta += inserted ? 1 : 0;
+		return inserted;
+	}
+}
+
+// @brief Wait for a scheduled start time, sleeping while it is far away.
+// @param when The time to wait for.
+// @param stop Abort the wait when this becomes true.
+// @return False if the wait was aborted.
+inline bool WaitUntil(std::chrono::steady_clock::time_point when, const std::atomic<bool>& stop)
+{
+	while (true)
+	{
+		auto now = std::chrono::steady_clock::now();
+		if (now >= when)
+			return true;
+		if (stop.load(std::memory_order_relaxed))
+			return false;
+		if (when - now > std::chrono::microseconds(200))
+			std::this_thread::sleep_for(when - now - std::chrono::microseconds(100));
+		else
+			std::this_thread::yield();
+	}
+}
+
+// @brief Insert keys [0, PrefillCount()) shifted by the key offset, using all worker threads.
+// @param table The table to fill.
+// @param shared The workload the table is prepared for.
+// @param threads Number of threads to fill with.
+// @param perf If set, receives the hardware counters of all filling threads.
+// @param inserted If set, receives the number of inserts that succeeded.
+// @return Time spent in seconds.
+template <typename Table>
+double Prefill(Table& table, const WorkloadShared& shared, int threads, PerfCounts* perf = nullptr, uint64_t* inserted = nullptr)
+{
+	const uint64_t count = shared.PrefillCount();
+	std::vector<PerfCounts> counts(threads);
+	std::atomic<uint64_t> succeeded{ 0 };
+	auto begin = std::chrono::steady_clock::now();
+	std::vector<std::thread> fillers;
+	for (int t = 0; t < threads; ++t)
+	{
+		fillers.emplace_back([&, t]()
+		{
+			PerfCounterSet counters;
+			if (perf && counters.Open())
+				counters.Start();
+
+			// Interleaved so all threads grow the table together. The offset
+			// puts the prefill where the generator's keys are.
+			uint64_t mine = 0;
+			for (uint64_t i = t; i < count; i += threads)
+			{
+				const uint64_t key = shared.spec.keyOffset + i;
+				mine += table.insert(key, key) ? 1 : 0;
+			}
+			succeeded.fetch_add(mine, std::memory_order_relaxed);
+
+			if (perf)
+			{
+				counters.Stop();
+				counts[t] = counters.Read();
+			}
+		});
+	}
+	for (auto& f : fillers)
+		f.join();
+	if (perf)
+	{
+		for (const auto& c : counts)
+			perf->Merge(c);
+	}
+	if (inserted)
+		*inserted = succeeded.load();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+// Feeds MetricsPublisher::Process() from the driver's sampling loop: the
+// workers only bump their LiveOpMetrics, the table is read by this thread.
+template <typename Table>
+class MetricsFeed
+{
+public:
+	static constexpr int PUBLISH_MS = 100;
+	static constexpr int CHAIN_WALK_MS = 1000;  // the walk visits every bucket, keep it rare
+
+	MetricsFeed(Table& table, const BenchConfig& config, const std::vector<LiveOpMetrics>& live) :
+		m_table(table), m_live(live), m_lastOps(0)
+	{
+		const WorkloadSpec& w = config.workload;
+		std::snprintf(m_frame.label, sizeof(m_frame.label), "threads=%d mix=%d:%d:%d:%d:%d dist=%s keys=%llu",
+			config.threads, w.readPct, w.insertPct, w.removePct, w.updatePct, w.rmwPct, KeyDistName(w.dist),
+			(unsigned long long)config.keyRange);
+		std::fill(&m_lastLatency[0][0], &m_lastLatency[0][0] + METRICS_LATENCY_TYPES * METRICS_LATENCY_BINS, 0);
+		m_lastPublish = m_lastWalk = std::chrono::steady_clock::time_point();
+	}
+
+	// @brief Publish a frame if PUBLISH_MS passed since the last one.
+	void Sample(std::chrono::steady_clock::time_point now)
+	{
+		using std::chrono::milliseconds;
+		if (now - m_lastPublish < milliseconds(PUBLISH_MS))
+			return;
+		const bool first = m_lastPublish == std::chrono::steady_clock::time_point();
+		m_frame.intervalSec = first ? 0.0 : std::chrono::duration<double>(now - m_lastPublish).count();
+		m_lastPublish = now;
+		m_frame.timeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+
+		uint64_t ops = 0;
+		for (int type = 0; type < METRICS_LATENCY_TYPES; ++type)
+		{
+			for (int bin = 0; bin < METRICS_LATENCY_BINS; ++bin)
+			{
+				uint64_t sum = 0;
+				for (const auto& l : m_live)
+					sum += l.latency[type][bin].load(std::memory_order_relaxed);
+				m_frame.latency[type][bin] = sum - m_lastLatency[type][bin];
+				m_lastLatency[type][bin] = sum;
+			}
+		}
+		for (const auto& l : m_live)
+			ops += l.ops.load(std::memory_order_relaxed);
+		m_frame.ops = ops;
+		m_frame.opsPerSec = m_frame.intervalSec > 0.0 ? (ops - m_lastOps) / m_frame.intervalSec : 0.0;
+		m_lastOps = ops;
+
+		m_frame.live = TableProbe<Table>::Live(m_table);
+		m_frame.buckets = TableProbe<Table>::Buckets(m_table);
+		m_frame.loadFactor = m_frame.buckets ? static_cast<double>(m_frame.live) / m_frame.buckets : 0.0;
+		m_frame.resizes = TableProbe<Table>::Resizes(m_table);
+		m_frame.retired = TableProbe<Table>::Retired(m_table);
+		m_frame.hazardRecords = TableProbe<Table>::HazardRecords(m_table);
+		m_frame.memoryBytes = TableProbe<Table>::Memory(m_table).total();
+		const TableStats stats = TableProbe<Table>::Stats(m_table);
+		m_frame.statsEnabled = stats.enabled ? 1 : 0;
+		std::copy(std::begin(stats.values), std::end(stats.values), m_frame.stats);
+
+		if (now - m_lastWalk >= milliseconds(CHAIN_WALK_MS))
+		{
+			m_lastWalk = now;
+			std::vector<size_t> chains = TableProbe<Table>::ChainLengths(m_table, METRICS_CHAIN_BINS - 1);
+			std::fill(std::begin(m_frame.chainBins), std::end(m_frame.chainBins), 0);
+			std::copy(chains.begin(), chains.end(), m_frame.chainBins);
+		}
+		MetricsPublisher::Process().Publish(m_frame);
+	}
+
+private:
+	Table& m_table;
+	const std::vector<LiveOpMetrics>& m_live;
+	MetricsFrame m_frame;
+	uint64_t m_lastOps;
+	uint64_t m_lastLatency[METRICS_LATENCY_TYPES][METRICS_LATENCY_BINS];
+	std::chrono::steady_clock::time_point m_lastPublish;
+	std::chrono::steady_clock::time_point m_lastWalk;
+};
+
+// @brief Run the configured workload against a table as it is, without prefilling.
+// @param table Any table exposing insert(key, value), remove(key) and contains(key).
+// @param config The benchmark settings.
+// @param shared The state of config's workload, built once by the caller.
+// @return The aggregated results of all worker threads.
+template <typename Table>
+BenchResult RunPhase(Table& table, const BenchConfig& config, WorkloadShared& shared)
+{
+	BenchResult total;
+
+	std::vector<WorkerResult> results(config.threads);
+	// Only with --publish: per-thread counters the sampling loop publishes
+	const bool publishing = MetricsPublisher::Process().IsOpen();
+	std::vector<LiveOpMetrics> live(publishing ? config.threads : 0);
+	const std::vector<int> pinCpus = config.pinCpus.empty() ? PlacementOrder(DiscoverCpus(), config.placement) : config.pinCpus;
+	std::vector<std::thread> workers;
+	std::atomic<int> ready{ 0 };
+	std::atomic<bool> start{ false };
+	std::atomic<bool> stop{ false };
+
+	for (int t = 0; t < config.threads; ++t)
+	{
+		workers.emplace_back([&, t]()
+		{
+			using Clock = std::chrono::steady_clock;
+			WorkloadGenerator gen(shared, config.seed * 0x9E3779B97F4A7C15ULL + t, t, config.threads);
+			WorkerResult& local = results[t];
+			LiveOpMetrics* liveOps = publishing ? &live[t] : nullptr;
+
+			// Open loop: this thread issues one op every intervalNs, the threads'
+			// schedules are staggered so they do not all fire at once.
+			const bool openLoop = config.targetRate > 0.0;
+			const bool record = openLoop || config.recordLatency;
+			const double intervalNs = openLoop ? 1e9 * config.threads / config.targetRate : 0.0;
+			double scheduledNs = intervalNs * t / config.threads;
+
+			if (!pinCpus.empty())
+				local.pinned = PinCurrentThread(pinCpus[t % pinCpus.size()]);
+
+			PerfCounterSet counters;
+			const bool perf = config.perf && counters.Open();
+
+			ready.fetch_add(1);
+			while (!start.load(std::memory_order_acquire))
+				std::this_thread::yield();
+			if (perf)
+				counters.Start();
+
+			const Clock::time_point begin = Clock::now();
+			while (!stop.load(std::memory_order_relaxed))
+			{
+				OpType op = gen.NextOp();
+				uint64_t key = gen.NextKey(op);
+
+				Clock::time_point opStart;
+				if (openLoop)
+				{
+					// Latency counts from the intended start, so time spent
+					// behind schedule (e.g. a resize pause) is not hidden
+					opStart = begin + std::chrono::nanoseconds(static_cast<int64_t>(scheduledNs));
+					scheduledNs += intervalNs;
+					if (!WaitUntil(opStart, stop))
+						break;
+				}
+				else if (record)
+				{
+					opStart = Clock::now();
+				}
+
+				bool ok = ExecuteOp(table, op, key, local.sizeDelta);
+				if (record)
+				{
+					uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - opStart).count();
+					const int type = static_cast<int>(LatencyTypeOf(op, ok));
+					local.latency[type].Record(ns);
+					if (liveOps)
+						liveOps->Record(type, ns);
+				}
+				else if (liveOps)
+				{
+					liveOps->Count();
+				}
+				local.succeeded += ok ? 1 : 0;
+				local.opCounts[static_cast<int>(op)]++;
+				local.ops++;
+			}
+			const Clock::time_point end = Clock::now();
+			if (perf)
+			{
+				counters.Stop();
+				local.perf = counters.Read();
+			}
+			local.elapsedSec = std::chrono::duration<double>(end - begin).count();
+			if (openLoop)
+			{
+				double endNs = std::chrono::duration<double, std::nano>(end - begin).count();
+				if (endNs > scheduledNs)
+					local.late = static_cast<uint64_t>((endNs - scheduledNs) / intervalNs);
+			}
+		});
+	}
+
+	while (ready.load() < config.threads)
+		std::this_thread::yield();
+
+	const size_t resizesBefore = TableProbe<Table>::Resizes(table);
+	const TableStats statsBefore = TableProbe<Table>::Stats(table);
+	auto begin = std::chrono::steady_clock::now();
+	auto deadline = begin + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+		std::chrono::duration<double>(config.durationSec));
+	start.store(true, std::memory_order_release);
+
+	// Sample the table while the workers run
+	MetricsFeed<Table> feed(table, config, live);
+	while (true)
+	{
+		total.retiredPeak = std::max(total.retiredPeak, TableProbe<Table>::Retired(table));
+		auto now = std::chrono::steady_clock::now();
+		if (publishing)
+			feed.Sample(now);
+		if (now >= deadline)
+			break;
+		std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(deadline - now, std::chrono::milliseconds(10)));
+	}
+	stop.store(true, std::memory_order_relaxed);
+	for (auto& w : workers)
+		w.join();
+	auto end = std::chrono::steady_clock::now();
+
+	double threadSeconds = 0.0;
+	for (const auto& r : results)
+	{
+		total.ops += r.ops;
+		for (int i = 0; i < OP_TYPE_COUNT; ++i)
+			total.opCounts[i] += r.opCounts[i];
+		total.succeeded += r.succeeded;
+		total.late += r.late;
+		total.sizeDelta += r.sizeDelta;
+		total.pinned += r.pinned ? 1 : 0;
+		threadSeconds += r.elapsedSec;
+		for (int i = 0; i < LATENCY_TYPE_COUNT; ++i)
+			total.latency[i].Merge(r.latency[i]);
+		total.runPerf.Merge(r.perf);
+	}
+	total.elapsedSec = std::chrono::duration<double>(end - begin).count();
+	total.resizes = TableProbe<Table>::Resizes(table) - resizesBefore;
+	total.tableStats = TableProbe<Table>::Stats(table) - statsBefore;
+	total.rssBytes = ReadRssBytes();
+	total.memory = TableProbe<Table>::Memory(table);
+	total.hotSpots = TableProbe<Table>::Hot(table);
+	total.opsPerSec = total.elapsedSec > 0.0 ? total.ops / total.elapsedSec : 0.0;
+	// Average time one thread spends in one operation
+	total.nsPerOp = total.ops > 0 ? threadSeconds * 1e9 / total.ops : 0.0;
+	return total;
+}
+
+// @brief Prefill a table and run the configured workload against it.
+// @param table Any table exposing insert(key, value), remove(key) and contains(key).
+// @param config The benchmark settings.
+// @return The aggregated results of all worker threads.
+template <typename Table>
+BenchResult RunBenchmark(Table& table, const BenchConfig& config)
+{
+	WorkloadShared shared(config.workload, config.keyRange);
+	PerfCounts prefillPerf;
+	uint64_t prefilled = 0;
+	double prefillSec = Prefill(table, shared, config.threads, config.perf ? &prefillPerf : nullptr, &prefilled);
+
+	BenchResult total = RunPhase(table, config, shared);
+	total.prefillSec = prefillSec;
+	total.prefillOps = shared.PrefillCount();
+	total.prefillPerf = prefillPerf;
+	total.expectedSize = static_cast<uint64_t>(static_cast<int64_t>(prefilled) + total.sizeDelta);
+	total.finalSize = TableProbe<Table>::Size(table);
+	return total;
+}
@@ -0,0 +1,236 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "BenchConfig.hpp"
+#include "BenchDriver.hpp"
+#include "LockFreeHashTable.hpp"
+#include "VisualLockFreeHashTable.hpp"
+
+// Baseline tables for the benchmark, all exposing insert/remove/contains
+// with the same semantics as LockFreeHashTable.
+
+// std::unordered_map guarded by a single std::mutex.
+template <typename K, typename V>
+class MutexMap
+{
+public:
+	bool insert(K key, V value)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_map.emplace(key, value).second;
+	}
+
+	bool remove(K key)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_map.erase(key) > 0;
+	}
+
+	bool contains(K key)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_map.find(key) != m_map.end();
+	}
+
+	size_t size()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_map.size();
+	}
+
+private:
+	std::unordered_map<K, V> m_map;
+	std::mutex m_mutex;
+};
+
+// std::unordered_map guarded by a std::shared_mutex, lookups take it shared.
+template <typename K, typename V>
+class SharedMutexMap
+{
+public:
+	bool insert(K key, V value)
+	{
+		std::unique_lock<std::shared_mutex> lock(m_mutex);
+		return m_map.emplace(key, value).second;
+	}
+
+	bool remove(K key)
+	{
+		std::unique_lock<std::shared_mutex> lock(m_mutex);
+		return m_map.erase(key) > 0;
+	}
+
+	bool contains(K key)
+	{
+		std::shared_lock<std::shared_mutex> lock(m_mutex);
+		return m_map.find(key) != m_map.end();
+	}
+
+	size_t size()
+	{
+		std::shared_lock<std::shared_mutex> lock(m_mutex);
+		return m_map.size();
+	}
+
+private:
+	std::unordered_map<K, V> m_map;
+	std::shared_mutex m_mutex;
+};
+
+// Lock-striped map: the key space is split over N independently locked segments.
+template <typename K, typename V>
+class StripedMap
+{
+public:
+	StripedMap(size_t segments) : m_segments(segments > 0 ? segments : 1) {}
+
+	bool insert(K key, V value)
+	{
+		Segment& s = segmentFor(key);
+		std::lock_guard<std::mutex> lock(s.mutex);
+		return s.map.emplace(key, value).second;
+	}
+
+	bool remove(K key)
+	{
+		Segment& s = segmentFor(key);
+		std::lock_guard<std::mutex> lock(s.mutex);
+		return s.map.erase(key) > 0;
+	}
+
+	bool contains(K key)
+	{
+		Segment& s = segmentFor(key);
+		std::lock_guard<std::mutex> lock(s.mutex);
+		return s.map.find(key) != s.map.end();
+	}
+
+	size_t size()
+	{
+		size_t total = 0;
+		for (Segment& s : m_segments)
+		{
+			std::lock_guard<std::mutex> lock(s.mutex);
+			total += s.map.size();
+		}
+		return total;
+	}
+
+private:
+	// Padded so neighbouring segment locks do not share a cache line
+	struct alignas(64) Segment
+	{
+		std::mutex mutex;
+		std::unordered_map<K, V> map;
+	};
+	std::vector<Segment> m_segments;
+
+	Segment& segmentFor(K key)
+	{
+		return m_segments[std::hash<K>{}(key) % m_segments.size()];
+	}
+};
+
+// Adapter for VisualLockFreeHashTable, which uses the visualizer's method names.
+template <typename K, typename V>
+class VisualEngine
+{
+public:
+	bool insert(K key, V value) { return m_table.Insert(key, value); }
+	bool remove(K key) { return m_table.Remove(key); }
+	bool contains(K key) { return m_table.Contains(key); }
+	size_t size() { return m_table.GetCount(); }
+
+private:
+	VisualLockFreeHashTable<K, V> m_table;
+};
+
+// Names accepted by --engine, in the order "all" runs them.
+static const char* ENGINE_NAMES[] = { "lockfree", "visual", "mutex", "shared_mutex", "striped" };
+
+// @brief Check whether a name is one of ENGINE_NAMES.
+// @param name The engine name.
+// @return True if the engine exists.
+inline bool IsEngineName(const std::string& name)
+{
+	for (const char* e : ENGINE_NAMES)
+	{
+		if (name == e)
+			return true;
+	}
+	return false;
+}
+
+// @brief Construct an engine and hand it to a function.
+// @param name One of ENGINE_NAMES.
+// @param config Supplies the engine settings (segments).
+// @param fn Called with the new, empty table.
+// @return What fn returns.
+template <typename Fn>
+auto WithEngine(const std::string& name, const BenchConfig& config, Fn&& fn)
+{
+	using Key = uint64_t;
+	using Value = uint64_t;
+
+	if (name == "lockfree")
+	{
+		LockFreeHashTable<Key, Value> table;
+		return fn(table);
+	}
+	if (name == "visual")
+	{
+		VisualEngine<Key, Value> table;
+		return fn(table);
+	}
+	if (name == "mutex")
+	{
+		MutexMap<Key, Value> table;
+		return fn(table);
+	}
+	if (name == "shared_mutex")
+	{
+		SharedMutexMap<Key, Value> table;
+		return fn(table);
+	}
+	StripedMap<Key, Value> table(config.segments);
+	return fn(table);
+}
+
+// @brief Number of runs whose final size did not match, see CheckFinalSize.
+inline int& FailedRuns()
+{
+	static int failed = 0;
+	return failed;
+}
+
+// @brief Compare the entries an engine ended with to what the results of its
+// operations add up to. A mismatch means lost or duplicated entries; the run
+// is reported and counted in FailedRuns().
+// @param name The engine name.
+// @param result The results of a RunBenchmark run.
+// @return True if the sizes match.
+inline bool CheckFinalSize(const std::string& name, const BenchResult& result)
+{
+	if (result.finalSize == result.expectedSize)
+		return true;
+	std::fprintf(stderr, "error: %s ended with %llu entries, its operations add up to %llu\n",
+		name.c_str(), (unsigned long long)result.finalSize, (unsigned long long)result.expectedSize);
+	FailedRuns()++;
+	return false;
+}
+
+// @brief Run the configured workload on a freshly constructed engine.
+// @param name One of ENGINE_NAMES.
+// @param config The benchmark settings, identical for every engine.
+// @return The results of the run.
+inline BenchResult RunEngine(const std::string& name, const BenchConfig& config)
+{
+	BenchResult result = WithEngine(name, config, [&](auto& table) { return RunBenchmark(table, config); });
+	CheckFinalSize(name, result);
+	return result;
+}
@@ -0,0 +1,441 @@
+// BenchMain.cpp
+// Headless benchmark for LockFreeHashTable (lfht_bench). Needs no display or OpenGL.
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "BenchConfig.hpp"
+#include "BenchDriver.hpp"
+#include "BenchEngines.hpp"
+#include "ChromeTrace.hpp"
+#include "DelayInjection.hpp"
+#include "HashQuality.hpp"
+#include "LatencyHistogram.hpp"
+#include "MicroBench.hpp"
+#include "Oversubscription.hpp"
+#include "Regression.hpp"
+#include "Scenario.hpp"
+#include "Soak.hpp"
+#include "Sweep.hpp"
+#include "TraceReplay.hpp"
+
+// @brief Print one row of the latency table.
+static void PrintLatencyRow(const char* name, const LatencyHistogram& h)
+{
+	if (h.Count() == 0)
+		return;
+	std::printf("  %-14s %12llu %10.0f %10llu %10llu %10llu %10llu %12llu\n", name,
+		(unsigned long long)h.Count(), h.Mean(),
+		(unsigned long long)h.Percentile(50.0), (unsigned long long)h.Percentile(90.0),
+		(unsigned long long)h.Percentile(99.0), (unsigned long long)h.Percentile(99.9),
+		(unsigned long long)h.Max());
+}
+
+// @brief Print the per-op latency percentiles of a run, in nanoseconds.
+static void PrintLatency(const BenchResult& result)
+{
+	std::printf("  %-14s %12s %10s %10s %10s %10s %10s %12s\n",
+		"latency (ns)", "count", "mean", "p50", "p90", "p99", "p99.9", "max");
+	for (int i = 0; i < LATENCY_TYPE_COUNT; ++i)
+		PrintLatencyRow(LATENCY_TYPE_NAMES[i], result.latency[i]);
+	PrintLatencyRow("all", result.AllLatency());
+}
+
+// @brief Print the hardware counters of one phase, per operation.
+static void PrintPerfRow(const char* phase, const PerfCounts& perf, uint64_t ops)
+{
+	std::printf("  %-14s", phase);
+	for (int i = 0; i < PERF_EVENT_COUNT; ++i)
+	{
+		if (perf.Valid(static_cast<PerfEvent>(i)) && ops > 0)
+			std::printf(" %12.2f", perf.values[i] / ops);
+		else
+			std::printf(" %12s", "n/a");
+	}
+	if (perf.Valid(PerfEvent::Cycles) && perf.Valid(PerfEvent::Instructions) && perf.Value(PerfEvent::Cycles) > 0.0)
+		std::printf(" %6.2f", perf.Value(PerfEvent::Instructions) / perf.Value(PerfEvent::Cycles));
+	else
+		std::printf(" %6s", "n/a");
+	std::printf("\n");
+}
+
+// @brief Print the hardware counters of the prefill and measured phases.
+static void PrintPerf(const BenchResult& result)
+{
+	if (!result.prefillPerf.Any() && !result.runPerf.Any())
+	{
+		std::printf("  hardware counters unavailable (no PMU access, check /proc/sys/kernel/perf_event_paranoid)\n");
+		return;
+	}
+	std::printf("  %-14s", "per op");
+	for (int i = 0; i < PERF_EVENT_COUNT; ++i)
+		std::printf(" %12s", PERF_EVENT_NAMES[i]);
+	std::printf(" %6s\n", "IPC");
+	PrintPerfRow("prefill", result.prefillPerf, result.prefillOps);
+	PrintPerfRow("run", result.runPerf, result.ops);
+}
+
+// @brief Print where the table's memory goes, for engines that account for it.
+static void PrintMemory(const BenchResult& result)
+{
+	const MemoryUsage& m = result.memory;
+	if (m.total() == 0)
+		return;
+	const double kb = 1024.0;
+	std::printf("  memory KB: buckets=%.1f old arrays=%.1f live nodes=%.1f retired=%.1f hazard=%.1f "
+		"slack=%.1f total=%.1f (%.1f bytes/entry)\n",
+		m.bucket_array_bytes / kb, m.old_array_bytes / kb, m.live_node_bytes / kb, m.retired_node_bytes / kb,
+		m.hazard_record_bytes / kb, m.allocator_slack_bytes / kb,
+		m.total() / kb, m.bytes_per_entry());
+}
+
+// @brief Print the table's operation statistics of the measured phase.
+static void PrintTableStats(const BenchResult& result)
+{
+	const TableStats& s = result.tableStats;
+	if (!s.enabled)
+		return;
+	std::printf("  probe length mean=%.2f  hist", s.ratio(TableStat::FindNodes, TableStat::FindCalls));
+	static const char* bins[] = { "0", "1", "2-3", "4-7", "8-15", "16-31", "32+" };
+	for (int i = 0; i < 7; ++i)
+		std::printf(" %s:%llu", bins[i], (unsigned long long)s[static_cast<TableStat>(static_cast<int>(TableStat::Probe0) + i)]);
+	std::printf("\n  per 1000 finds: restarts=%.2f help unlinks=%.2f\n",
+		1000.0 * s.ratio(TableStat::FindRestarts, TableStat::FindCalls),
+		1000.0 * s.ratio(TableStat::HelpUnlinks, TableStat::FindCalls));
+	std::printf("  per 1000 inserts: stale=%.2f cas failures=%.2f   per 1000 removes: stale=%.2f cas failures=%.2f unlink failures=%.2f\n",
+		1000.0 * s.ratio(TableStat::InsertStale, TableStat::InsertCalls),
+		1000.0 * s.ratio(TableStat::InsertCasFailures, TableStat::InsertCalls),
+		1000.0 * s.ratio(TableStat::RemoveStale, TableStat::RemoveCalls),
+		1000.0 * s.ratio(TableStat::RemoveCasFailures, TableStat::RemoveCalls),
+		1000.0 * s.ratio(TableStat::UnlinkFailures, TableStat::RemoveCalls));
+	std::printf("  resizes triggered=%llu performed=%llu contended=%llu lost=%llu   scans=%llu freed=%llu kept=%llu\n",
+		(unsigned long long)s[TableStat::ResizeTriggered], (unsigned long long)s[TableStat::ResizePerformed],
+		(unsigned long long)s[TableStat::ResizeContended], (unsigned long long)s[TableStat::ResizeLost],
+		(unsigned long long)s[TableStat::Scans], (unsigned long long)s[TableStat::ScanFreed],
+		(unsigned long long)s[TableStat::ScanKept]);
+
+	const HotSpots<uint64_t>& hot = result.hotSpots;
+	if (!hot.keys.empty())
+	{
+		// The sketch's count only overestimates: the true count is in [count - error, count]
+		std::printf("  hot keys (1 in %u ops sampled, x at least..at most):", hot.sample_rate);
+		for (const auto& k : hot.keys)
+			std::printf(" %llu x%llu..%llu", (unsigned long long)k.item, (unsigned long long)(k.count - k.error),
+				(unsigned long long)k.count);
+		std::printf("\n");
+	}
+	if (!hot.buckets.empty())
+	{
+		std::printf("  hot buckets (failed CAS, x at least..at most):");
+		for (const auto& b : hot.buckets)
+			std::printf(" %zu/%zu x%llu..%llu", b.item.index, b.item.buckets, (unsigned long long)(b.count - b.error),
+				(unsigned long long)b.count);
+		std::printf("\n");
+	}
+}
+
+// @brief Print the settings a run was started with.
+// @param config The settings, after a scenario's [scenario] section was applied.
+static void PrintRunSettings(const BenchConfig& config)
+{
+	const WorkloadSpec& w = config.workload;
+	std::printf("threads=%d duration=%.1fs keys=%llu mix=%d:%d:%d:%d:%d dist=%s prefill=%.2f segments=%zu\n",
+		config.threads, config.durationSec, (unsigned long long)config.keyRange,
+		w.readPct, w.insertPct, w.removePct, w.updatePct, w.rmwPct,
+		KeyDistName(w.dist), w.prefill, config.segments);
+	if (config.targetRate > 0.0)
+		std::printf("open loop: target %.0f ops/sec\n", config.targetRate);
+	if (config.placement != "none")
+		std::printf("placement=%s cpus=%s\n", config.placement.c_str(),
+			PlacementCpus(PlacementOrder(DiscoverCpus(), config.placement), config.threads).c_str());
+}
+
+// @brief Write the table events of the run if --chrome-trace was given.
+// @return False if the file could not be written.
+static bool WriteRequestedTrace(const BenchConfig& config)
+{
+	if (config.chromeTracePath.empty())
+		return true;
+	std::vector<TraceEventRecord> events = lfht_trace_collect();
+	if (!WriteChromeTrace(config.chromeTracePath, events))
+	{
+		std::fprintf(stderr, "error: cannot write %s\n", config.chromeTracePath.c_str());
+		return false;
+	}
+	std::printf("wrote %zu trace events to %s\n", events.size(), config.chromeTracePath.c_str());
+	return true;
+}
+
+// @brief Print how many delays were injected, if any were requested.
+static void PrintInjectedDelays(const BenchConfig& config)
+{
+	if (config.delayPoints.empty())
+		return;
+	std::printf("injected delays:");
+	for (int i = 0; i < DELAY_POINT_COUNT; ++i)
+		std::printf(" %s=%llu", DELAY_POINT_NAMES[i], (unsigned long long)DelayInjector::Injected(i));
+	std::printf("\n");
+}
+
+int main(int argc, char** argv)
+{
+	BenchConfig config;
+	std::string error;
+	if (!ParseBenchArgs(argc, argv, config, error))
+	{
+		if (!error.empty())
+			std::fprintf(stderr, "error: %s\n", error.c_str());
+		PrintBenchUsage(argv[0]);
+		return error.empty() ? 0 : 1;
+	}
+
+	if (config.micro)
+	{
+		MicroOptions options;
+		options.filter = config.microFilter;
+		MicroBench(options).Run();
+		return 0;
+	}
+
+	if (config.hashReport)
+	{
+		std::vector<std::string> policies = config.hashPolicies;
+		if (policies.empty())
+			policies.assign(std::begin(HASH_POLICY_NAMES), std::end(HASH_POLICY_NAMES));
+		for (const auto& name : policies)
+		{
+			if (!HashPolicyByName(name))
+			{
+				std::fprintf(stderr, "error: unknown hash policy '%s'\n", name.c_str());
+				return 1;
+			}
+		}
+
+		std::vector<uint64_t> keys;
+		if (!config.hashKeysPath.empty())
+		{
+			if (!LoadKeySample(config.hashKeysPath, keys, error))
+			{
+				std::fprintf(stderr, "error: %s\n", error.c_str());
+				return 1;
+			}
+		}
+		else
+		{
+			keys = GenerateKeySample(config);
+		}
+		PrintHashReport(keys, policies);
+		return 0;
+	}
+
+	std::vector<std::string> engines;
+	for (const auto& name : config.engines)
+	{
+		if (name == "all")
+		{
+			engines.assign(std::begin(ENGINE_NAMES), std::end(ENGINE_NAMES));
+			break;
+		}
+		if (!IsEngineName(name))
+		{
+			std::fprintf(stderr, "error: unknown engine '%s'\n", name.c_str());
+			return 1;
+		}
+		engines.push_back(name);
+	}
+
+	if (!config.chromeTracePath.empty() && !ChromeTraceAvailable())
+	{
+		std::fprintf(stderr, "error: --chrome-trace needs the lfht_bench_stats build\n");
+		return 1;
+	}
+
+	if (config.publish)
+	{
+		if (!MetricsPublisher::Process().Open(LATENCY_TYPE_NAMES, LATENCY_TYPE_COUNT, error))
+		{
+			std::fprintf(stderr, "error: %s\n", error.c_str());
+			return 1;
+		}
+		std::printf("publishing metrics to %s, watch them with lfht --attach PID\n",
+			MetricsPublisher::Process().GetName().c_str());
+	}
+
+	if (!config.delayPoints.empty())
+	{
+		if (!DelayInjector::Install(config, error))
+		{
+			std::fprintf(stderr, "error: %s\n", error.c_str());
+			return 1;
+		}
+		std::printf("injecting %.0fus delays with probability %g at:", config.delayMicros, config.delayProbability);
+		for (const auto& point : config.delayPoints)
+			std::printf(" %s", point.c_str());
+		std::printf("\n");
+	}
+
+	if (!config.comparePath.empty() || !config.saveBaselinePath.empty())
+	{
+		// More repetitions than a plain run, the comparison needs the spread
+		if (!config.repsSet)
+			config.reps = 5;
+
+		std::vector<RegressionSample> baseline;
+		if (!config.comparePath.empty())
+		{
+			// Rerun with the settings the baseline was taken with
+			if (!ReadBaseline(config.comparePath, config, baseline, error))
+			{
+				std::fprintf(stderr, "error: %s\n", error.c_str());
+				return 1;
+			}
+		}
+
+		std::printf("standard workloads: threads=%d duration=%.1fs keys=%llu reps=%d placement=%s\n",
+			config.threads, config.durationSec, (unsigned long long)config.keyRange, config.reps, config.placement.c_str());
+		std::vector<RegressionSample> current = RunStandardWorkloads(config, engines);
+		if (FailedRuns() > 0)
+			return 1;
+
+		if (!config.saveBaselinePath.empty() && !WriteBaseline(config.saveBaselinePath, config, current))
+		{
+			std::fprintf(stderr, "error: cannot write %s\n", config.saveBaselinePath.c_str());
+			return 1;
+		}
+		if (config.comparePath.empty())
+			return 0;
+
+		int regressions = CompareToBaseline(baseline, current, config.throughputThreshold, config.latencyThreshold);
+		std::printf("%d regression(s) beyond %.1f%% throughput / %.1f%% p99\n",
+			regressions, config.throughputThreshold, config.latencyThreshold);
+		return regressions > 0 ? 2 : 0;
+	}
+
+	if (!config.scenarioPath.empty())
+	{
+		Scenario scenario;
+		if (!LoadScenario(config.scenarioPath, config, scenario, error))
+		{
+			std::fprintf(stderr, "error: %s\n", error.c_str());
+			return 1;
+		}
+		PrintRunSettings(scenario.base);
+		std::printf("scenario %s: %zu phases, prefill %.2f of %llu keys\n", config.scenarioPath.c_str(),
+			scenario.phases.size(), scenario.base.workload.prefill, (unsigned long long)scenario.base.keyRange);
+		PrintScenarioHeader();
+		std::vector<ScenarioPoint> points;
+		for (const auto& name : engines)
+		{
+			std::vector<ScenarioPoint> p = RunScenario(scenario, name);
+			points.insert(points.end(), p.begin(), p.end());
+		}
+		if (!config.csvPath.empty() && !WriteScenarioCsv(config.csvPath, points))
+		{
+			std::fprintf(stderr, "error: cannot write %s\n", config.csvPath.c_str());
+			return 1;
+		}
+		return WriteRequestedTrace(config) ? 0 : 1;
+	}
+
+	PrintRunSettings(config);
+
+	if (!config.replayPath.empty())
+	{
+		std::vector<TraceRecord> records;
+		if (!LoadTrace(config.replayPath, records, error))
+		{
+			std::fprintf(stderr, "error: %s\n", error.c_str());
+			return 1;
+		}
+		std::printf("replaying %zu records on %d threads, %s\n", records.size(), config.threads,
+			config.replayFast ? "as fast as possible" : "with the recorded timing");
+		std::printf("%-14s %14s %12s %10s %12s %12s\n", "engine", "ops", "ops/sec", "trace s", "replay s", "mismatches");
+		for (const auto& name : engines)
+		{
+			ReplayResult r = WithEngine(name, config, [&](auto& table)
+			{
+				return ReplayTrace(table, records, config.threads, config.replayFast);
+			});
+			std::printf("%-14s %14llu %12.0f %10.2f %12.2f %12llu\n", name.c_str(),
+				(unsigned long long)r.result.ops, r.result.opsPerSec, r.traceSec, r.result.elapsedSec,
+				(unsigned long long)r.mismatches);
+			PrintLatency(r.result);
+			std::fflush(stdout);
+		}
+		return WriteRequestedTrace(config) ? 0 : 1;
+	}
+
+	if (!config.oversubFactors.empty())
+	{
+		RunOversubscription(config, engines);
+		PrintInjectedDelays(config);
+		return FailedRuns() > 0 ? 1 : 0;
+	}
+
+	if (config.soakSec > 0.0)
+	{
+		std::printf("soak: %.0fs, phases of %.0fs (mixed, grow 0:90:10, shrink 0:10:90)\n",
+			config.soakSec, config.soakPhaseSec);
+		LockFreeHashTable<uint64_t, uint64_t> table;
+		std::vector<SoakSample> samples;
+		int growing = RunSoak(table, config, samples);
+		if (!config.csvPath.empty() && !WriteSoakCsv(config.csvPath, samples))
+		{
+			std::fprintf(stderr, "error: cannot write %s\n", config.csvPath.c_str());
+			return 1;
+		}
+		if (!WriteRequestedTrace(config))
+			return 1;
+		return growing > 0 ? 2 : 0;
+	}
+
+	if (config.sweep)
+	{
+		std::vector<SweepPoint> points = RunSweep(config, engines);
+		if (!config.csvPath.empty() && !WriteSweepCsv(config.csvPath, config, points))
+		{
+			std::fprintf(stderr, "error: cannot write %s\n", config.csvPath.c_str());
+			return 1;
+		}
+		if (!config.jsonPath.empty() && !WriteSweepJson(config.jsonPath, config, points))
+		{
+			std::fprintf(stderr, "error: cannot write %s\n", config.jsonPath.c_str());
+			return 1;
+		}
+		return FailedRuns() > 0 ? 1 : 0;
+	}
+
+	std::printf("%-14s %14s %12s %14s %12s %10s\n", "engine", "ops", "ops/sec", "ns/op/thread", "succeeded", "prefill");
+
+	for (const auto& name : engines)
+	{
+		uint64_t recorded = 0;
+		BenchResult result = config.recordPath.empty() ? RunEngine(name, config)
+			: RunRecorded(name, config, config.recordPath, recorded);
+		if (!config.recordPath.empty() && recorded == 0)
+		{
+			std::fprintf(stderr, "error: cannot write %s\n", config.recordPath.c_str());
+			return 1;
+		}
+		std::printf("%-14s %14llu %12.0f %14.1f %11.1f%% %9.2fs\n",
+			name.c_str(), (unsigned long long)result.ops, result.opsPerSec, result.nsPerOp,
+			result.ops > 0 ? 100.0 * result.succeeded / result.ops : 0.0, result.prefillSec);
+		std::printf("  resizes=%zu retired peak=%zu rss=%.1f MB\n",
+			result.resizes, result.retiredPeak, result.rssBytes / (1024.0 * 1024.0));
+		PrintMemory(result);
+		if (config.placement != "none" && result.pinned < config.threads)
+			std::printf("  only %d of %d workers could be pinned\n", result.pinned, config.threads);
+		if (config.targetRate > 0.0 && result.late > 0)
+			std::printf("  %llu scheduled ops were never issued, the engine fell behind the target rate\n",
+				(unsigned long long)result.late);
+		if (config.recordLatency || config.targetRate > 0.0)
+			PrintLatency(result);
+		if (config.perf)
+			PrintPerf(result);
+		PrintTableStats(result);
+		if (recorded > 0)
+			std::printf("  recorded %llu operations to %s\n", (unsigned long long)recorded, config.recordPath.c_str());
+		std::fflush(stdout);
+	}
+	PrintInjectedDelays(config);
+	return WriteRequestedTrace(config) && FailedRuns() == 0 ? 0 : 1;
+}
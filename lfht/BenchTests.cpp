@@ -0,0 +1,529 @@
+// BenchTests.cpp
+// Checks for the benchmark's helpers (make check). Exits non-zero if any check fails.
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include "LatencyHistogram.hpp"
+#include "MiniJson.hpp"
+#include "Regression.hpp"
+#include "Scenario.hpp"
+#include "TraceReplay.hpp"
+#include "Workload.hpp"
+
+static int g_failures = 0;
+
+#define CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			++g_failures; \
+		} \
+	} while (0)
+
+// Every bucket's bounds map back to it, and no bucket is wider than 1/32 of its values.
+static void TestHistogramBuckets()
+{
+	for (int i = 0; i < LatencyHistogram::BUCKET_COUNT; ++i)
+	{
+		const uint64_t lower = LatencyHistogram::BucketLowerBound(i);
+		const uint64_t upper = LatencyHistogram::BucketUpperBound(i);
+		CHECK(LatencyHistogram::BucketIndex(lower) == i);
+		CHECK(LatencyHistogram::BucketIndex(upper) == i);
+		CHECK(lower <= upper);
+		if (i + 1 < LatencyHistogram::BUCKET_COUNT)
+			CHECK(LatencyHistogram::BucketLowerBound(i + 1) == upper + 1);
+		if (lower >= LatencyHistogram::SUB_BUCKETS)
+			CHECK(upper - lower < lower / LatencyHistogram::SUB_BUCKETS);
+		else
+			CHECK(lower == upper);
+	}
+	CHECK(LatencyHistogram::BucketIndex(0) == 0);
+	CHECK(LatencyHistogram::BucketIndex(UINT64_MAX) == LatencyHistogram::BUCKET_COUNT - 1);
+	CHECK(LatencyHistogram::BucketUpperBound(LatencyHistogram::BUCKET_COUNT - 1) == UINT64_MAX);
+}
+
+// Empty, single-value and top-of-range histograms.
+static void TestHistogramPercentileEdges()
+{
+	LatencyHistogram empty;
+	CHECK(empty.Percentile(0) == 0);
+	CHECK(empty.Percentile(50) == 0);
+	CHECK(empty.Percentile(100) == 0);
+	CHECK(empty.Min() == 0 && empty.Max() == 0 && empty.Mean() == 0.0);
+
+	LatencyHistogram single;
+	single.Record(1000);
+	CHECK(single.Percentile(0) == 1000);
+	CHECK(single.Percentile(50) == 1000);
+	CHECK(single.Percentile(100) == 1000);
+	CHECK(single.Min() == 1000 && single.Max() == 1000);
+
+	LatencyHistogram small;
+	for (uint64_t v = 0; v < LatencyHistogram::SUB_BUCKETS; ++v)
+		small.Record(v);
+	CHECK(small.Percentile(50) == LatencyHistogram::SUB_BUCKETS / 2 - 1);
+	CHECK(small.Percentile(100) == LatencyHistogram::SUB_BUCKETS - 1);
+
+	const uint64_t top = 1ULL << 63;
+	LatencyHistogram huge;
+	huge.Record(top);
+	huge.Record(UINT64_MAX);
+	CHECK(huge.Percentile(100) == UINT64_MAX);
+	CHECK(huge.Percentile(50) >= top);
+	CHECK(huge.Percentile(50) - top < top / LatencyHistogram::SUB_BUCKETS);
+	CHECK(huge.Min() == top && huge.Max() == UINT64_MAX);
+}
+
+// Merging per-thread histograms gives the histogram of all values.
+static void TestHistogramMerge()
+{
+	LatencyHistogram a, b, all;
+	for (uint64_t v = 1; v < 100000; v = v * 3 + 1)
+	{
+		a.Record(v);
+		all.Record(v);
+	}
+	for (uint64_t v = 7; v < 10000000; v = v * 5 + 3)
+	{
+		b.Record(v);
+		all.Record(v);
+	}
+	LatencyHistogram empty;
+	a.Merge(empty);
+	a.Merge(b);
+	CHECK(a.Counts() == all.Counts());
+	CHECK(a.Count() == all.Count());
+	CHECK(a.Min() == all.Min() && a.Max() == all.Max());
+	CHECK(a.Mean() == all.Mean());
+	CHECK(a.Percentile(99) == all.Percentile(99));
+
+	empty.Merge(all);
+	CHECK(empty.Min() == 1 && empty.Max() == all.Max());
+	a.Reset();
+	CHECK(a.Count() == 0 && a.Percentile(50) == 0);
+}
+
+// Welch's t on the two samples of the Wikipedia example: t = -2.46, df = 24.99.
+static void TestWelchT()
+{
+	const std::vector<double> a{ 27.5, 21.0, 19.0, 23.6, 17.0, 17.9, 16.9, 20.1, 21.9, 22.6, 23.1, 19.6, 19.0, 21.7, 21.4 };
+	const std::vector<double> b{ 27.1, 22.0, 20.8, 23.4, 23.4, 23.5, 25.8, 22.0, 24.8, 20.2, 21.9, 22.1, 22.9, 20.5, 24.4 };
+	SampleStats sa = ComputeStats(a), sb = ComputeStats(b);
+	double df = 0.0;
+	CHECK(std::fabs(WelchT(sa, sb, df) + 2.4554) < 1e-3);
+	CHECK(std::fabs(df - 24.9885) < 1e-3);
+	CHECK(std::fabs(WelchT(sb, sa, df) - 2.4554) < 1e-3);
+	CHECK(SignificantlyDifferent(sa, sb));  // p = 0.021
+	CHECK(!SignificantlyDifferent(sa, sa));
+
+	// Equal spread and size: df = 2(n - 1) = 18, critical t = 2.101
+	SampleStats x, y;
+	x.n = y.n = 10;
+	x.stddev = y.stddev = 2.0;
+	x.mean = 20.0;
+	y.mean = 22.0;  // t = 2 / sqrt(0.8) = 2.236
+	CHECK(std::fabs(std::fabs(WelchT(x, y, df)) - 2.2361) < 1e-3);
+	CHECK(std::fabs(df - 18.0) < 1e-9);
+	CHECK(SignificantlyDifferent(x, y));
+	y.mean = 21.8;  // t = 2.012
+	CHECK(!SignificantlyDifferent(x, y));
+
+	// Without spread only the means count, and single samples always pass to the threshold
+	y.stddev = x.stddev = 0.0;
+	CHECK(SignificantlyDifferent(x, y));
+	y.mean = x.mean;
+	CHECK(!SignificantlyDifferent(x, y));
+	y.n = 1;
+	CHECK(SignificantlyDifferent(x, y));
+}
+
+// Critical values at table rows, between rows and past the table.
+static void TestStudentT95()
+{
+	CHECK(StudentT95(1) == 12.706);
+	CHECK(StudentT95(2) == 4.303);
+	CHECK(StudentT95(10) == 2.228);
+	CHECK(StudentT95(30) == 2.042);
+	CHECK(StudentT95(24.99) == StudentT95(24));  // fractional df round down, to the larger value
+	CHECK(StudentT95(0.5) == StudentT95(1));
+	CHECK(StudentT95(31) == 1.96);
+	CHECK(StudentT95(1e6) == 1.96);
+	for (int df = 1; df < 40; ++df)
+		CHECK(StudentT95(df + 1) <= StudentT95(df));
+}
+
+// Values, escapes and nesting parse; malformed documents are rejected.
+static void TestJsonParse()
+{
+	JsonValue v;
+	std::string error;
+	CHECK(JsonParser::Parse(" {\"a\": [1, -2.5e3, true, false, null], \"s\": \"x\\\"y\\n\\u0041\", \"o\": {}} ", v, error));
+	CHECK(v.IsObject());
+	CHECK(v["a"].IsArray() && v["a"].array.size() == 5);
+	CHECK(v["a"].array[0].NumberOr(0) == 1.0);
+	CHECK(v["a"].array[1].NumberOr(0) == -2500.0);
+	CHECK(v["a"].array[2].type == JsonValue::Type::Bool && v["a"].array[2].boolean);
+	CHECK(v["a"].array[3].type == JsonValue::Type::Bool && !v["a"].array[3].boolean);
+	CHECK(v["a"].array[4].IsNull());
+	CHECK(v["s"].StringOr("") == "x\"y\nA");
+	CHECK(v["o"].IsObject() && v["o"].object.empty());
+	CHECK(v["missing"].IsNull() && v["missing"].NumberOr(7) == 7);
+
+	const char* malformed[] = { "", "{", "[1,]", "[1 2]", "{\"a\" 1}", "{\"a\": 1,}", "{a: 1}", "tru",
+		"\"open", "1 2", "[\"x\\", "{\"a\": -}", "]" };
+	for (const char* text : malformed)
+	{
+		JsonValue bad;
+		error.clear();
+		CHECK(!JsonParser::Parse(text, bad, error));
+		CHECK(error.find("invalid JSON") == 0);
+	}
+}
+
+// WriteBaseline output reads back through MiniJson unchanged.
+static void TestBaselineRoundTrip()
+{
+	BenchConfig config;
+	config.durationSec = 0.5;
+	config.keyRange = 12345;
+	config.threads = 3;
+	config.placement = "compact";
+	std::vector<RegressionSample> samples(2);
+	samples[0].name = "ycsb-a/lfht/1t";
+	samples[0].throughput = { 1000.5, 2000.0 };
+	samples[0].p99 = { 350, 400 };
+	samples[1].name = "churn/locked/3t";
+	samples[1].throughput = { 42.0 };
+
+	const std::string path = "lfht_bench_tests.json";
+	CHECK(WriteBaseline(path, config, samples));
+	BenchConfig read;
+	std::vector<RegressionSample> back;
+	std::string error;
+	CHECK(ReadBaseline(path, read, back, error));
+	std::remove(path.c_str());
+
+	CHECK(read.durationSec == 0.5 && read.keyRange == 12345 && read.threads == 3 && read.placement == "compact");
+	CHECK(back.size() == 2);
+	for (size_t i = 0; i < back.size() && i < samples.size(); ++i)
+	{
+		CHECK(back[i].name == samples[i].name);
+		CHECK(back[i].throughput == samples[i].throughput);
+		CHECK(back[i].p99 == samples[i].p99);
+	}
+
+	std::vector<RegressionSample> none;
+	CHECK(!ReadBaseline("no-such-baseline.json", read, none, error));
+	CHECK(error == "cannot open no-such-baseline.json");
+}
+
+// @brief Share of the draws a Zipfian distribution gives its most popular item.
+static double ZipfTopShare(uint64_t items, double theta)
+{
+	double zeta = 0.0;
+	for (uint64_t i = 1; i <= items; ++i)
+		zeta += 1.0 / std::pow(static_cast<double>(i), theta);
+	return 1.0 / zeta;
+}
+
+// Zipfian, hotspot and latest keys stay in range and are as skewed as configured.
+static void TestKeyDistributions()
+{
+	const uint64_t range = 1000;
+	const int draws = 200000;
+	const double top = ZipfTopShare(range, 0.99);  // ~0.13
+
+	ZipfianGenerator zipf(range, 0.99);
+	FastRng rng(42);
+	std::vector<int> ranks(range, 0);
+	for (int i = 0; i < draws; ++i)
+	{
+		uint64_t rank = zipf.Next(rng);
+		CHECK(rank < range);
+		if (rank < range)
+			ranks[rank]++;
+	}
+	CHECK(std::fabs(ranks[0] / double(draws) - top) < 0.1 * top);
+	CHECK(std::fabs(ranks[1] / double(draws) - top / std::pow(2.0, 0.99)) < 0.1 * top);
+	CHECK(ranks[0] > ranks[1] && ranks[1] > ranks[10] && ranks[10] > ranks[500]);
+
+	WorkloadSpec spec;
+	spec.keyOffset = 5000;
+	spec.prefill = 0.5;
+	for (KeyDist dist : { KeyDist::Zipfian, KeyDist::Hotspot, KeyDist::Latest })
+	{
+		spec.dist = dist;
+		WorkloadShared shared(spec, range);
+		WorkloadGenerator gen(shared, 7, 0, 1);
+		WorkloadGenerator same(shared, 7, 0, 1);
+		std::vector<int> counts(range, 0);
+		bool repeatable = true;
+		for (int i = 0; i < draws; ++i)
+		{
+			uint64_t key = gen.NextKey(OpType::Read);
+			repeatable = repeatable && same.NextKey(OpType::Read) == key;
+			CHECK(key >= spec.keyOffset && key < spec.keyOffset + range);
+			if (key >= spec.keyOffset && key < spec.keyOffset + range)
+				counts[key - spec.keyOffset]++;
+		}
+		CHECK(repeatable);
+
+		if (dist == KeyDist::Hotspot)
+		{
+			// hotKeyFraction 0.2 of the keys take hotOpFraction 0.8 of the operations
+			int hot = 0;
+			for (uint64_t k = 0; k < range / 5; ++k)
+				hot += counts[k];
+			CHECK(std::fabs(hot / double(draws) - 0.8) < 0.01);
+		}
+		else
+		{
+			// The most popular key has the rank 0 share: scrambled, or the newest prefilled key
+			int most = 0;
+			for (int c : counts)
+				most = std::max(most, c);
+			CHECK(std::fabs(most / double(draws) - top) < 0.1 * top);
+			if (dist == KeyDist::Latest)
+			{
+				CHECK(counts[shared.PrefillCount() - 1] == most);
+				CHECK(counts[shared.PrefillCount()] == 0);
+			}
+		}
+	}
+
+	// Latest inserts append new keys, and reads follow them
+	spec.dist = KeyDist::Latest;
+	WorkloadShared shared(spec, range);
+	WorkloadGenerator gen(shared, 9, 0, 1);
+	const uint64_t first = shared.PrefillCount();
+	CHECK(gen.NextKey(OpType::Insert) == spec.keyOffset + first);
+	CHECK(gen.NextKey(OpType::Insert) == spec.keyOffset + first + 1);
+	for (int i = 0; i < 1000; ++i)
+		CHECK(gen.NextKey(OpType::Read) <= spec.keyOffset + first + 1);
+}
+
+// Operations recorded through TracingTable load back in order and replay with the same results.
+static void TestTraceRoundTrip()
+{
+	const std::string path = "lfht_bench_tests.trace";
+	const uint64_t keys = TraceRecorder::TRACE_BUFFER_RECORDS / 2 + 100;  // more records than one buffer
+	LockFreeHashTable<uint64_t, uint64_t> table;
+	TraceRecorder recorder;
+	CHECK(recorder.Open(path));
+	TracingTable<LockFreeHashTable<uint64_t, uint64_t>, uint64_t> traced(table, recorder);
+	std::vector<TraceRecord> expected;
+	for (uint64_t k = 0; k < keys; ++k)
+	{
+		expected.emplace_back(0, 0, TraceOp::Insert, traced.insert(k, k), std::hash<uint64_t>{}(k));
+		expected.emplace_back(0, 0, TraceOp::Contains, traced.contains(k + 1), std::hash<uint64_t>{}(k + 1));
+	}
+	// A second thread, after the first one: its records carry thread 1
+	std::thread second([&]()
+	{
+		for (uint64_t k = 0; k < keys; k += 2)
+			expected.emplace_back(0, 1, TraceOp::Remove, traced.remove(k), std::hash<uint64_t>{}(k));
+		expected.emplace_back(0, 1, TraceOp::Remove, traced.remove(0), std::hash<uint64_t>{}(0));
+	});
+	second.join();
+	recorder.Close();
+	CHECK(recorder.Written() == expected.size());
+
+	std::vector<TraceRecord> records;
+	std::string error;
+	CHECK(LoadTrace(path, records, error));
+	CHECK(records.size() == expected.size());
+	if (records.size() == expected.size())
+	{
+		for (size_t i = 0; i < records.size(); ++i)
+		{
+			CHECK(records[i].Op() == expected[i].Op());
+			CHECK(records[i].Result() == expected[i].Result());
+			CHECK(records[i].keyHash == expected[i].keyHash);
+			CHECK(records[i].Thread() == expected[i].Thread());
+			if (i > 0)
+				CHECK(records[i].TimeNs() >= records[i - 1].TimeNs());
+		}
+	}
+	CHECK(records.back().Op() == TraceOp::Remove && !records.back().Result());
+
+	LockFreeHashTable<uint64_t, uint64_t> fresh;
+	ReplayResult replay = ReplayTrace(fresh, records, 1, true);
+	CHECK(replay.result.ops == records.size());
+	CHECK(replay.mismatches == 0);
+	CHECK(fresh.getCount() == keys / 2);
+
+	// A wrong magic, a wrong record size and a short header are rejected
+	TraceFileHeader header = { { 'L', 'F', 'H', 'T', 'T', 'R', 'C', '2' }, sizeof(TraceRecord), 0 };
+	for (int variant = 0; variant < 3; ++variant)
+	{
+		if (variant == 1)
+		{
+			header.magic[7] = '1';
+			header.recordSize = 8;
+		}
+		std::FILE* f = std::fopen(path.c_str(), "wb");
+		CHECK(f != nullptr);
+		if (!f)
+			return;
+		if (variant == 2)
+		{
+			std::fwrite(&header, 4, 1, f);
+		}
+		else
+		{
+			std::fwrite(&header, sizeof(header), 1, f);
+			std::fwrite(expected.data(), sizeof(TraceRecord), 4, f);
+		}
+		std::fclose(f);
+		std::vector<TraceRecord> bad;
+		CHECK(!LoadTrace(path, bad, error));
+		CHECK(error == path + " is not a trace file");
+		CHECK(bad.empty());
+	}
+	std::remove(path.c_str());
+	CHECK(!LoadTrace(path, records, error));
+	CHECK(error == "cannot open " + path);
+}
+
+// @brief Replace a file's contents.
+static void WriteFile(const std::string& path, const char* text)
+{
+	std::FILE* f = std::fopen(path.c_str(), "w");
+	CHECK(f != nullptr);
+	if (!f)
+		return;
+	std::fputs(text, f);
+	std::fclose(f);
+}
+
+// Sections, comments and repeated names load in file order; bad lines name their line.
+static void TestIniFile()
+{
+	const std::string path = "lfht_bench_tests.ini";
+	WriteFile(path,
+		"; comment\n"
+		"top = 1\n"
+		"\n"
+		"[ first ]\n"
+		"  a = x y  \n"
+		"# comment\n"
+		"b=2 ; trailing\n"
+		"empty =\n"
+		"[first]\n"
+		"a = again\r\n");
+	std::vector<IniSection> sections;
+	std::string error;
+	CHECK(IniFile::Load(path, sections, error));
+	CHECK(sections.size() == 3);
+	if (sections.size() == 3)
+	{
+		CHECK(sections[0].name == "" && sections[0].line == 0);
+		CHECK(sections[0].values.size() == 1 && sections[0].values[0].first == "top" && sections[0].values[0].second == "1");
+		CHECK(sections[1].name == "first" && sections[1].line == 4);
+		CHECK(sections[1].values.size() == 3);
+		if (sections[1].values.size() == 3)
+		{
+			CHECK(sections[1].values[0] == std::make_pair(std::string("a"), std::string("x y")));
+			CHECK(sections[1].values[1] == std::make_pair(std::string("b"), std::string("2")));
+			CHECK(sections[1].values[2] == std::make_pair(std::string("empty"), std::string("")));
+		}
+		CHECK(sections[2].name == "first" && sections[2].line == 9);
+		CHECK(sections[2].values.size() == 1 && sections[2].values[0].second == "again");
+	}
+
+	WriteFile(path, "[ok]\na = 1\n[broken\n");
+	sections.clear();
+	CHECK(!IniFile::Load(path, sections, error));
+	CHECK(error == path + ":3: missing ']'");
+
+	WriteFile(path, "[ok]\n\nnot a pair\n");
+	sections.clear();
+	CHECK(!IniFile::Load(path, sections, error));
+	CHECK(error == path + ":3: expected key = value");
+
+	std::remove(path.c_str());
+	CHECK(!IniFile::Load(path, sections, error));
+	CHECK(error == "cannot open " + path);
+}
+
+// Phases start from the [scenario] settings, which start from the command line.
+static void TestScenarioFile()
+{
+	const std::string path = "lfht_bench_tests.ini";
+	BenchConfig base;
+	base.durationSec = 2.0;
+	base.threads = 3;
+	WriteFile(path,
+		"[scenario]\n"
+		"keys = 5000\n"
+		"threads = 2\n"
+		"[phase grow]\n"
+		"mix = 0:90:10\n"
+		"key_offset = 100\n"
+		"[phase read]\n"
+		"duration = 0.5\n"
+		"dist = zipfian\n");
+	Scenario scenario;
+	std::string error;
+	CHECK(LoadScenario(path, base, scenario, error));
+	CHECK(scenario.base.keyRange == 5000 && scenario.base.threads == 2 && scenario.base.durationSec == 2.0);
+	CHECK(scenario.phases.size() == 2);
+	if (scenario.phases.size() == 2)
+	{
+		const BenchConfig& grow = scenario.phases[0].config;
+		CHECK(scenario.phases[0].name == "grow");
+		CHECK(grow.keyRange == 5000 && grow.threads == 2 && grow.durationSec == 2.0);
+		CHECK(grow.workload.readPct == 0 && grow.workload.insertPct == 90 && grow.workload.removePct == 10);
+		CHECK(grow.workload.keyOffset == 100);
+
+		// Not from the phase before
+		const BenchConfig& read = scenario.phases[1].config;
+		CHECK(scenario.phases[1].name == "read");
+		CHECK(read.durationSec == 0.5 && read.workload.dist == KeyDist::Zipfian);
+		CHECK(read.workload.insertPct == base.workload.insertPct && read.workload.keyOffset == 0);
+	}
+
+	WriteFile(path, "[scenario]\nkeys = 10\n[phase a]\nbogus = 1\n");
+	Scenario bad;
+	CHECK(!LoadScenario(path, base, bad, error));
+	CHECK(error == "[phase a] (line 3): unknown option --bogus");
+
+	WriteFile(path, "[scenario]\nkeys = 10\n[other]\nthreads = 1\n");
+	Scenario unknown;
+	CHECK(!LoadScenario(path, base, unknown, error));
+	CHECK(error == "unknown section [other], expected [scenario] or [phase NAME]");
+
+	WriteFile(path, "[scenario]\nkeys = 10\n");
+	Scenario empty;
+	CHECK(!LoadScenario(path, base, empty, error));
+	CHECK(error == path + " has no [phase NAME] sections");
+	std::remove(path.c_str());
+}
+
+int main()
+{
+	TestHistogramBuckets();
+	TestHistogramPercentileEdges();
+	TestHistogramMerge();
+	TestWelchT();
+	TestStudentT95();
+	TestJsonParse();
+	TestBaselineRoundTrip();
+	TestKeyDistributions();
+	TestTraceRoundTrip();
+	TestIniFile();
+	TestScenarioFile();
+
+	if (g_failures)
+	{
+		std::fprintf(stderr, "%d check(s) failed\n", g_failures);
+		return 1;
+	}
+	std::printf("all bench tests passed\n");
+	return 0;
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "LockFreeHashTable.hpp"
+
+// @brief Whether the table's event trace is compiled in (LFHT_ENABLE_TRACE).
+inline bool ChromeTraceAvailable()
+{
+#ifdef LFHT_ENABLE_TRACE
+	return true;
+#else
+	return false;
+#endif
+}
+
+// @brief Write table trace events in the Chrome trace event format, for
+// chrome://tracing or ui.perfetto.dev. Each table is shown as a process and
+// each thread as a track; timestamps are microseconds since the first event.
+// @param path The JSON file to write.
+// @param events The events, e.g. from lfht_trace_collect().
+// @return False if the file could not be written.
+inline bool WriteChromeTrace(const std::string& path, std::vector<TraceEventRecord> events)
+{
+	FILE* f = std::fopen(path.c_str(), "w");
+	if (!f)
+		return false;
+
+	std::sort(events.begin(), events.end(),
+		[](const TraceEventRecord& a, const TraceEventRecord& b) { return a.start_ns < b.start_ns; });
+	const uint64_t firstNs = events.empty() ? 0 : events.front().start_ns;
+
+	// Number the tables in order of their first event
+	std::vector<const void*> tables;
+	std::vector<std::pair<int, uint32_t>> tracks;
+	std::fprintf(f, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+	bool first = true;
+	auto separator = [&]() { std::fprintf(f, first ? "  " : ",\n  "); first = false; };
+	for (const auto& e : events)
+	{
+		int pid = static_cast<int>(std::find(tables.begin(), tables.end(), e.table) - tables.begin()) + 1;
+		if (pid > static_cast<int>(tables.size()))
+		{
+			tables.push_back(e.table);
+			separator();
+			std::fprintf(f, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, \"args\": {\"name\": \"table %d (%p)\"}}",
+				pid, pid, e.table);
+		}
+		if (std::find(tracks.begin(), tracks.end(), std::make_pair(pid, e.thread)) == tracks.end())
+		{
+			tracks.push_back({ pid, e.thread });
+			separator();
+			std::fprintf(f, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %u, \"args\": {\"name\": \"thread %u\"}}",
+				pid, e.thread, e.thread);
+		}
+
+		const double ts = (e.start_ns - firstNs) / 1000.0;
+		separator();
+		switch (e.type)
+		{
+		case TraceEventType::Resize:
+			std::fprintf(f, "{\"name\": \"resize %llu -> %llu\", \"cat\": \"resize\", \"ph\": \"X\", \"pid\": %d, \"tid\": %u, "
+				"\"ts\": %.3f, \"dur\": %.3f, \"args\": {\"old_size\": %llu, \"new_size\": %llu, \"published\": %s}}",
+				(unsigned long long)e.args[0], (unsigned long long)e.args[1], pid, e.thread, ts, e.duration_ns / 1000.0,
+				(unsigned long long)e.args[0], (unsigned long long)e.args[1], e.args[2] ? "true" : "false");
+			break;
+		case TraceEventType::Scan:
+			std::fprintf(f, "{\"name\": \"scan\", \"cat\": \"reclaim\", \"ph\": \"X\", \"pid\": %d, \"tid\": %u, "
+				"\"ts\": %.3f, \"dur\": %.3f, \"args\": {\"hazard_pointers\": %llu, \"freed\": %llu, \"kept\": %llu}}",
+				pid, e.thread, ts, e.duration_ns / 1000.0,
+				(unsigned long long)e.args[0], (unsigned long long)e.args[1], (unsigned long long)e.args[2]);
+			break;
+		case TraceEventType::RetryStreak:
+			std::fprintf(f, "{\"name\": \"%s retries\", \"cat\": \"contention\", \"ph\": \"i\", \"s\": \"t\", \"pid\": %d, \"tid\": %u, "
+				"\"ts\": %.3f, \"args\": {\"retries\": %llu}}",
+				e.args[0] ? "remove" : "insert", pid, e.thread, ts, (unsigned long long)e.args[1]);
+			break;
+		case TraceEventType::ArrayPublish:
+			std::fprintf(f, "{\"name\": \"publish %llu buckets\", \"cat\": \"resize\", \"ph\": \"i\", \"s\": \"p\", \"pid\": %d, \"tid\": %u, "
+				"\"ts\": %.3f, \"args\": {\"size\": %llu}}",
+				(unsigned long long)e.args[0], pid, e.thread, ts, (unsigned long long)e.args[0]);
+			break;
+		}
+	}
+	std::fprintf(f, "\n]}\n");
+	std::fclose(f);
+	return true;
+}
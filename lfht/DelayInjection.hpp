@@ -0,0 +1,113 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BenchConfig.hpp"
+#include "LockFreeHashTable.hpp"
+#include "Workload.hpp"
+
+// Names of the table's delay points for --delay, in DelayPoint order
+constexpr int DELAY_POINT_COUNT = 3;
+static const char* DELAY_POINT_NAMES[DELAY_POINT_COUNT] = { "insert", "remove", "resize" };
+
+// Random delays at the table's LFHT_INJECT_DELAY points, standing in for a
+// thread that is preempted in the middle of an operation.
+class DelayInjector
+{
+public:
+	// @brief Whether the table was compiled with LFHT_DELAY_INJECTION.
+	static bool Available()
+	{
+#ifdef LFHT_DELAY_INJECTION
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	// @brief Enable delays at the points named in the config.
+	// @param config delayPoints, delayProbability and delayMicros are used.
+	// @param error Set when a point is unknown or injection is compiled out.
+	// @return True on success.
+	static bool Install(const BenchConfig& config, std::string& error)
+	{
+		if (!Available())
+		{
+			error = "--delay needs a build with delay injection (make lfht_bench_faults)";
+			return false;
+		}
+		for (const auto& name : config.delayPoints)
+		{
+			int point = -1;
+			for (int i = 0; i < DELAY_POINT_COUNT; ++i)
+			{
+				if (name == DELAY_POINT_NAMES[i] || name == "all")
+				{
+					enabled()[i].store(true);
+					point = i;
+				}
+			}
+			if (point < 0)
+			{
+				error = "unknown delay point '" + name + "', expected insert, remove, resize or all";
+				return false;
+			}
+		}
+		probability() = config.delayProbability;
+		micros() = config.delayMicros;
+#ifdef LFHT_DELAY_INJECTION
+		lfht_delay_hook.store(&hook);
+#endif
+		return true;
+	}
+
+	// @brief Number of delays injected at a point so far.
+	static uint64_t Injected(int point)
+	{
+		return injected()[point].load(std::memory_order_relaxed);
+	}
+
+private:
+	static std::atomic<bool>* enabled()
+	{
+		static std::atomic<bool> flags[DELAY_POINT_COUNT] = {};
+		return flags;
+	}
+
+	static std::atomic<uint64_t>* injected()
+	{
+		static std::atomic<uint64_t> counts[DELAY_POINT_COUNT] = {};
+		return counts;
+	}
+
+	static double& probability()
+	{
+		static double p = 0.0;
+		return p;
+	}
+
+	static double& micros()
+	{
+		static double us = 0.0;
+		return us;
+	}
+
+#ifdef LFHT_DELAY_INJECTION
+	static void hook(DelayPoint point)
+	{
+		int i = static_cast<int>(point);
+		if (!enabled()[i].load(std::memory_order_relaxed))
+			return;
+		thread_local FastRng rng(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+		if (rng.NextDouble() >= probability())
+			return;
+		injected()[i].fetch_add(1, std::memory_order_relaxed);
+		// Sleeping gives the CPU away like a preemption would
+		std::this_thread::sleep_for(std::chrono::duration<double, std::micro>(micros()));
+	}
+#endif
+};
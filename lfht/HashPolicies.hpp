@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// Hash policies for LockFreeHashTable's Hash parameter, e.g.
+// LockFreeHashTable<int, std::string, Mix64Hash<int>>.
+// The table takes hash % bucket count with power-of-two bucket counts, so a
+// policy has to spread entropy into the low bits. std::hash of an integer is
+// the identity on the common standard libraries: keys with a stride of 2^k
+// then only ever reach 1 / 2^k of the buckets.
+
+// The standard library hash, the table's default
+template <typename K>
+struct IdentityHash
+{
+	size_t operator()(const K& key) const { return std::hash<K>{}(key); }
+};
+
+// Multiply by the golden ratio and fold the high half into the low half.
+// One multiply, fixes strides but keeps some structure.
+template <typename K>
+struct MultiplyShiftHash
+{
+	size_t operator()(const K& key) const
+	{
+		uint64_t x = static_cast<uint64_t>(std::hash<K>{}(key)) * 0x9E3779B97F4A7C15ULL;
+		return static_cast<size_t>(x ^ (x >> 32));
+	}
+};
+
+// SplitMix64 finalizer: two multiplies, every input bit affects every output bit
+template <typename K>
+struct Mix64Hash
+{
+	size_t operator()(const K& key) const
+	{
+		uint64_t x = static_cast<uint64_t>(std::hash<K>{}(key));
+		x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+		return static_cast<size_t>(x ^ (x >> 31));
+	}
+};
+
+// MurmurHash3 fmix64 finalizer
+template <typename K>
+struct Murmur3Hash
+{
+	size_t operator()(const K& key) const
+	{
+		uint64_t x = static_cast<uint64_t>(std::hash<K>{}(key));
+		x ^= x >> 33;
+		x *= 0xFF51AFD7ED558CCDULL;
+		x ^= x >> 33;
+		x *= 0xC4CEB9FE1A85EC53ULL;
+		return static_cast<size_t>(x ^ (x >> 33));
+	}
+};
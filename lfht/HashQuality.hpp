@@ -0,0 +1,172 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "BenchConfig.hpp"
+#include "HashPolicies.hpp"
+#include "Workload.hpp"
+
+// Names accepted by --hash, in report order
+static const char* HASH_POLICY_NAMES[] = { "identity", "multiply-shift", "mix64", "murmur3" };
+
+// @brief Look up a hash policy by name.
+// @return The policy, empty if the name is unknown.
+inline std::function<size_t(uint64_t)> HashPolicyByName(const std::string& name)
+{
+	if (name == "identity") return IdentityHash<uint64_t>();
+	if (name == "multiply-shift") return MultiplyShiftHash<uint64_t>();
+	if (name == "mix64") return Mix64Hash<uint64_t>();
+	if (name == "murmur3") return Murmur3Hash<uint64_t>();
+	return {};
+}
+
+// Chain length statistics of one bucket count
+struct ChainStats
+{
+	size_t buckets = 0;
+	double load = 0.0;
+	size_t maxChain = 0;
+	size_t emptyBuckets = 0;
+	double variance = 0.0;     // of the chain length, Poisson(load) has variance = load
+	double hitProbes = 0.0;    // nodes visited by a successful lookup, on average
+	double missProbes = 0.0;   // nodes visited by a miss that lands like the keys do
+	std::vector<size_t> histogram;  // histogram[l] = buckets with chain length l
+};
+
+// @brief Chain lengths of a key sample at one bucket count.
+// @param hashes Hash value of every key.
+// @param buckets The bucket count; the bucket of a key is hash % buckets as in the table.
+inline ChainStats AnalyzeChains(const std::vector<size_t>& hashes, size_t buckets)
+{
+	std::vector<uint32_t> chains(buckets);
+	for (size_t h : hashes)
+		chains[h % buckets]++;
+
+	ChainStats s;
+	s.buckets = buckets;
+	const double n = static_cast<double>(hashes.size());
+	s.load = n / buckets;
+	double sumSq = 0.0;
+	double hitSum = 0.0;
+	for (uint32_t l : chains)
+	{
+		s.maxChain = std::max<size_t>(s.maxChain, l);
+		if (l >= s.histogram.size())
+			s.histogram.resize(l + 1);
+		s.histogram[l]++;
+		sumSq += static_cast<double>(l) * l;
+		hitSum += static_cast<double>(l) * (l + 1) / 2.0;  // the i-th node of a chain takes i probes
+	}
+	s.emptyBuckets = s.histogram.empty() ? 0 : s.histogram[0];
+	s.variance = sumSq / buckets - s.load * s.load;
+	s.hitProbes = n > 0 ? hitSum / n : 0.0;
+	// A miss whose key hashes like the sample walks a chain picked with
+	// probability length / n, the whole chain in the worst case
+	s.missProbes = n > 0 ? sumSq / n : 0.0;
+	return s;
+}
+
+// @brief The bucket counts try_resize goes through while the keys are inserted.
+// Mirrors LockFreeHashTable: 64 buckets at the start, doubled whenever the
+// load exceeds 2.
+inline std::vector<size_t> ResizeBucketCounts(size_t keys)
+{
+	std::vector<size_t> counts{ 64 };
+	while (static_cast<double>(keys) / counts.back() > 2.0)
+		counts.push_back(counts.back() * 2);
+	return counts;
+}
+
+// @brief Read keys, one unsigned integer per line. Other lines are skipped.
+// @return False if the file cannot be opened.
+inline bool LoadKeySample(const std::string& path, std::vector<uint64_t>& keys, std::string& error)
+{
+	std::ifstream in(path);
+	if (!in)
+	{
+		error = "cannot open " + path;
+		return false;
+	}
+	std::string line;
+	while (std::getline(in, line))
+	{
+		char* end = nullptr;
+		unsigned long long key = std::strtoull(line.c_str(), &end, 0);
+		if (end != line.c_str())
+			keys.push_back(key);
+	}
+	return true;
+}
+
+// @brief Generate distinct keys: keys i * stride, or draws from the configured workload.
+// @param config keyRange, workload, seed, hashStride and hashSample are used.
+inline std::vector<uint64_t> GenerateKeySample(const BenchConfig& config)
+{
+	const uint64_t n = config.hashSample > 0 ? config.hashSample : config.keyRange;
+	std::vector<uint64_t> keys;
+	if (config.hashStride > 0)
+	{
+		for (uint64_t i = 0; i < n; ++i)
+			keys.push_back(config.workload.keyOffset + i * config.hashStride);
+		return keys;
+	}
+
+	WorkloadShared shared(config.workload, config.keyRange);
+	WorkloadGenerator gen(shared, config.seed, 0, 1);
+	std::unordered_set<uint64_t> seen;
+	for (uint64_t attempt = 0; seen.size() < n && attempt < 20 * n; ++attempt)
+	{
+		uint64_t key = gen.NextKey(OpType::Insert);
+		if (seen.insert(key).second)
+			keys.push_back(key);
+	}
+	return keys;
+}
+
+// @brief Print the chain report of every policy for every bucket count the table would use.
+// @param keys The key sample, duplicates are ignored.
+// @param policies Names from HASH_POLICY_NAMES.
+inline void PrintHashReport(std::vector<uint64_t> keys, const std::vector<std::string>& policies)
+{
+	std::sort(keys.begin(), keys.end());
+	keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+	std::printf("%zu distinct keys\n", keys.size());
+	if (keys.empty())
+		return;
+
+	for (const auto& name : policies)
+	{
+		auto policy = HashPolicyByName(name);
+		std::vector<size_t> hashes;
+		hashes.reserve(keys.size());
+		for (uint64_t k : keys)
+			hashes.push_back(policy(k));
+
+		std::printf("\n%s\n", name.c_str());
+		std::printf("  %10s %7s %7s %8s %11s %11s %11s %11s %11s\n", "buckets", "load", "max", "empty %",
+			"var/ideal", "hit probes", "ideal", "miss probes", "ideal");
+		ChainStats last;
+		for (size_t buckets : ResizeBucketCounts(keys.size()))
+		{
+			ChainStats s = AnalyzeChains(hashes, buckets);
+			// Ideal: chain lengths Poisson(load), var = load, hit = 1 + load / 2, miss = load + 1
+			std::printf("  %10zu %7.2f %7zu %7.1f%% %11.2f %11.2f %11.2f %11.2f %11.2f\n", s.buckets, s.load, s.maxChain,
+				100.0 * s.emptyBuckets / s.buckets, s.load > 0.0 ? s.variance / s.load : 0.0,
+				s.hitProbes, 1.0 + s.load / 2.0, s.missProbes, s.load + 1.0);
+			last = s;
+		}
+
+		std::printf("  chain lengths at %zu buckets:", last.buckets);
+		for (size_t l = 0; l < last.histogram.size(); ++l)
+		{
+			if (last.histogram[l] > 0)
+				std::printf(" %zu:%zu", l, last.histogram[l]);
+		}
+		std::printf("\n");
+	}
+}
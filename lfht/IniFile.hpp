@@ -0,0 +1,80 @@
+#pragma once
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Minimal INI reader for the benchmark's scenario files.
+// Sections and keys keep their file order, repeated section names are allowed.
+// Lines starting with ';' or '#' are comments.
+struct IniSection
+{
+	std::string name;
+	std::vector<std::pair<std::string, std::string>> values;
+	int line = 0;
+};
+
+class IniFile
+{
+public:
+	// @brief Read an INI file.
+	// @param path The file.
+	// @param sections Receives the sections in file order. Keys before the first section go into one named "".
+	// @param error Set to a description with the line number on failure.
+	// @return True on success.
+	static bool Load(const std::string& path, std::vector<IniSection>& sections, std::string& error)
+	{
+		std::ifstream in(path);
+		if (!in)
+		{
+			error = "cannot open " + path;
+			return false;
+		}
+
+		std::string line;
+		int number = 0;
+		while (std::getline(in, line))
+		{
+			number++;
+			line = trim(line);
+			if (line.empty() || line[0] == ';' || line[0] == '#')
+				continue;
+
+			if (line[0] == '[')
+			{
+				if (line.back() != ']')
+				{
+					error = path + ":" + std::to_string(number) + ": missing ']'";
+					return false;
+				}
+				sections.push_back({ trim(line.substr(1, line.size() - 2)), {}, number });
+				continue;
+			}
+
+			size_t eq = line.find('=');
+			if (eq == std::string::npos)
+			{
+				error = path + ":" + std::to_string(number) + ": expected key = value";
+				return false;
+			}
+			if (sections.empty())
+				sections.push_back({ "", {}, 0 });
+			std::string value = trim(line.substr(eq + 1));
+			size_t comment = value.find_first_of(";#");
+			if (comment != std::string::npos)
+				value = trim(value.substr(0, comment));
+			sections.back().values.push_back({ trim(line.substr(0, eq)), value });
+		}
+		return true;
+	}
+
+private:
+	static std::string trim(const std::string& text)
+	{
+		size_t begin = text.find_first_not_of(" \t\r\n");
+		if (begin == std::string::npos)
+			return "";
+		size_t end = text.find_last_not_of(" \t\r\n");
+		return text.substr(begin, end - begin + 1);
+	}
+};
@@ -0,0 +1,129 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Log-linear latency histogram in the style of HdrHistogram.
+// Every power of two is split into 2^SUB_BUCKET_BITS linear sub-buckets, so any
+// recorded value is off by at most 1/32 (~3%). Values are nanoseconds.
+// Not thread-safe: keep one per thread and Merge() them at the end.
+class LatencyHistogram
+{
+public:
+	static constexpr int SUB_BUCKET_BITS = 5;
+	static constexpr uint64_t SUB_BUCKETS = 1ULL << SUB_BUCKET_BITS;
+	static constexpr int BUCKET_COUNT = static_cast<int>(SUB_BUCKETS * (64 - SUB_BUCKET_BITS + 1));
+
+	LatencyHistogram() : m_counts(BUCKET_COUNT, 0), m_total(0), m_sum(0), m_min(UINT64_MAX), m_max(0) {}
+
+	// @brief Record one value.
+	// @param ns The latency in nanoseconds.
+	void Record(uint64_t ns)
+	{
+		m_counts[BucketIndex(ns)]++;
+		m_total++;
+		m_sum += ns;
+		if (ns < m_min) m_min = ns;
+		if (ns > m_max) m_max = ns;
+	}
+
+	// @brief Add the counts of another histogram to this one.
+	void Merge(const LatencyHistogram& other)
+	{
+		for (int i = 0; i < BUCKET_COUNT; ++i)
+			m_counts[i] += other.m_counts[i];
+		m_total += other.m_total;
+		m_sum += other.m_sum;
+		if (other.m_min < m_min) m_min = other.m_min;
+		if (other.m_max > m_max) m_max = other.m_max;
+	}
+
+	// @brief Clear all recorded values.
+	void Reset()
+	{
+		std::fill(m_counts.begin(), m_counts.end(), 0);
+		m_total = 0;
+		m_sum = 0;
+		m_min = UINT64_MAX;
+		m_max = 0;
+	}
+
+	// @brief Value at a percentile.
+	// @param p Percentile in [0, 100].
+	// @return The upper bound of the bucket the percentile falls in, clamped to the max.
+	uint64_t Percentile(double p) const
+	{
+		if (m_total == 0)
+			return 0;
+		uint64_t rank = static_cast<uint64_t>(p / 100.0 * m_total + 0.5);
+		if (rank < 1) rank = 1;
+		if (rank > m_total) rank = m_total;
+
+		uint64_t seen = 0;
+		for (int i = 0; i < BUCKET_COUNT; ++i)
+		{
+			seen += m_counts[i];
+			if (seen >= rank)
+			{
+				uint64_t upper = BucketUpperBound(i);
+				return upper < m_max ? upper : m_max;
+			}
+		}
+		return m_max;
+	}
+
+	uint64_t Count() const { return m_total; }
+	uint64_t Min() const { return m_total ? m_min : 0; }
+	uint64_t Max() const { return m_max; }
+	double Mean() const { return m_total ? static_cast<double>(m_sum) / m_total : 0.0; }
+	const std::vector<uint64_t>& Counts() const { return m_counts; }
+
+	// @brief Index of the bucket a value is counted in.
+	static int BucketIndex(uint64_t v)
+	{
+		if (v < SUB_BUCKETS)
+			return static_cast<int>(v);
+		int shift = HighestBit(v) - SUB_BUCKET_BITS;
+		uint64_t sub = (v >> shift) - SUB_BUCKETS;
+		return static_cast<int>(SUB_BUCKETS * (shift + 1) + sub);
+	}
+
+	// @brief Smallest value counted in a bucket.
+	static uint64_t BucketLowerBound(int index)
+	{
+		if (index < static_cast<int>(SUB_BUCKETS))
+			return index;
+		int shift = index / static_cast<int>(SUB_BUCKETS) - 1;
+		uint64_t sub = index % SUB_BUCKETS;
+		return (SUB_BUCKETS + sub) << shift;
+	}
+
+	// @brief Largest value counted in a bucket.
+	static uint64_t BucketUpperBound(int index)
+	{
+		if (index + 1 >= BUCKET_COUNT)
+			return UINT64_MAX;
+		return BucketLowerBound(index + 1) - 1;
+	}
+
+private:
+	std::vector<uint64_t> m_counts;
+	uint64_t m_total;
+	uint64_t m_sum;
+	uint64_t m_min;
+	uint64_t m_max;
+
+	static int HighestBit(uint64_t v)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanReverse64(&index, v);
+		return static_cast<int>(index);
+#else
+		return 63 - __builtin_clzll(v);
+#endif
+	}
+};
@@ -10,19 +10,24 @@
 #include <unordered_set>
 #include <memory>
 #include <thread>
+#include <chrono>
+#include <string>
+#include <tuple>
 
 // Combined MarkedPtr (64-bit for atomic operations)
-// Continguous Data layout: [marked (1)][tag (15)][ptr (48)]
+// Continguous Data layout: [marked (1)][frozen (1)][tag (14)][ptr (48)]
 // marked = marked for deletion
+// frozen = the link belongs to a bucket a resize is moving to the next array, it never changes again
 // tag = versioning for CAS (CAS succeeds only if the tag has not changed since the thread last read the location)
 // ptr = pointer to the next node in the linked list
 struct MarkedPtr {
     uint64_t data;
 
-    // Bitshift masks to get the following layout for our contiguous data: [marked (1)][tag (15)][ptr (48)]
+    // Bitshift masks to get the following layout for our contiguous data: [marked (1)][frozen (1)][tag (14)][ptr (48)]
     static constexpr uint64_t kPtrMask = (1ULL << 48) - 1;
-    static constexpr uint64_t kTagMask = (1ULL << 15) - 1;
+    static constexpr uint64_t kTagMask = (1ULL << 14) - 1;
     static constexpr int kTagShift = 48;
+    static constexpr int kFrozenShift = 62;
     static constexpr int kMarkShift = 63;
 
     MarkedPtr() : data(0) {}
@@ -36,12 +41,395 @@ struct MarkedPtr {
     void* ptr() const { return reinterpret_cast<void*>(data & kPtrMask); }
     uint16_t tag() const { return (data >> kTagShift) & kTagMask; }
     bool marked() const { return (data >> kMarkShift) & 0x1; }
+    bool frozen() const { return (data >> kFrozenShift) & 0x1; }
+
+    //@brief The same link with the frozen bit set.
+    MarkedPtr as_frozen() const {
+        MarkedPtr f;
+        f.data = data | (1ULL << kFrozenShift);
+        return f;
+    }
+
+    bool operator==(const MarkedPtr& other) const {
+        return data == other.data;
+    }
 
     bool operator!=(const MarkedPtr& other) const {
         return data != other.data;
     }
 };
 
+// Delay injection for the preemption benchmarks (make lfht_bench_faults).
+// Compiled out unless LFHT_DELAY_INJECTION is defined. The hook runs at the
+// marked points, where a preempted thread leaves work half done for others.
+#ifdef LFHT_DELAY_INJECTION
+enum class DelayPoint {
+    InsertBeforeLink,   // insert: new node prepared, CAS into the chain not yet done
+    RemoveAfterMark,    // remove: node marked, not yet unlinked
+    ResizeMidRehash,    // try_resize: new array published, half of its buckets not moved yet
+};
+inline std::atomic<void (*)(DelayPoint)> lfht_delay_hook{ nullptr };
+#define LFHT_INJECT_DELAY(point) \
+    do { \
+        if (auto hook = lfht_delay_hook.load(std::memory_order_relaxed)) hook(point); \
+    } while (0)
+#else
+#define LFHT_INJECT_DELAY(point) ((void)0)
+#endif
+
+// Operation statistics (make lfht_bench_stats).
+// Compiled out unless LFHT_ENABLE_STATS is defined, stats() then returns an
+// empty snapshot. Counters are per table and kept in cache-line padded slots,
+// one per thread as long as fewer than STATS_SLOTS threads use the table.
+enum class TableStat {
+    FindCalls,          // find_bucket calls
+    FindNodes,          // nodes visited by find_bucket, FindNodes / FindCalls is the mean probe length
+    FindRestarts,       // find_bucket restarts from the bucket head
+    HelpUnlinks,        // marked nodes unlinked by find_bucket on behalf of a remove
+    Probe0,             // find_bucket calls that visited 0, 1, 2-3, 4-7, 8-15, 16-31 and 32+ nodes
+    Probe1,
+    Probe2,
+    Probe4,
+    Probe8,
+    Probe16,
+    Probe32,
+    InsertCalls,
+    InsertStale,        // insert: prev changed between find_bucket and the CAS, retried
+    InsertCasFailures,  // insert: link CAS failed, retried
+    RemoveCalls,
+    RemoveStale,        // remove: node already marked by another remove, retried
+    RemoveCasFailures,  // remove: mark CAS failed, retried
+    UnlinkFailures,     // remove: unlink CAS failed, left to find_bucket
+    ResizeTriggered,    // load factor crossed a limit and try_resize was called
+    ResizePerformed,    // bucket arrays published
+    ResizeContended,    // another thread was already resizing
+    ResizeLost,         // the array had already been replaced when try_resize got to it
+    Scans,              // scan_retired_nodes calls
+    ScanFreed,          // nodes freed by scans
+    ScanKept,           // nodes a scan found protected and put back
+    Count
+};
+
+inline constexpr const char* TABLE_STAT_NAMES[] = {
+    "find_calls", "find_nodes", "find_restarts", "help_unlinks",
+    "probe_0", "probe_1", "probe_2_3", "probe_4_7", "probe_8_15", "probe_16_31", "probe_32",
+    "insert_calls", "insert_stale", "insert_cas_failures",
+    "remove_calls", "remove_stale", "remove_cas_failures", "unlink_failures",
+    "resize_triggered", "resize_performed", "resize_contended", "resize_lost",
+    "scans", "scan_freed", "scan_kept",
+};
+static_assert(sizeof(TABLE_STAT_NAMES) / sizeof(TABLE_STAT_NAMES[0]) == static_cast<size_t>(TableStat::Count),
+    "TABLE_STAT_NAMES must name every TableStat");
+
+// Snapshot of a table's statistics, summed over all threads
+struct TableStats {
+    static constexpr size_t COUNT = static_cast<size_t>(TableStat::Count);
+    bool enabled = false;  // false: built without LFHT_ENABLE_STATS, all values are 0
+    uint64_t values[COUNT] = {};
+
+    uint64_t operator[](TableStat s) const { return values[static_cast<size_t>(s)]; }
+
+    //@brief Ratio of two counters, 0 if the denominator is 0.
+    double ratio(TableStat num, TableStat den) const {
+        return (*this)[den] ? static_cast<double>((*this)[num]) / (*this)[den] : 0.0;
+    }
+
+    //@brief Counts accumulated since an earlier snapshot.
+    TableStats operator-(const TableStats& earlier) const {
+        TableStats d = *this;
+        for (size_t i = 0; i < COUNT; ++i) d.values[i] -= earlier.values[i];
+        return d;
+    }
+};
+
+// One entry of a Space-Saving sketch. count overestimates the true count by at most error.
+template <typename T>
+struct HotItem {
+    T item{};
+    uint64_t count = 0;
+    uint64_t error = 0;
+};
+
+// A bucket of the array it belonged to when a CAS on it failed
+struct BucketId {
+    size_t index = 0;
+    size_t buckets = 0;  // size of that bucket array
+
+    bool operator==(const BucketId& other) const { return index == other.index && buckets == other.buckets; }
+};
+
+// Space-Saving top-k sketch (Metwally, Agrawal, El Abbadi 2005). Keeps the N
+// most frequent items in fixed space; a new item replaces the least counted
+// one and inherits its count as the error bound.
+template <typename T, size_t N>
+struct SpaceSaving {
+    HotItem<T> entries[N];
+    size_t used = 0;
+
+    void observe(const T& item) {
+        size_t min = 0;
+        for (size_t i = 0; i < used; ++i) {
+            if (entries[i].item == item) {
+                entries[i].count++;
+                return;
+            }
+            if (entries[i].count < entries[min].count) min = i;
+        }
+        if (used < N) {
+            entries[used++] = { item, 1, 0 };
+            return;
+        }
+        entries[min] = { item, entries[min].count + 1, entries[min].count };
+    }
+
+    //@brief Add the entries to a merged list, summing the counts of equal items.
+    void merge_into(std::vector<HotItem<T>>& merged) const {
+        for (size_t i = 0; i < used; ++i) {
+            auto it = std::find_if(merged.begin(), merged.end(),
+                [&](const HotItem<T>& m) { return m.item == entries[i].item; });
+            if (it == merged.end()) {
+                merged.push_back(entries[i]);
+            }
+            else {
+                it->count += entries[i].count;
+                it->error += entries[i].error;
+            }
+        }
+    }
+};
+
+// Hot keys and buckets of a table, see LockFreeHashTable::hot_spots()
+template <typename K>
+struct HotSpots {
+    bool enabled = false;          // false: built without LFHT_ENABLE_STATS, the lists are empty
+    uint32_t sample_rate = 0;      // one in sample_rate operations of a thread is counted for keys
+    std::vector<HotItem<K>> keys;  // most used keys, by sampled operations
+    std::vector<HotItem<BucketId>> buckets;  // buckets with the most failed CAS, every failure counted
+};
+
+// Contention of one bucket, see LockFreeHashTable::bucket_contention()
+enum class BucketStat {
+    CasFailures,  // insert, remove and unlink CAS that failed on the bucket, and find_bucket's helping unlinks that failed
+    HelpUnlinks,  // marked nodes find_bucket unlinked on behalf of a remove
+    Retries,      // stale inserts and removes, find_bucket restarts
+    Count
+};
+
+struct BucketContention {
+    static constexpr size_t COUNT = static_cast<size_t>(BucketStat::Count);
+    uint32_t values[COUNT] = {};
+
+    uint32_t operator[](BucketStat s) const { return values[static_cast<size_t>(s)]; }
+};
+
+#ifdef LFHT_ENABLE_STATS
+// Hands out the stats slot of each thread
+inline std::atomic<size_t> lfht_next_stats_slot{ 0 };
+#define LFHT_STAT(stat) record_stat(TableStat::stat, 1)
+#define LFHT_STAT_ADD(stat, n) record_stat(TableStat::stat, (n))
+#define LFHT_HOT_KEY(key) record_hot_key(key)
+#define LFHT_HOT_BUCKET(array, idx) record_hot_bucket((array), (idx))
+#define LFHT_BUCKET_STAT(array, idx, stat) \
+    (array)->contention[(idx) * BucketContention::COUNT + static_cast<size_t>(BucketStat::stat)].fetch_add(1, std::memory_order_relaxed)
+#else
+#define LFHT_STAT(stat) ((void)0)
+#define LFHT_STAT_ADD(stat, n) ((void)(n))
+#define LFHT_HOT_KEY(key) ((void)0)
+#define LFHT_HOT_BUCKET(array, idx) ((void)0)
+#define LFHT_BUCKET_STAT(array, idx, stat) ((void)0)
+#endif
+
+// Event trace (make lfht_bench_stats, --chrome-trace).
+// Compiled out unless LFHT_ENABLE_TRACE is defined. Each thread appends to its
+// own ring of the last LFHT_TRACE_RING_SIZE events and the last 256 resizes.
+// Writing never blocks, a reader only copies the rings when it asks for them
+// with lfht_trace_collect().
+enum class TraceEventType : uint8_t {
+    Resize,        // try_resize moved the buckets: args old size, new size, 1 if published / 0 if lost
+    Scan,          // scan_retired_nodes: args hazard pointers checked, nodes freed, nodes kept
+    RetryStreak,   // one insert or remove retried often: args 0 insert / 1 remove, retries
+    ArrayPublish,  // a new bucket array became current: args new size
+};
+
+// One event as returned by lfht_trace_collect()
+struct TraceEventRecord {
+    TraceEventType type;
+    uint32_t thread;      // numbered in order of first use, a thread that exits hands its ring on
+    const void* table;
+    uint64_t start_ns;    // steady_clock
+    uint64_t duration_ns; // 0 for instant events
+    uint64_t args[3];
+};
+
+#ifdef LFHT_ENABLE_TRACE
+#ifndef LFHT_TRACE_RING_SIZE
+#define LFHT_TRACE_RING_SIZE 2048
+#endif
+static_assert((LFHT_TRACE_RING_SIZE & (LFHT_TRACE_RING_SIZE - 1)) == 0, "LFHT_TRACE_RING_SIZE must be a power of two");
+
+// Single-writer ring buffer. Every slot is a small seqlock so a reader can copy
+// it while the owner overwrites old events, the fields are atomics for the same reason.
+template <size_t N>
+struct TraceBuffer {
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> seq{ 0 };  // odd while being written
+        std::atomic<uint64_t> words[7] = {};
+    };
+    Slot slots[N];
+    std::atomic<uint64_t> head{ 0 };     // events ever written
+
+    void push(TraceEventType type, uint32_t thread, const void* table, uint64_t start_ns, uint64_t duration_ns,
+        uint64_t a0, uint64_t a1, uint64_t a2) {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        Slot& slot = slots[h & (N - 1)];
+        slot.seq.store(2 * h + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        const uint64_t words[7] = { static_cast<uint64_t>(type) | (static_cast<uint64_t>(thread) << 8),
+            reinterpret_cast<uint64_t>(table), start_ns, duration_ns, a0, a1, a2 };
+        for (int i = 0; i < 7; ++i) slot.words[i].store(words[i], std::memory_order_relaxed);
+        slot.seq.store(2 * h + 2, std::memory_order_release);
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    //@brief Copy the events still in the buffer, skipping slots overwritten during the copy.
+    void copy_to(std::vector<TraceEventRecord>& out) const {
+        uint64_t h = head.load(std::memory_order_acquire);
+        uint64_t first = h > N ? h - N : 0;
+        for (uint64_t i = first; i < h; ++i) {
+            const Slot& slot = slots[i & (N - 1)];
+            if (slot.seq.load(std::memory_order_acquire) != 2 * i + 2) continue;
+            uint64_t words[7];
+            for (int w = 0; w < 7; ++w) words[w] = slot.words[w].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.seq.load(std::memory_order_relaxed) != 2 * i + 2) continue;
+            out.push_back({ static_cast<TraceEventType>(words[0] & 0xFF), static_cast<uint32_t>(words[0] >> 8),
+                reinterpret_cast<const void*>(words[1]), words[2], words[3], { words[4], words[5], words[6] } });
+        }
+    }
+};
+
+// The trace of one thread. Resizes are rare and kept apart, so a burst of
+// scans or retry streaks does not push them out.
+struct TraceRing {
+    TraceBuffer<LFHT_TRACE_RING_SIZE> events;
+    TraceBuffer<256> resizes;
+    std::atomic<uint32_t> thread{ 0 };
+    std::atomic<bool> active{ false };
+    TraceRing* next = nullptr;
+
+    void push(TraceEventType type, const void* table, uint64_t start_ns, uint64_t duration_ns,
+        uint64_t a0, uint64_t a1, uint64_t a2) {
+        const uint32_t t = thread.load(std::memory_order_relaxed);
+        if (type == TraceEventType::Resize || type == TraceEventType::ArrayPublish)
+            resizes.push(type, t, table, start_ns, duration_ns, a0, a1, a2);
+        else
+            events.push(type, t, table, start_ns, duration_ns, a0, a1, a2);
+    }
+
+    void copy_to(std::vector<TraceEventRecord>& out) const {
+        resizes.copy_to(out);
+        events.copy_to(out);
+    }
+};
+
+inline std::atomic<TraceRing*> lfht_trace_rings{ nullptr };
+inline std::atomic<uint32_t> lfht_trace_next_thread{ 0 };
+
+// The calling thread's ring, claimed on first use and handed back when the thread exits
+struct TraceRingOwner {
+    TraceRing* ring = nullptr;
+
+    TraceRing& get() {
+        if (ring) return *ring;
+        for (TraceRing* r = lfht_trace_rings.load(std::memory_order_acquire); r; r = r->next) {
+            bool expected = false;
+            if (!r->active.load(std::memory_order_relaxed) &&
+                r->active.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                ring = r;
+                break;
+            }
+        }
+        if (!ring) {
+            ring = new TraceRing();
+            ring->active.store(true, std::memory_order_relaxed);
+            TraceRing* old_head = lfht_trace_rings.load(std::memory_order_relaxed);
+            do {
+                ring->next = old_head;
+            } while (!lfht_trace_rings.compare_exchange_weak(old_head, ring, std::memory_order_release, std::memory_order_relaxed));
+        }
+        ring->thread.store(lfht_trace_next_thread.fetch_add(1, std::memory_order_relaxed), std::memory_order_relaxed);
+        return *ring;
+    }
+
+    ~TraceRingOwner() {
+        if (ring) ring->active.store(false, std::memory_order_release);
+    }
+};
+inline thread_local TraceRingOwner lfht_trace_owner;
+#endif
+
+//@brief Copy the events of all threads, in no particular order.
+//@return The events, empty unless built with LFHT_ENABLE_TRACE.
+inline std::vector<TraceEventRecord> lfht_trace_collect() {
+    std::vector<TraceEventRecord> events;
+#ifdef LFHT_ENABLE_TRACE
+    for (TraceRing* r = lfht_trace_rings.load(std::memory_order_acquire); r; r = r->next) {
+        r->copy_to(events);
+    }
+#endif
+    return events;
+}
+
+// Heap memory owned by a key or value, for memory_usage().
+// 0 unless specialized; specializations for std::basic_string and std::vector are below.
+template <typename T>
+struct HeapSize {
+    static size_t of(const T&) { return 0; }
+};
+
+template <typename C, typename Traits, typename Alloc>
+struct HeapSize<std::basic_string<C, Traits, Alloc>> {
+    static size_t of(const std::basic_string<C, Traits, Alloc>& s) {
+        // An empty string's capacity is the small string buffer, nothing is allocated up to it
+        static const size_t inline_capacity = std::basic_string<C, Traits, Alloc>().capacity();
+        return s.capacity() > inline_capacity ? (s.capacity() + 1) * sizeof(C) : 0;
+    }
+};
+
+template <typename T, typename Alloc>
+struct HeapSize<std::vector<T, Alloc>> {
+    static size_t of(const std::vector<T, Alloc>& v) { return v.capacity() * sizeof(T); }
+};
+
+// Bytes held by a table, see LockFreeHashTable::memory_usage()
+struct MemoryUsage {
+    size_t entries = 0;
+    size_t bucket_array_bytes = 0;       // the current bucket array
+    size_t old_array_bytes = 0;          // arrays replaced by a resize that a thread may still be reading
+    size_t live_node_bytes = 0;          // nodes of the entries, with the heap their K and V own (HeapSize)
+    size_t retired_node_bytes = 0;       // removed or moved by a resize, waiting for a scan; shared by all tables with the same K, V and Hash
+    size_t hazard_record_bytes = 0;      // hazard pointer sets, shared like the retired nodes
+    size_t allocator_slack_bytes = 0;    // estimated malloc headers and rounding of the allocations above
+
+    size_t total() const {
+        return bucket_array_bytes + old_array_bytes + live_node_bytes + retired_node_bytes +
+            hazard_record_bytes + allocator_slack_bytes;
+    }
+
+    //@brief Average bytes per entry, everything included.
+    double bytes_per_entry() const {
+        return entries ? static_cast<double>(total()) / entries : 0.0;
+    }
+};
+
+//@brief Estimated bytes malloc adds to an allocation: an 8 byte header and
+// rounding up to 16 bytes with a 32 byte minimum, as glibc's allocator does.
+//@param bytes The requested size.
+//@return The estimated slack.
+constexpr size_t lfht_alloc_slack(size_t bytes) {
+    return std::max<size_t>(32, (bytes + 8 + 15) & ~size_t(15)) - bytes;
+}
+
 static_assert(sizeof(MarkedPtr) == sizeof(uint64_t), "MarkedPtr must be 64 bits");
 static_assert(std::atomic<MarkedPtr>::is_always_lock_free, "Atomic MarkedPtr not lock-free");
 
@@ -63,15 +451,35 @@ struct Node {
 // Each bucket array contains a vector of atomic MarkedPtr, which points to the head of the linked list
 // Any hashkey that is not unique will be stored in the same bucket
 // The size of the bucket array is determined by the number of buckets
+// An array published by a resize starts with every head not_moved(): its nodes are
+// still in the buckets of prev. The first thread to reach such a bucket moves it
+// (LockFreeHashTable::move_bucket). A moved-from head is frozen, then frozen and
+// marked once the nodes are retired. When every bucket is moved in, prev is
+// cleared and the replaced array freed once no thread holds it.
 template <typename K, typename V>
 struct BucketArray {
     std::vector<std::atomic<MarkedPtr>> buckets;
     const size_t size;
-
-    BucketArray(size_t s) : size(s), buckets(s) {
+    std::atomic<BucketArray*> prev;      // The array this one replaced until all its buckets are moved in, else nullptr
+    BucketArray* next_retired = nullptr; // Link in the table's list of replaced arrays
+#ifdef LFHT_ENABLE_STATS
+    // BucketContention::COUNT counters per bucket, they start at 0 with every array
+    std::unique_ptr<std::atomic<uint32_t>[]> contention;
+    static constexpr size_t BUCKET_BYTES = sizeof(std::atomic<MarkedPtr>) + BucketContention::COUNT * sizeof(std::atomic<uint32_t>);
+#else
+    static constexpr size_t BUCKET_BYTES = sizeof(std::atomic<MarkedPtr>);
+#endif
+
+    // A head is never marked otherwise, so a marked null head means "not moved in yet"
+    static MarkedPtr not_moved() { return MarkedPtr(nullptr, true, 0); }
+
+    BucketArray(size_t s, BucketArray* from = nullptr) : buckets(s), size(s), prev(from) {
         for (auto& head : buckets) {
-            head.store(MarkedPtr(nullptr, false, 0));
+            head.store(from ? not_moved() : MarkedPtr(nullptr, false, 0));
         }
+#ifdef LFHT_ENABLE_STATS
+        contention.reset(new std::atomic<uint32_t>[s * BucketContention::COUNT]());
+#endif
     }
 };
 
@@ -81,14 +489,70 @@ struct BucketArray {
 // Resizing is a flag to indicate if the hash table is currently resizing
 // MIN_BUCKETS is the minimum number of buckets in the hash table to avoid excessive resizing
 // load factor is the ratio of the number of elements to the number of buckets
+// Hash maps a key to a size_t, the bucket index is that value % bucket count.
+// The bucket counts are powers of two, so only the low bits are used (see HashPolicies.hpp)
 
-template <typename K, typename V>
+// Access to the private building blocks for the micro benchmarks (MicroBench.hpp)
+template <typename Table>
+struct TableInternals;
+
+template <typename K, typename V, typename Hash = std::hash<K>>
 class LockFreeHashTable {
+    template <typename Table>
+    friend struct TableInternals;
+
 private:
     std::atomic<BucketArray<K, V>*> current_array;
     std::atomic<size_t> count;
     std::atomic<bool> resizing{ false };
+    // Bucket arrays replaced by a resize, freed by free_unused_arrays() once no
+    // thread's array hazard pointer holds them. Their nodes are retired as the
+    // buckets are moved. Only the thread holding resizing changes the list.
+    std::atomic<BucketArray<K, V>*> old_arrays{ nullptr };
+    std::atomic<size_t> resize_count{ 0 };
+    // Memory accounting, kept up to date by the operations (see memory_usage())
+    std::atomic<size_t> live_heap_bytes{ 0 };          // HeapSize of the live keys and values
+    std::atomic<size_t> old_array_bytes{ 0 };
+    std::atomic<size_t> old_array_count{ 0 };
+#ifdef LFHT_ENABLE_STATS
+    static constexpr size_t HOT_KEYS = 16;         // sketch size per slot
+    static constexpr size_t HOT_BUCKETS = 16;
+    static constexpr uint32_t HOT_SAMPLE_RATE = 16; // count one in 16 operations of a thread for the key sketch
+    struct alignas(64) StatsSlot {
+        std::atomic<uint64_t> values[TableStats::COUNT] = {};
+        // The sketches are guarded by a try-lock: a sample that finds it taken is dropped
+        std::atomic<bool> sketch_busy{ false };
+        SpaceSaving<K, HOT_KEYS> hot_keys;
+        SpaceSaving<BucketId, HOT_BUCKETS> hot_buckets;
+    };
+    static constexpr size_t STATS_SLOTS = 64;
+    std::unique_ptr<StatsSlot[]> stats_slots{ new StatsSlot[STATS_SLOTS] };
+    inline static thread_local size_t stats_slot =
+        lfht_next_stats_slot.fetch_add(1, std::memory_order_relaxed) % STATS_SLOTS;
+    inline static thread_local uint32_t hot_sample_tick = 0;
+
+    void record_stat(TableStat stat, uint64_t n) {
+        // fetch_add because threads beyond STATS_SLOTS share a slot
+        stats_slots[stats_slot].values[static_cast<size_t>(stat)].fetch_add(n, std::memory_order_relaxed);
+    }
+
+    void record_hot_key(const K& key) {
+        if (++hot_sample_tick % HOT_SAMPLE_RATE != 0) return;
+        StatsSlot& slot = stats_slots[stats_slot];
+        if (slot.sketch_busy.exchange(true, std::memory_order_acquire)) return;
+        slot.hot_keys.observe(key);
+        slot.sketch_busy.store(false, std::memory_order_release);
+    }
+
+    void record_hot_bucket(const BucketArray<K, V>* array, size_t idx) {
+        StatsSlot& slot = stats_slots[stats_slot];
+        if (slot.sketch_busy.exchange(true, std::memory_order_acquire)) return;
+        slot.hot_buckets.observe(BucketId{ idx, array->size });
+        slot.sketch_busy.store(false, std::memory_order_release);
+    }
+#endif
     static constexpr size_t MIN_BUCKETS = 64;
+    static constexpr unsigned TRACE_RETRY_STREAK = 8; // retries of one operation that make a RetryStreak event
     static constexpr double UPPER_LOAD_FACTOR = 2.0;
     static constexpr double LOWER_LOAD_FACTOR = 0.25;
     
@@ -97,7 +561,15 @@ private:
         // SMR Types
         struct HazardRecord {
             std::atomic<Node<K, V>*> hazard_pointer{ nullptr };
+            // Record 0: the array the thread works on. Record 1: the array move_bucket copies from
+            std::atomic<BucketArray<K, V>*> hazard_array{ nullptr };
             std::atomic<HazardRecord*> next_pointer{ nullptr };
+            std::atomic<bool> active{ false }; // Owned by a live thread (only used in the first record of a set)
+        };
+
+        // Hands the thread's hazard pointers back for reuse when the thread exits
+        struct HazardRelease {
+            ~HazardRelease() { release_thread_hp(); }
         };
 
         static constexpr int HP_COUNT_PER_THREAD = 3;
@@ -105,15 +577,19 @@ private:
 
         // One set of hazard pointers per thread
         inline static thread_local HazardRecord* hp_records{ nullptr };
-        inline static thread_local int hazard_pointer_index = -1;
+        inline static thread_local HazardRelease hp_release;
 
         // List of retired nodes for safe memory reclamation
         static std::atomic<Node<K, V>*> retired_list;
         static std::atomic<size_t> retired_count;
+        inline static std::atomic<size_t> retired_heap_bytes{ 0 };  // HeapSize of the retired keys and values
+        inline static std::atomic<size_t> hp_set_count{ 0 };
 
         // SMR management functions
-        void init_thread_hp();
+        static void init_thread_hp();
+        static void release_thread_hp();
         void retire_node(Node<K, V>* node);
+        static void push_retired(Node<K, V>* node);
         void scan_retired_nodes();
         void free_retired_node(Node<K, V>* node);  // Optionally implement this
 
@@ -124,8 +600,10 @@ public:
 
     ~LockFreeHashTable() {
         scan_retired_nodes(); // Clean up retired nodes
-        // Clean up the current array
+        // Clean up the current array and the nodes still linked in it
+        free_array_nodes(current_array.load());
         delete current_array.load();
+        free_old_arrays();
     }
 
     //@brief Inserts a key-value pair into the hash table.
@@ -134,17 +612,27 @@ public:
     //@return true if the insertion was successful, false if the key already exists.
     //@note This function may trigger a resize if the load factor exceeds the upper limit.
     bool insert(K key, V value) {
+        LFHT_STAT(InsertCalls);
+        LFHT_HOT_KEY(key);
+        // Allocated once, a failed CAS retries with the same node
+        Node<K, V>* new_node = new Node<K, V>(key, value);
+        // Measured now: once linked, another thread may remove and free the node
+        const size_t new_heap = node_heap_size(new_node);
+        unsigned retries = 0;
         while (true) {
-            BucketArray<K, V>* array = current_array.load();
+            BucketArray<K, V>* array = protect_array_reclaiming();
             size_t idx = hash(key, array->size);
-            Node<K, V>* new_node = new Node<K, V>(key, value);
 
             // auto = std::pair<std::atomic<MarkedPtr>*, Node<K, V>*>
             auto [prev_nextPtr, curr] = find_bucket(array, idx, key);
+            // The bucket is being moved to a newer array, retry there
+            if (!prev_nextPtr) continue;
 
-            // Key exists, do "nothing" (deallocate new_node first). TODO: MemoryPool or Freelist this instead. (Lane: Look into SMR)
+            // Key exists, do "nothing". new_node was never linked, so no other thread can see it
+            // and it is deleted right away instead of retired.
             if (curr && curr->key == key) {
                 delete new_node;
+                trace_retries(0, retries);
                 return false;
             }
 
@@ -154,58 +642,100 @@ public:
             // Prepare CAS
             // Get next pointer of prev_ptr
             MarkedPtr expected = prev_nextPtr->load();
-            // if prev_ptr is marked for deletion
+            // if prev_ptr is marked for deletion, frozen by a resize
             // or if the next pointer of prev_ptr is not curr
-            if (expected.marked() || get_node(expected) != curr) continue; 
+            if (expected.marked() || expected.frozen() || get_node(expected) != curr) {
+                LFHT_STAT(InsertStale);
+                LFHT_BUCKET_STAT(array, idx, Retries);
+                retries++;
+                continue;
+            }
 
             MarkedPtr desired = MarkedPtr(new_node, false, expected.tag() + 1);
+            LFHT_INJECT_DELAY(DelayPoint::InsertBeforeLink);
             if (prev_nextPtr->compare_exchange_strong(expected, desired)) {
                 size_t c = count.fetch_add(1, std::memory_order_relaxed) + 1;
+                if (new_heap) live_heap_bytes.fetch_add(new_heap, std::memory_order_relaxed);
                 // if current load factor is above the upper limit
                 // try to resize the array to double its size
                 if (static_cast<double>(c) / array->size > UPPER_LOAD_FACTOR) {
+                    LFHT_STAT(ResizeTriggered);
                     try_resize(array, array->size * 2);
                 }
+                trace_retries(0, retries);
                 return true;
             }
+            LFHT_STAT(InsertCasFailures);
+            LFHT_HOT_BUCKET(array, idx);
+            LFHT_BUCKET_STAT(array, idx, CasFailures);
+            retries++;
         }
     }
 
     bool remove(K key) {
+        LFHT_STAT(RemoveCalls);
+        LFHT_HOT_KEY(key);
+        unsigned retries = 0;
         while (true) {
-            BucketArray<K, V>* array = current_array.load();
+            BucketArray<K, V>* array = protect_array_reclaiming();
             size_t idx = hash(key, array->size);
 
             auto [prev_ptr, curr] = find_bucket(array, idx, key);
+            // The bucket is being moved to a newer array, retry there
+            if (!prev_ptr) continue;
             // node does not exist or have been changed
-            if (!curr || curr->key != key) return false;
+            if (!curr || curr->key != key) {
+                trace_retries(1, retries);
+                return false;
+            }
 
             // Try to mark node
             MarkedPtr curr_next = curr->next.load();
-            if (curr_next.marked()) continue;
+            if (curr_next.marked() || curr_next.frozen()) {
+                LFHT_STAT(RemoveStale);
+                LFHT_BUCKET_STAT(array, idx, Retries);
+                retries++;
+                continue;
+            }
 
             // Prepare CAS
             // Mark the current node as deleted
             // and increment the tag
             MarkedPtr desired_marked = MarkedPtr(curr_next.ptr(), true, curr_next.tag() + 1);
-            if (!curr->next.compare_exchange_strong(curr_next, desired_marked)) continue;
+            if (!curr->next.compare_exchange_strong(curr_next, desired_marked)) {
+                LFHT_STAT(RemoveCasFailures);
+                LFHT_HOT_BUCKET(array, idx);
+                LFHT_BUCKET_STAT(array, idx, CasFailures);
+                retries++;
+                continue;
+            }
+            LFHT_INJECT_DELAY(DelayPoint::RemoveAfterMark);
+            if (size_t heap = node_heap_size(curr)) live_heap_bytes.fetch_sub(heap, std::memory_order_relaxed);
 
-            // Check if the previous node is marked for deletion
-            // and if the next pointer of the previous node is not curr
+            // The key is now logically removed. Physically unlink it, or let
+            // find_bucket unlink (and retire) it if prev changed under us.
+            // A frozen prev is left alone: move_bucket skips and retires the node.
             MarkedPtr prev_expected = prev_ptr->load();
-            if (prev_expected.marked() || get_node(prev_expected) != curr) continue;
-
-            // Physically remove
             MarkedPtr prev_desired = MarkedPtr(curr_next.ptr(), false, prev_expected.tag() + 1);
-            if (prev_ptr->compare_exchange_strong(prev_expected, prev_desired)) {
+            if (!prev_expected.marked() && !prev_expected.frozen() && get_node(prev_expected) == curr &&
+                prev_ptr->compare_exchange_strong(prev_expected, prev_desired)) {
                 retire_node(curr); // SMR
-                // Decrement the count
-                size_t c = count.fetch_sub(1, std::memory_order_relaxed) - 1;
-                if (static_cast<double>(c) / array->size < LOWER_LOAD_FACTOR) {
-                    try_resize(array, std::max(MIN_BUCKETS, array->size / 2));
-                }
-                return true;
             }
+            else {
+                LFHT_STAT(UnlinkFailures);
+                LFHT_HOT_BUCKET(array, idx);
+                LFHT_BUCKET_STAT(array, idx, CasFailures);
+                find_bucket(array, idx, key);
+            }
+
+            // Decrement the count
+            size_t c = count.fetch_sub(1, std::memory_order_relaxed) - 1;
+            if (static_cast<double>(c) / array->size < LOWER_LOAD_FACTOR) {
+                LFHT_STAT(ResizeTriggered);
+                try_resize(array, std::max(MIN_BUCKETS, array->size / 2));
+            }
+            trace_retries(1, retries);
+            return true;
         }
     }
 
@@ -213,17 +743,214 @@ public:
     //@param key The key to check.
     //@return true if the key exists, false otherwise.
     bool contains(K key) {
-        BucketArray<K, V>* array = current_array.load();
-        size_t idx = hash(key, array->size);
-        auto [prev_ptr, curr] = find_bucket(array, idx, key);
-        return (curr && curr->key == key);
+        LFHT_HOT_KEY(key);
+        while (true) {
+            BucketArray<K, V>* array = protect_array();
+            size_t idx = hash(key, array->size);
+            auto [prev_ptr, curr] = find_bucket(array, idx, key);
+            if (prev_ptr) return (curr && curr->key == key);
+        }
     }
 
 	// @brief Get the current bucket size.
 	// @return The current bucket size.
-    size_t getBucketSize()
+    size_t getBucketSize() const
+    {
+        const size_t size = protect_array()->size;
+        release_array();
+        return size;
+    }
+
+	// @brief Get the number of keys in the table.
+	// @return The element count maintained by insert and remove, 0 while a
+	// remove has counted itself before the insert it undoes.
+    size_t getCount() const
+    {
+        return clamped(count);
+    }
+
+	// @brief Get the number of resizes performed since construction.
+	// @return The number of bucket arrays published by try_resize.
+    size_t getResizeCount() const
+    {
+        return resize_count.load(std::memory_order_relaxed);
+    }
+
+	// @brief Get the number of retired nodes waiting to be freed.
+	// @return The retired node count, shared by all tables with the same K and V.
+    static size_t getRetiredCount()
+    {
+        return retired_count.load(std::memory_order_relaxed);
+    }
+
+	// @brief Get the number of hazard pointer sets ever allocated.
+	// @return One set per thread that was using a table with the same K and V at the same time.
+    static size_t getHazardRecordCount()
+    {
+        return hp_set_count.load(std::memory_order_relaxed);
+    }
+
+	// @brief Get the memory held by the table, from counters the operations
+	// maintain, without walking the table.
+	// @return The bytes by category, see MemoryUsage.
+    MemoryUsage memory_usage() const
+    {
+        using Array = BucketArray<K, V>;
+        MemoryUsage m;
+        const size_t nodes = clamped(count);
+        const size_t retired = retired_count.load(std::memory_order_relaxed);
+        const size_t hp_sets = hp_set_count.load(std::memory_order_relaxed);
+        const size_t arrays = old_array_count.load(std::memory_order_relaxed);
+        const size_t buckets = protect_array()->size;
+        release_array();
+
+        m.entries = nodes;
+        m.bucket_array_bytes = sizeof(Array) + buckets * Array::BUCKET_BYTES;
+        m.old_array_bytes = old_array_bytes.load(std::memory_order_relaxed);
+        m.live_node_bytes = nodes * sizeof(Node<K, V>) + clamped(live_heap_bytes);
+        m.retired_node_bytes = retired * sizeof(Node<K, V>) + retired_heap_bytes.load(std::memory_order_relaxed);
+        m.hazard_record_bytes = hp_sets * HP_COUNT_PER_THREAD * sizeof(HazardRecord);
+        m.allocator_slack_bytes =
+            (nodes + retired) * lfht_alloc_slack(sizeof(Node<K, V>)) +
+            hp_sets * lfht_alloc_slack(HP_COUNT_PER_THREAD * sizeof(HazardRecord)) +
+            lfht_alloc_slack(sizeof(Array)) + lfht_alloc_slack(buckets * sizeof(std::atomic<MarkedPtr>)) +
+            arrays * (lfht_alloc_slack(sizeof(Array)) + 16);  // the old arrays' buffers, roughly
+        return m;
+    }
+
+	// @brief Get the operation statistics of this table.
+	// @return Counters summed over all threads, all 0 unless built with LFHT_ENABLE_STATS.
+    TableStats stats() const
+    {
+        TableStats snapshot;
+#ifdef LFHT_ENABLE_STATS
+        snapshot.enabled = true;
+        for (size_t slot = 0; slot < STATS_SLOTS; ++slot) {
+            for (size_t i = 0; i < TableStats::COUNT; ++i) {
+                snapshot.values[i] += stats_slots[slot].values[i].load(std::memory_order_relaxed);
+            }
+        }
+#endif
+        return snapshot;
+    }
+
+	// @brief Get the most used keys and the buckets with the most failed CAS,
+	// from per-thread Space-Saving sketches merged at the time of the call.
+	// @param top Number of keys and buckets to return at most.
+	// @return The hot spots since construction, empty unless built with LFHT_ENABLE_STATS.
+    HotSpots<K> hot_spots(size_t top = 10) const
+    {
+        HotSpots<K> spots;
+#ifdef LFHT_ENABLE_STATS
+        spots.enabled = true;
+        spots.sample_rate = HOT_SAMPLE_RATE;
+        for (size_t i = 0; i < STATS_SLOTS; ++i) {
+            StatsSlot& slot = stats_slots[i];
+            while (slot.sketch_busy.exchange(true, std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            slot.hot_keys.merge_into(spots.keys);
+            slot.hot_buckets.merge_into(spots.buckets);
+            slot.sketch_busy.store(false, std::memory_order_release);
+        }
+        auto by_count = [](const auto& a, const auto& b) { return a.count > b.count; };
+        std::sort(spots.keys.begin(), spots.keys.end(), by_count);
+        std::sort(spots.buckets.begin(), spots.buckets.end(), by_count);
+        if (spots.keys.size() > top) spots.keys.resize(top);
+        if (spots.buckets.size() > top) spots.buckets.resize(top);
+#else
+        (void)top;
+#endif
+        return spots;
+    }
+
+	// @brief Get the contention counters of every bucket of the current array.
+	// A resize publishes an array with new counters, all 0.
+	// @return One entry per bucket, empty unless built with LFHT_ENABLE_STATS.
+    std::vector<BucketContention> bucket_contention() const
+    {
+        std::vector<BucketContention> buckets;
+#ifdef LFHT_ENABLE_STATS
+        const BucketArray<K, V>* array = protect_array();
+        buckets.resize(array->size);
+        for (size_t i = 0; i < array->size; ++i) {
+            for (size_t s = 0; s < BucketContention::COUNT; ++s) {
+                buckets[i].values[s] = array->contention[i * BucketContention::COUNT + s].load(std::memory_order_relaxed);
+            }
+        }
+        release_array();
+#endif
+        return buckets;
+    }
+
+	// @brief Count the live nodes of every bucket, walking the current bucket
+	// array under hazard pointers while other threads keep working.
+	// @param max_length Chains of this length or longer share the last bin.
+	// @return histogram[l] = buckets with l live nodes, max_length + 1 bins.
+    std::vector<size_t> chain_length_histogram(size_t max_length = 16)
     {
-        return current_array.load()->size;
+        std::vector<size_t> histogram;
+        bool complete = false;
+        while (!complete) {
+            BucketArray<K, V>* array = protect_array();
+            histogram.assign(max_length + 1, 0);
+            complete = true;
+            for (size_t i = 0; i < array->size && complete; ++i) {
+                size_t length = 0;
+                complete = walk_bucket_retrying(array, i, [&] { length = 0; },
+                    [&](const Node<K, V>&, bool marked) { length += marked ? 0 : 1; });
+                histogram[std::min(length, max_length)]++;
+            }
+        }
+        release_array();
+        return histogram;
+    }
+
+	// @brief Count the nodes of every bucket of the current array and copy the
+	// nodes of one, walking it under hazard pointers while other threads keep
+	// working. Every bucket is a chain that existed at some point of the walk,
+	// but the buckets are not read at the same instant.
+	// @param live Receives live[b] = unmarked nodes of bucket b. Its capacity is reused.
+	// @param marked Receives the marked nodes of all buckets, removed but not unlinked yet.
+	// @param selected The bucket to copy, none if it is not below the bucket count.
+	// @param nodes Receives (key, value, marked) of the nodes of the selected bucket, in chain order.
+    template <typename Count>
+    void sample_buckets(std::vector<Count>& live, size_t& marked, size_t selected, std::vector<std::tuple<K, V, bool>>& nodes)
+    {
+        bool complete = false;
+        while (!complete) {
+            BucketArray<K, V>* array = protect_array();
+            live.assign(array->size, Count(0));
+            marked = 0;
+            nodes.clear();
+            complete = true;
+            for (size_t i = 0; i < array->size && complete; ++i) {
+                size_t active = 0;
+                size_t removed = 0;
+                const bool copy = i == selected;
+                complete = walk_bucket_retrying(array, i,
+                    [&] {
+                        active = removed = 0;
+                        if (copy) nodes.clear();
+                    },
+                    [&](const Node<K, V>& node, bool is_marked) {
+                        ++(is_marked ? removed : active);
+                        if (copy) nodes.emplace_back(node.key, node.value, is_marked);
+                    });
+                live[i] = static_cast<Count>(active);
+                marked += removed;
+            }
+        }
+        release_array();
+    }
+
+	// @brief Get the bucket a key belongs to in an array of a given size.
+	// @param key The key.
+	// @param size The bucket count, e.g. of a sample_buckets() result.
+	// @return The bucket index.
+    size_t bucket_of(const K& key, size_t size) const
+    {
+        return hash(key, size);
     }
 
 	// @brief Re-initialize the hash table.
@@ -231,18 +958,11 @@ public:
     void reset() {
         BucketArray<K, V>* old_array = current_array.exchange(new BucketArray<K, V>(MIN_BUCKETS));
         count.store(0);
+        live_heap_bytes.store(0);
 
-        // Walk through old buckets and delete nodes
-        for (auto& head : old_array->buckets) {
-            Node<K, V>* curr = get_node(head.load());
-            while (curr) {
-                Node<K, V>* next = get_node(curr->next.load());
-                delete curr;
-                curr = next;
-            }
-        }
-
+        free_array_nodes(old_array);
         delete old_array;
+        free_old_arrays();
     }
 private:
     //@brief Hash function to map a key to an index in the bucket array.
@@ -250,7 +970,7 @@ private:
     //@param size The size of the bucket array.
     //@return The index in the bucket array.
     size_t hash(K key, size_t size) const {
-        return std::hash<K>{}(key) % size;
+        return Hash{}(key) % size;
     }
 
     //@brief Get the node from a MarkedPtr.
@@ -260,137 +980,559 @@ private:
         return static_cast<Node<K, V>*>(mp.ptr());
     }
 
+    //@brief Read a counter insert and remove update after their CAS. A remove
+    //can update it before the insert it undoes, leaving it below 0 for a moment.
+    //@param counter count or live_heap_bytes.
+    //@return The counter, 0 while it is below 0.
+    static size_t clamped(const std::atomic<size_t>& counter) {
+        const size_t value = counter.load(std::memory_order_relaxed);
+        return static_cast<int64_t>(value) < 0 ? 0 : value;
+    }
+
+    //@brief Get the current bucket array and keep it from being freed: the
+    //thread's array hazard pointer holds it until the thread takes another.
+    //@return The current bucket array.
+    BucketArray<K, V>* protect_array() const {
+        init_thread_hp();
+        BucketArray<K, V>* array = current_array.load();
+        while (true) {
+            hp_records[0].hazard_array.store(array, std::memory_order_seq_cst);
+            BucketArray<K, V>* again = current_array.load();
+            if (again == array) return array;
+            array = again;
+        }
+    }
+
+    //@brief Drop the array protect_array() took. Readers that do not come back
+    //soon call it, so an idle observer does not keep a replaced array alive.
+    void release_array() const {
+        hp_records[0].hazard_array.store(nullptr, std::memory_order_release);
+    }
+
+    //@brief protect_array() for insert and remove. A thread moving off a replaced
+    //array frees the replaced arrays no thread holds any more: a resize frees
+    //only those unheld when it ends, and the last resize of a run has no later
+    //one to free the arrays threads were still on.
+    //@return The current bucket array.
+    BucketArray<K, V>* protect_array_reclaiming() {
+        init_thread_hp();
+        BucketArray<K, V>* before = hp_records[0].hazard_array.load(std::memory_order_relaxed);
+        BucketArray<K, V>* array = protect_array();
+        if (before && before != array && old_arrays.load(std::memory_order_relaxed) && !resizing.exchange(true)) {
+            free_unused_arrays();
+            resizing.store(false);
+        }
+        return array;
+    }
+
+    //@brief Get the array an array's buckets are moved in from, and keep it
+    //from being freed while move_bucket copies from it.
+    //@param array A protected array.
+    //@return array->prev, nullptr once every bucket is moved in.
+    BucketArray<K, V>* protect_prev(BucketArray<K, V>* array) const {
+        BucketArray<K, V>* from = array->prev.load();
+        while (from) {
+            hp_records[1].hazard_array.store(from, std::memory_order_seq_cst);
+            BucketArray<K, V>* again = array->prev.load();
+            if (again == from) break;
+            from = again;
+        }
+        return from;
+    }
+
     //@brief Find the bucket for a given key in the bucket array.
     //@param array The bucket array to search in.
     //@param idx The index of the bucket to search in.
     //@param key The key to search for.
     //@return A pair containing the pointer to the previous node and the current node.
+    // { nullptr, nullptr } if the bucket is frozen: the array was replaced, retry on the current one.
     std::pair<std::atomic<MarkedPtr>*, Node<K, V>*>
         find_bucket(BucketArray<K, V>* array, size_t idx, K key)
     {
 
 
+        // Get the thread's hazard pointers
+        init_thread_hp();
+        LFHT_STAT(FindCalls);
+        size_t visited = 0;
+
+    try_again:
         std::atomic<MarkedPtr>* prev_nextPtr = &array->buckets[idx];
-        Node<K, V>* curr = get_node(prev_nextPtr->load());
+        MarkedPtr prev_val = prev_nextPtr->load();
+        if (prev_val == BucketArray<K, V>::not_moved()) {
+            move_bucket(array, idx);
+            goto try_again;
+        }
+        // Links are frozen from the head down, a frozen link further on
+        // also fails the validation below and lands here
+        if (prev_val.frozen()) {
+            record_probe(visited);
+            return { nullptr, nullptr };
+        }
+        Node<K, V>* curr = get_node(prev_val);
         Node<K, V>* next_node = nullptr;
 
-        // Initialize hazard pointer index
-        init_thread_hp();
-        hp_records[0].hazard_pointer.store(next_node, std::memory_order_release);    // hp0
-        hp_records[1].hazard_pointer.store(curr, std::memory_order_release);         // hp1
-        hp_records[2].hazard_pointer.store(get_node(prev_nextPtr->load()), std::memory_order_release); // hp2
+        // SMR
+        // Publish curr (hp1), then verify it is still linked before touching it
+        hp_records[1].hazard_pointer.store(curr, std::memory_order_seq_cst);
+        if (prev_nextPtr->load() != prev_val || prev_val.marked()) {
+            LFHT_STAT(FindRestarts);
+            LFHT_BUCKET_STAT(array, idx, Retries);
+            goto try_again;
+        }
 
         while (true) {
-            if (!curr) return { prev_nextPtr, nullptr };
+            if (!curr) {
+                record_probe(visited);
+                return { prev_nextPtr, nullptr };
+            }
 
             MarkedPtr curr_nextPtr = curr->next.load();
             next_node = get_node(curr_nextPtr);
+            visited++;
 
-            // SMR
             // Protect next_node first (hp0)
-            hp_records[0].hazard_pointer.store(next_node, std::memory_order_release);
-            // Verify nothing changed
-            if (curr->next.load() != curr_nextPtr) {
-                curr = get_node(prev_nextPtr->load());
-                continue;
+            hp_records[0].hazard_pointer.store(next_node, std::memory_order_seq_cst);
+            // Verify nothing changed: curr must still be linked from prev, and its next unchanged
+            if (prev_nextPtr->load() != prev_val || curr->next.load() != curr_nextPtr) {
+                LFHT_STAT(FindRestarts);
+                LFHT_BUCKET_STAT(array, idx, Retries);
+                goto try_again;
             }
 
             // Remove pointers to current marked node
-            // Will be freed in next Remove call.
+            // Only the thread whose CAS unlinks the node retires it.
+            // The CAS fails on a frozen prev and the restart returns.
             if (curr_nextPtr.marked()) {
-                MarkedPtr expected_curr = prev_nextPtr->load();
-                if (expected_curr.marked() || get_node(expected_curr) != curr) {
-                    prev_nextPtr = &array->buckets[idx];
-                    curr = get_node(prev_nextPtr->load());
-                    continue;
+                MarkedPtr desired = MarkedPtr(next_node, false, prev_val.tag() + 1);
+                if (!prev_nextPtr->compare_exchange_strong(prev_val, desired)) {
+                    LFHT_STAT(FindRestarts);
+                    LFHT_HOT_BUCKET(array, idx);
+                    LFHT_BUCKET_STAT(array, idx, CasFailures);
+                    goto try_again;
                 }
-
-                MarkedPtr desired = MarkedPtr(next_node, false, expected_curr.tag() + 1);
-                prev_nextPtr->compare_exchange_strong(expected_curr, desired);
+                LFHT_STAT(HelpUnlinks);
+                LFHT_BUCKET_STAT(array, idx, HelpUnlinks);
                 retire_node(curr); // SMR
-                curr = next_node;
-                continue;
+                prev_val = desired;
             }
+            else {
+                if (curr->key >= key) {
+                    record_probe(visited);
+                    return { prev_nextPtr, curr };
+                }
 
-            if (curr->key >= key) return { prev_nextPtr, curr };
+                hp_records[2].hazard_pointer.store(curr, std::memory_order_release);
+                prev_nextPtr = &curr->next;
+                prev_val = curr_nextPtr;
+            }
 
-            hp_records[2].hazard_pointer.store(curr, std::memory_order_release);
-            prev_nextPtr = &curr->next;
             hp_records[1].hazard_pointer.store(next_node, std::memory_order_release);
             curr = next_node;
         }
     }
 
+    //@brief Count the nodes one find_bucket call visited, restarts included.
+    //@param visited The node count.
+    void record_probe(size_t visited) {
+#ifdef LFHT_ENABLE_STATS
+        record_stat(TableStat::FindNodes, visited);
+        size_t bin = 0;
+        while (bin < 6 && (size_t(1) << bin) <= visited) bin++;
+        record_stat(static_cast<TableStat>(static_cast<size_t>(TableStat::Probe0) + bin), 1);
+#else
+        (void)visited;
+#endif
+    }
+
+    //@brief Heap memory owned by a node's key and value.
+    static size_t node_heap_size(const Node<K, V>* node) {
+        return HeapSize<K>::of(node->key) + HeapSize<V>::of(node->value);
+    }
+
+    //@brief Current time for trace events.
+    //@return steady_clock nanoseconds, 0 unless built with LFHT_ENABLE_TRACE.
+    static uint64_t trace_now() {
+#ifdef LFHT_ENABLE_TRACE
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#else
+        return 0;
+#endif
+    }
+
+    //@brief Append an event to the calling thread's trace ring.
+    void trace_event(TraceEventType type, uint64_t start_ns, uint64_t end_ns,
+        uint64_t a0 = 0, uint64_t a1 = 0, uint64_t a2 = 0) const {
+#ifdef LFHT_ENABLE_TRACE
+        lfht_trace_owner.get().push(type, this, start_ns, end_ns - start_ns, a0, a1, a2);
+#else
+        (void)type; (void)start_ns; (void)end_ns; (void)a0; (void)a1; (void)a2;
+#endif
+    }
+
+    //@brief Trace an insert or remove that needed TRACE_RETRY_STREAK retries or more.
+    //@param op 0 insert, 1 remove.
+    //@param retries Retries of the operation.
+    void trace_retries(uint64_t op, unsigned retries) const {
+#ifdef LFHT_ENABLE_TRACE
+        if (retries >= TRACE_RETRY_STREAK) {
+            uint64_t now = trace_now();
+            trace_event(TraceEventType::RetryStreak, now, now, op, retries);
+        }
+#else
+        (void)op; (void)retries;
+#endif
+    }
+
     //@brief Resize the hash table to a new size
     //@param old_array The old bucket array to resize
     //@param new_size The new size for the bucket array
-    //@note Only fails if resizing is happening or has happened
+    //@note Only fails if resizing is happening or has happened.
+    //The new array is published first with no bucket moved in yet, then this
+    //thread moves them in order. Operations that reach a bucket first move it
+    //themselves, so writes made during the resize go to the new array.
     void try_resize(BucketArray<K, V>* old_array, size_t new_size) {
         // if already resized, return
         if (new_size == old_array->size) return;
         // Check if resizing is already in progress
         if (!resizing.exchange(true)) {
-            BucketArray<K, V>* new_array = new BucketArray<K, V>(new_size);
-
-            for (size_t i = 0; i < old_array->size; ++i) {
-                rehash_bucket(old_array, new_array, i);
-            }
+            const uint64_t start_ns = trace_now();
+            const size_t old_size = old_array->size;
+            // The previous resize moved all of old_array's buckets before it
+            // cleared the flag, so old_array is complete and can be the source
+            BucketArray<K, V>* new_array = new BucketArray<K, V>(new_size, old_array);
 
             if (current_array.compare_exchange_strong(old_array, new_array)) {
-                delete old_array; // TODO: Hazard pointer implementation with this? (Lane: Look into SMR)
+                resize_count.fetch_add(1, std::memory_order_relaxed);
+                LFHT_STAT(ResizePerformed);
+                const uint64_t published_ns = trace_now();
+                trace_event(TraceEventType::ArrayPublish, published_ns, published_ns, new_size);
+
+                for (size_t i = 0; i < new_size; ++i) {
+                    if (i == new_size / 2) LFHT_INJECT_DELAY(DelayPoint::ResizeMidRehash);
+                    if (new_array->buckets[i].load() == BucketArray<K, V>::not_moved()) {
+                        move_bucket(new_array, i);
+                    }
+                }
+                // Nothing reaches old_array through new_array any more
+                new_array->prev.store(nullptr);
+                retire_array(old_array);
+                free_unused_arrays();
+                scan_retired_nodes(); // Free the moved nodes no thread is reading
+                trace_event(TraceEventType::Resize, start_ns, trace_now(), old_size, new_size, 1);
             }
             else {
+                LFHT_STAT(ResizeLost);
                 delete new_array;
+                trace_event(TraceEventType::Resize, start_ns, trace_now(), old_size, new_size, 0);
             }
             resizing.store(false);
         }
+        else {
+            LFHT_STAT(ResizeContended);
+        }
     }
 
-    //@brief Rehash the bucket at the given index from the old array to the new array
-    //@param old_array The old bucket array to rehash from
-    //@param new_array The new bucket array to rehash to
-    void rehash_bucket(BucketArray<K, V>* old_array,
-        BucketArray<K, V>* new_array,
-        size_t old_idx)
-    {
-        auto& old_head = old_array->buckets[old_idx];
-        Node<K, V>* curr = get_node(old_head.load());
+    //@brief Delete every node linked in a bucket array.
+    //Marked heads are skipped: a bucket not moved in yet has its nodes in the
+    //array it replaces, and a moved-out bucket's nodes were retired.
+    //@param array The bucket array to walk.
+    //@note Only safe when no other thread is using the array.
+    void free_array_nodes(BucketArray<K, V>* array) {
+        for (auto& head : array->buckets) {
+            MarkedPtr head_val = head.load();
+            if (head_val.marked()) continue;
+            Node<K, V>* curr = get_node(head_val);
+            while (curr) {
+                Node<K, V>* next = get_node(curr->next.load());
+                delete curr;
+                curr = next;
+            }
+        }
+    }
+
+    //@brief Add a replaced bucket array to the ones free_unused_arrays() frees.
+    //@param array The bucket array that is no longer current, with all its buckets moved out.
+    void retire_array(BucketArray<K, V>* array) {
+        old_array_bytes.fetch_add(sizeof(BucketArray<K, V>) + array->size * BucketArray<K, V>::BUCKET_BYTES, std::memory_order_relaxed);
+        old_array_count.fetch_add(1, std::memory_order_relaxed);
+        BucketArray<K, V>* old_head = old_arrays.load(std::memory_order_relaxed);
+        do {
+            array->next_retired = old_head;
+        } while (!old_arrays.compare_exchange_weak(old_head, array, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    //@brief Free the replaced bucket arrays no array hazard pointer holds. Every
+    //bucket of them was moved out, so they hold no nodes.
+    //@note Only called by the thread holding resizing, the one that retires arrays.
+    //protect_array_reclaiming() takes the flag for it too.
+    void free_unused_arrays() {
+        std::unordered_set<const BucketArray<K, V>*> held;
+        for (HazardRecord* r = hp_head.load(std::memory_order_acquire); r;
+            r = r[HP_COUNT_PER_THREAD - 1].next_pointer.load(std::memory_order_acquire)) {
+            for (int i = 0; i < HP_COUNT_PER_THREAD; ++i) {
+                if (BucketArray<K, V>* array = r[i].hazard_array.load(std::memory_order_seq_cst)) held.insert(array);
+            }
+        }
+
+        BucketArray<K, V>* array = old_arrays.exchange(nullptr);
+        BucketArray<K, V>* kept = nullptr;
+        while (array) {
+            BucketArray<K, V>* next = array->next_retired;
+            if (held.count(array)) {
+                array->next_retired = kept;
+                kept = array;
+            }
+            else {
+                old_array_bytes.fetch_sub(sizeof(BucketArray<K, V>) + array->size * BucketArray<K, V>::BUCKET_BYTES, std::memory_order_relaxed);
+                old_array_count.fetch_sub(1, std::memory_order_relaxed);
+                delete array;
+            }
+            array = next;
+        }
+        old_arrays.store(kept);
+    }
+
+    //@brief Free all bucket arrays replaced by a resize, with the nodes of
+    //buckets a resize froze but did not finish moving.
+    //@note Only safe when no other thread is using the table.
+    void free_old_arrays() {
+        BucketArray<K, V>* array = old_arrays.exchange(nullptr);
+        old_array_bytes.store(0, std::memory_order_relaxed);
+        old_array_count.store(0, std::memory_order_relaxed);
+        while (array) {
+            BucketArray<K, V>* next = array->next_retired;
+            free_array_nodes(array);
+            delete array;
+            array = next;
+        }
+    }
+
+    //@brief Visit the nodes of one bucket without changing it.
+    //Marked nodes are reported, not unlinked. The walk keeps the link of the last
+    //unmarked node it passed (the anchor): marked nodes never change their next
+    //pointer, so while the anchor is unchanged every node after it is still linked,
+    //and a linked node is not retired once its hazard pointer is published.
+    //A bucket not moved in yet is moved first.
+    //@param array The bucket array to walk.
+    //@param idx The index of the bucket.
+    //@param visit Called as visit(node, marked) for every node, in chain order.
+    //@return false if the chain changed under the walk; the caller drops what it saw and walks again.
+    //A frozen bucket also returns false: the array was replaced, see walk_bucket_retrying.
+    template <typename Visit>
+    bool walk_bucket(BucketArray<K, V>* array, size_t idx, Visit&& visit) {
+        init_thread_hp();
+        std::atomic<MarkedPtr>* anchor = &array->buckets[idx];
+        MarkedPtr anchor_val = anchor->load();
+        if (anchor_val == BucketArray<K, V>::not_moved()) {
+            move_bucket(array, idx);
+            anchor_val = anchor->load();
+        }
+        if (anchor_val.frozen()) return false;
+        Node<K, V>* curr = get_node(anchor_val);
+        hp_records[1].hazard_pointer.store(curr, std::memory_order_seq_cst);
+        if (anchor->load() != anchor_val) return false;
 
         while (curr) {
-            size_t new_idx = hash(curr->key, new_array->size);
-            auto& new_head = new_array->buckets[new_idx];
+            MarkedPtr curr_nextPtr = curr->next.load();
+            Node<K, V>* next_node = get_node(curr_nextPtr);
+            hp_records[0].hazard_pointer.store(next_node, std::memory_order_seq_cst);
+            if (anchor->load() != anchor_val || curr->next.load() != curr_nextPtr) return false;
+
+            visit(*curr, curr_nextPtr.marked());
+            if (!curr_nextPtr.marked()) {
+                hp_records[2].hazard_pointer.store(curr, std::memory_order_release);
+                anchor = &curr->next;
+                anchor_val = curr_nextPtr;
+            }
+            hp_records[1].hazard_pointer.store(next_node, std::memory_order_release);
+            curr = next_node;
+        }
+        return true;
+    }
 
-            Node<K, V>* new_node = new Node<K, V>(curr->key, curr->value);
-            MarkedPtr expected = new_head.load();
-            new_node->next.store(expected);
-            MarkedPtr desired = MarkedPtr(new_node, false, expected.tag() + 1);
+    //@brief walk_bucket until it sees an unchanged chain.
+    //@param reset Called before every walk, to drop what an earlier one saw.
+    //@return false if a resize replaced the array; the caller starts over on the current one.
+    template <typename Reset, typename Visit>
+    bool walk_bucket_retrying(BucketArray<K, V>* array, size_t idx, Reset&& reset, Visit&& visit) {
+        while (true) {
+            reset();
+            if (walk_bucket(array, idx, visit)) return true;
+            if (current_array.load() != array) return false;
+        }
+    }
+
+    //@brief Freeze every link of a bucket, head first, so that no insert, remove
+    //or unlink can change the chain any more. They find the frozen link and retry
+    //on the current array.
+    //@param array The replaced array the bucket belongs to.
+    //@param idx The index of the bucket.
+    void freeze_bucket(BucketArray<K, V>* array, size_t idx) {
+        std::atomic<MarkedPtr>& head = array->buckets[idx];
+        std::atomic<MarkedPtr>* link = &head;
+        while (true) {
+            MarkedPtr val = link->load();
+            while (!val.frozen() && !link->compare_exchange_weak(val, val.as_frozen())) {}
+            Node<K, V>* next_node = get_node(val);
+            if (!next_node) return;
+            // A node behind a frozen link stays linked until another thread has
+            // finished the move and marked the head; then its nodes are retired
+            hp_records[1].hazard_pointer.store(next_node, std::memory_order_seq_cst);
+            if (head.load().marked()) return;
+            link = &next_node->next;
+        }
+    }
+
+    //@brief Visit the live nodes of a frozen bucket.
+    //@param array The replaced array the bucket belongs to.
+    //@param idx The index of the bucket.
+    //@param visit Called as visit(node) for every unmarked node.
+    //@return false if the move was already finished and the nodes retired.
+    template <typename Visit>
+    bool walk_frozen_bucket(BucketArray<K, V>* array, size_t idx, Visit&& visit) {
+        std::atomic<MarkedPtr>& head = array->buckets[idx];
+        Node<K, V>* curr = get_node(head.load());
+        hp_records[1].hazard_pointer.store(curr, std::memory_order_seq_cst);
+        if (head.load().marked()) return false;
+
+        while (curr) {
+            MarkedPtr curr_nextPtr = curr->next.load();
+            Node<K, V>* next_node = get_node(curr_nextPtr);
+            // The chain never changes, only retiring the nodes rewrites their
+            // next pointers, and that starts once the head is marked
+            hp_records[0].hazard_pointer.store(next_node, std::memory_order_seq_cst);
+            if (head.load().marked()) return false;
 
-            while (!new_head.compare_exchange_weak(expected, desired)) {
-                new_node->next.store(expected);
+            if (!curr_nextPtr.marked()) visit(*curr);
+            hp_records[1].hazard_pointer.store(next_node, std::memory_order_release);
+            curr = next_node;
+        }
+        return true;
+    }
+
+    //@brief Move a bucket in from the array the given one replaced.
+    //The source buckets are frozen, their live entries copied into new sorted
+    //chains (find_bucket relies on the order) and the chains installed with a
+    //CAS, so any number of threads can move the same bucket and one copy wins.
+    //The thread that then marks a source head retires the nodes behind it.
+    //The sizes are powers of two: growing, one source bucket fills several
+    //buckets of the new array and they are all moved together; shrinking,
+    //several source buckets fill one.
+    //@param array The array the bucket belongs to.
+    //@param idx The index of a bucket that is not moved in yet.
+    void move_bucket(BucketArray<K, V>* array, size_t idx) {
+        init_thread_hp();
+        // Drop the source when done, or the thread would keep it from being freed until its next move
+        struct ReleasePrev {
+            ~ReleasePrev() { hp_records[1].hazard_array.store(nullptr, std::memory_order_release); }
+        } release_prev;
+        BucketArray<K, V>* from = protect_prev(array);
+        // Cleared once every bucket is moved in, this one too
+        if (!from) return;
+        const size_t smaller = std::min(array->size, from->size);
+        const size_t first = idx % smaller;
+        const size_t sources = from->size / smaller;
+        const size_t targets = array->size / smaller;
+
+        for (size_t s = 0; s < sources; ++s) {
+            freeze_bucket(from, first + s * smaller);
+        }
+
+        // entries[t] goes to bucket first + t * smaller of array
+        std::vector<std::vector<std::pair<K, V>>> entries(targets);
+        for (size_t s = 0; s < sources; ++s) {
+            // A marked source means another thread installed every target already
+            if (!walk_frozen_bucket(from, first + s * smaller, [&](const Node<K, V>& node) {
+                entries[hash(node.key, array->size) / smaller].emplace_back(node.key, node.value);
+            })) {
+                return;
+            }
+        }
+
+        for (size_t t = 0; t < targets; ++t) {
+            std::vector<std::pair<K, V>>& chain = entries[t];
+            std::sort(chain.begin(), chain.end(),
+                [](const std::pair<K, V>& a, const std::pair<K, V>& b) { return a.first < b.first; });
+            Node<K, V>* chain_head = nullptr;
+            for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+                Node<K, V>* new_node = new Node<K, V>(it->first, it->second);
+                new_node->next.store(MarkedPtr(chain_head, false, 0), std::memory_order_relaxed);
+                chain_head = new_node;
             }
 
-            Node<K, V>* next = get_node(curr->next.load());  
-            curr = next;
+            MarkedPtr expected = BucketArray<K, V>::not_moved();
+            if (!array->buckets[first + t * smaller].compare_exchange_strong(expected, MarkedPtr(chain_head, false, 0))) {
+                // Another thread's copy is in, this one was never visible
+                while (chain_head) {
+                    Node<K, V>* next = get_node(chain_head->next.load(std::memory_order_relaxed));
+                    delete chain_head;
+                    chain_head = next;
+                }
+            }
+        }
+
+        // Every target is installed, no operation reaches the sources any more
+        for (size_t s = 0; s < sources; ++s) {
+            std::atomic<MarkedPtr>& head = from->buckets[first + s * smaller];
+            MarkedPtr frozen_val = head.load();
+            if (frozen_val.marked()) continue;
+            MarkedPtr moved = MarkedPtr(frozen_val.ptr(), true, frozen_val.tag()).as_frozen();
+            if (!head.compare_exchange_strong(frozen_val, moved)) continue;
+
+            // The copies replace the live nodes, so live_heap_bytes stays as it is
+            Node<K, V>* curr = get_node(frozen_val);
+            while (curr) {
+                Node<K, V>* next = get_node(curr->next.load());
+                retire_moved(curr); // SMR
+                curr = next;
+            }
         }
     }
+
+    //@brief Retire a node move_bucket replaced, without the scan retire_node
+    //may start. A resize retires every node of the table, try_resize scans
+    //once when it has moved all buckets instead of every few nodes.
+    //@param node The node, no longer reachable from the current array.
+    void retire_moved(Node<K, V>* node) {
+        if (size_t heap = node_heap_size(node)) retired_heap_bytes.fetch_add(heap, std::memory_order_relaxed);
+        push_retired(node);
+        retired_count.fetch_add(1, std::memory_order_relaxed);
+    }
 };
 
 // Define static members (template headers needed)
-template <typename K, typename V>  
-std::atomic<typename LockFreeHashTable<K, V>::HazardRecord*> LockFreeHashTable<K, V>::hp_head{ nullptr };
-template <typename K, typename V>
-std::atomic<Node<K, V>*> LockFreeHashTable<K, V>::retired_list{ nullptr };
+template <typename K, typename V, typename Hash>  
+std::atomic<typename LockFreeHashTable<K, V, Hash>::HazardRecord*> LockFreeHashTable<K, V, Hash>::hp_head{ nullptr };
+template <typename K, typename V, typename Hash>
+std::atomic<Node<K, V>*> LockFreeHashTable<K, V, Hash>::retired_list{ nullptr };
 
-template <typename K, typename V>
-std::atomic<size_t> LockFreeHashTable<K, V>::retired_count{ 0 };
+template <typename K, typename V, typename Hash>
+std::atomic<size_t> LockFreeHashTable<K, V, Hash>::retired_count{ 0 };
 
-template <typename K, typename V>
-void LockFreeHashTable<K, V>::init_thread_hp() {
+template <typename K, typename V, typename Hash>
+void LockFreeHashTable<K, V, Hash>::init_thread_hp() {
     if (!hp_records) {
+        (void)&hp_release; // Construct the thread's release guard
+
+        // Reuse the set of a thread that has exited
+        for (HazardRecord* r = hp_head.load(std::memory_order_acquire); r;
+            r = r[HP_COUNT_PER_THREAD - 1].next_pointer.load(std::memory_order_acquire)) {
+            bool expected = false;
+            if (!r[0].active.load(std::memory_order_relaxed) &&
+                r[0].active.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                hp_records = r;
+                return;
+            }
+        }
+
         hp_records = new HazardRecord[HP_COUNT_PER_THREAD];
         for (int i = 0; i < HP_COUNT_PER_THREAD; ++i) {
             hp_records[i].hazard_pointer.store(nullptr, std::memory_order_relaxed);
         }
+        hp_records[0].active.store(true, std::memory_order_relaxed);
+        hp_set_count.fetch_add(1, std::memory_order_relaxed);
 
         HazardRecord* old_head = hp_head.load(std::memory_order_relaxed);
         do {
@@ -403,16 +1545,33 @@ void LockFreeHashTable<K, V>::init_thread_hp() {
     }
 }
 
-template <typename K, typename V>
-void LockFreeHashTable<K, V>::retire_node(Node<K, V>* node) {
+template <typename K, typename V, typename Hash>
+void LockFreeHashTable<K, V, Hash>::release_thread_hp() {
+    if (!hp_records) return;
+    for (int i = 0; i < HP_COUNT_PER_THREAD; ++i) {
+        hp_records[i].hazard_pointer.store(nullptr, std::memory_order_release);
+        hp_records[i].hazard_array.store(nullptr, std::memory_order_release);
+    }
+    hp_records[0].active.store(false, std::memory_order_release);
+    hp_records = nullptr;
+}
+
+template <typename K, typename V, typename Hash>
+void LockFreeHashTable<K, V, Hash>::push_retired(Node<K, V>* node) {
     Node<K, V>* old_head = retired_list.load(std::memory_order_relaxed);
     do {
-        node->next.store(MarkedPtr(old_head, false, 0), std::memory_order_relaxed);
+        node->next.store(MarkedPtr(old_head, true, 0), std::memory_order_relaxed);
     } while (!retired_list.compare_exchange_weak(
         old_head,
         node,
         std::memory_order_release,
         std::memory_order_relaxed));
+}
+
+template <typename K, typename V, typename Hash>
+void LockFreeHashTable<K, V, Hash>::retire_node(Node<K, V>* node) {
+    if (size_t heap = node_heap_size(node)) retired_heap_bytes.fetch_add(heap, std::memory_order_relaxed);
+    push_retired(node);
 
     if (retired_count.fetch_add(1, std::memory_order_relaxed) + 1 >=
         2 * std::thread::hardware_concurrency() * HP_COUNT_PER_THREAD) {
@@ -420,9 +1579,14 @@ void LockFreeHashTable<K, V>::retire_node(Node<K, V>* node) {
     }
 }
 
-template <typename K, typename V>
-void LockFreeHashTable<K, V>::scan_retired_nodes() {
+template <typename K, typename V, typename Hash>
+void LockFreeHashTable<K, V, Hash>::scan_retired_nodes() {
+    const uint64_t start_ns = trace_now();
+    // Detach the retired nodes before reading the hazard pointers, so any
+    // pointer published before a node was retired is seen by this scan.
+    Node<K, V>* old_head = retired_list.exchange(nullptr, std::memory_order_seq_cst);
     std::unordered_set<Node<K, V>*> protected_ptrs;
+    size_t hazards = 0;
 
     HazardRecord* current = hp_head.load(std::memory_order_acquire);
     while (current) {
@@ -430,11 +1594,12 @@ void LockFreeHashTable<K, V>::scan_retired_nodes() {
             Node<K, V>* ptr = current[i].hazard_pointer.load(std::memory_order_acquire);
             if (ptr) protected_ptrs.insert(ptr);
         }
+        hazards += HP_COUNT_PER_THREAD;
         current = current[HP_COUNT_PER_THREAD - 1].next_pointer.load(std::memory_order_acquire);
     }
 
-    Node<K, V>* old_head = retired_list.exchange(nullptr, std::memory_order_acquire);
     size_t new_count = 0;
+    size_t freed = 0;
 
     while (old_head) {
         Node<K, V>* next = static_cast<Node<K, V>*>(old_head->next.load().ptr());
@@ -442,7 +1607,7 @@ void LockFreeHashTable<K, V>::scan_retired_nodes() {
             Node<K, V>* temp_head;
             do {
                 temp_head = retired_list.load(std::memory_order_relaxed);
-                old_head->next.store(MarkedPtr(temp_head, false, 0), std::memory_order_relaxed);
+                old_head->next.store(MarkedPtr(temp_head, true, 0), std::memory_order_relaxed);
             } while (!retired_list.compare_exchange_weak(
                 temp_head,
                 old_head,
@@ -452,14 +1617,20 @@ void LockFreeHashTable<K, V>::scan_retired_nodes() {
         }
         else {
             free_retired_node(old_head);
+            freed++;
         }
         old_head = next;
     }
 
     retired_count.store(new_count, std::memory_order_release);
+    LFHT_STAT(Scans);
+    LFHT_STAT_ADD(ScanFreed, freed);
+    LFHT_STAT_ADD(ScanKept, new_count);
+    trace_event(TraceEventType::Scan, start_ns, trace_now(), hazards, freed, new_count);
 }
 
-template <typename K, typename V>
-void LockFreeHashTable<K, V>::free_retired_node(Node<K, V>* node) {
+template <typename K, typename V, typename Hash>
+void LockFreeHashTable<K, V, Hash>::free_retired_node(Node<K, V>* node) {
+    if (size_t heap = node_heap_size(node)) retired_heap_bytes.fetch_sub(heap, std::memory_order_relaxed);
     delete node;
 }
\ No newline at end of file
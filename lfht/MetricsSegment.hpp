@@ -0,0 +1,433 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include "LockFreeHashTable.hpp"
+#ifdef __linux__
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#endif
+
+// Live metrics of a running process in a shared memory segment, so a monitor
+// (lfht --attach PID) can watch it without being linked into it. On Linux the
+// segment is a POSIX shm object, on Windows a named file mapping backed by the
+// paging file; it lives as long as the publisher or an attached viewer maps it.
+// The process publishes a MetricsFrame from its own sampling thread, never from
+// the table operations. The segment holds two frames: the writer fills the one
+// readers are not pointed at, then flips `latest`. Each frame has a seqlock
+// counter, so a reader that races with a rewrite of its frame retries.
+
+constexpr uint32_t METRICS_MAGIC = 0x5448464C;  // "LFHT" in memory
+constexpr uint32_t METRICS_VERSION = 1;
+constexpr int METRICS_CHAIN_BINS = 32;        // chain length 0 .. 30, the last bin holds 31 and longer
+constexpr int METRICS_LATENCY_TYPES = 8;
+constexpr int METRICS_LATENCY_BINS = 40;      // bin b holds [2^b, 2^(b+1)) ns, bin 0 also 0
+constexpr int METRICS_LABEL_SIZE = 96;
+
+// One sample of the publishing process. Plain data, copied as a whole.
+struct MetricsFrame
+{
+	uint64_t frame = 0;           // number of the frame, counts up from 1
+	uint64_t timeNs = 0;          // steady_clock of the publisher (CLOCK_MONOTONIC on Linux)
+	double intervalSec = 0.0;     // since the previous frame, what the latency counts cover
+	char label[METRICS_LABEL_SIZE] = {};
+	uint64_t ops = 0;             // since the current run started
+	double opsPerSec = 0.0;       // over the interval
+	uint64_t live = 0;
+	uint64_t buckets = 0;
+	double loadFactor = 0.0;
+	uint64_t resizes = 0;
+	uint64_t retired = 0;
+	uint64_t hazardRecords = 0;
+	uint64_t memoryBytes = 0;
+	uint32_t statsEnabled = 0;
+	uint64_t stats[TableStats::COUNT] = {};
+	uint64_t chainBins[METRICS_CHAIN_BINS] = {};  // buckets by live chain length, when last walked
+	uint64_t latency[METRICS_LATENCY_TYPES][METRICS_LATENCY_BINS] = {};  // ops of the interval
+};
+
+// The shared memory layout
+struct MetricsSegmentData
+{
+	struct Slot
+	{
+		std::atomic<uint64_t> seq;  // odd while the frame is written
+		MetricsFrame frame;
+	};
+
+	uint32_t magic;
+	uint32_t version;
+	uint32_t frameSize;
+	uint32_t statCount;
+	int32_t pid;
+	uint32_t latencyTypes;
+	char latencyNames[METRICS_LATENCY_TYPES][16];
+	std::atomic<uint32_t> latest;
+	Slot slots[2];
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "The seqlock counters must be address free");
+
+// @brief Bin of a latency in a MetricsFrame.
+inline int MetricsLatencyBin(uint64_t ns)
+{
+	int bin = 0;
+	while (ns > 1 && bin < METRICS_LATENCY_BINS - 1)
+	{
+		ns >>= 1;
+		bin++;
+	}
+	return bin;
+}
+
+// @brief Value at a percentile of one latency row of a frame.
+// @param bins The row, METRICS_LATENCY_BINS counts.
+// @param p Percentile in [0, 100].
+// @return The upper bound of the bin, 0 if the row is empty.
+inline uint64_t MetricsPercentile(const uint64_t* bins, double p)
+{
+	uint64_t total = 0;
+	for (int i = 0; i < METRICS_LATENCY_BINS; ++i)
+		total += bins[i];
+	if (total == 0)
+		return 0;
+	uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(p / 100.0 * total + 0.5));
+	uint64_t seen = 0;
+	for (int i = 0; i < METRICS_LATENCY_BINS; ++i)
+	{
+		seen += bins[i];
+		if (seen >= rank)
+			return 2ULL << i;
+	}
+	return 2ULL << (METRICS_LATENCY_BINS - 1);
+}
+
+// Counters of one worker thread for the publisher: single writer, relaxed
+// stores, so recording costs the worker no read-modify-write.
+struct alignas(64) LiveOpMetrics
+{
+	std::atomic<uint64_t> ops{ 0 };
+	std::atomic<uint64_t> latency[METRICS_LATENCY_TYPES][METRICS_LATENCY_BINS] = {};
+
+	// @brief Count an operation that was not timed.
+	void Count()
+	{
+		ops.store(ops.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	// @brief Count a timed operation.
+	// @param type Row of the frame's latency table.
+	// @param ns The latency.
+	void Record(int type, uint64_t ns)
+	{
+		std::atomic<uint64_t>& bin = latency[type][MetricsLatencyBin(ns)];
+		bin.store(bin.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		Count();
+	}
+};
+
+// @brief Name of the segment of a process.
+inline std::string MetricsSegmentName(int pid)
+{
+#ifdef _WIN32
+	return "Local\\lfht." + std::to_string(pid);
+#else
+	return "/lfht." + std::to_string(pid);
+#endif
+}
+
+// @brief Id of the calling process.
+inline int MetricsCurrentPid()
+{
+#ifdef _WIN32
+	return static_cast<int>(GetCurrentProcessId());
+#elif defined(__linux__)
+	return static_cast<int>(getpid());
+#else
+	return 0;
+#endif
+}
+
+#ifdef _WIN32
+// @brief The segment name for the wide Win32 calls. Names are ASCII.
+inline std::wstring MetricsWideName(const std::string& name)
+{
+	return std::wstring(name.begin(), name.end());
+}
+#endif
+
+// Owns the segment of this process and writes frames into it. One writer only.
+class MetricsPublisher
+{
+public:
+	MetricsPublisher() : m_data(nullptr), m_frame(0), m_mapping(nullptr) {}
+	~MetricsPublisher() { Close(); }
+	MetricsPublisher(const MetricsPublisher&) = delete;
+	MetricsPublisher& operator=(const MetricsPublisher&) = delete;
+
+	// @brief The publisher of the process, opened by the benchmark's --publish.
+	static MetricsPublisher& Process()
+	{
+		static MetricsPublisher publisher;
+		return publisher;
+	}
+
+	// @brief Create the segment of this process.
+	// @param latencyNames Names of the latency rows, at most METRICS_LATENCY_TYPES.
+	// @param latencyTypes Number of names.
+	// @param error Set on failure.
+	// @return True on success.
+	bool Open(const char* const* latencyNames, int latencyTypes, std::string& error)
+	{
+#if defined(__linux__) || defined(_WIN32)
+		Close();
+		m_name = MetricsSegmentName(MetricsCurrentPid());
+#ifdef __linux__
+		int fd = shm_open(m_name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+		if (fd < 0)
+		{
+			error = "shm_open " + m_name + ": " + std::strerror(errno);
+			return false;
+		}
+		bool sized = ftruncate(fd, sizeof(MetricsSegmentData)) == 0;
+		void* mem = sized ? mmap(nullptr, sizeof(MetricsSegmentData), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+		close(fd);
+		if (mem == MAP_FAILED)
+		{
+			error = "cannot map " + m_name + ": " + std::strerror(errno);
+			shm_unlink(m_name.c_str());
+			return false;
+		}
+#else
+		HANDLE mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0,
+			static_cast<DWORD>(sizeof(MetricsSegmentData)), MetricsWideName(m_name).c_str());
+		if (!mapping)
+		{
+			error = "CreateFileMapping " + m_name + ": error " + std::to_string(GetLastError());
+			return false;
+		}
+		void* mem = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(MetricsSegmentData));
+		if (!mem)
+		{
+			error = "cannot map " + m_name + ": error " + std::to_string(GetLastError());
+			CloseHandle(mapping);
+			return false;
+		}
+		m_mapping = mapping;
+#endif
+
+		m_data = new (mem) MetricsSegmentData();
+		m_data->version = METRICS_VERSION;
+		m_data->frameSize = sizeof(MetricsFrame);
+		m_data->statCount = TableStats::COUNT;
+		m_data->pid = MetricsCurrentPid();
+		m_data->latencyTypes = static_cast<uint32_t>(std::min(latencyTypes, METRICS_LATENCY_TYPES));
+		for (uint32_t i = 0; i < m_data->latencyTypes; ++i)
+			std::strncpy(m_data->latencyNames[i], latencyNames[i], sizeof(m_data->latencyNames[i]) - 1);
+		m_data->latest.store(0, std::memory_order_relaxed);
+		for (auto& slot : m_data->slots)
+			slot.seq.store(0, std::memory_order_relaxed);
+		// Readers check the magic last
+		std::atomic_thread_fence(std::memory_order_release);
+		m_data->magic = METRICS_MAGIC;
+		return true;
+#else
+		(void)latencyNames; (void)latencyTypes;
+		error = "the shared memory metrics segment needs Linux or Windows";
+		return false;
+#endif
+	}
+
+	// @brief Remove the segment. Attached viewers keep their mapping.
+	void Close()
+	{
+		if (!m_data)
+			return;
+#ifdef __linux__
+		munmap(m_data, sizeof(MetricsSegmentData));
+		shm_unlink(m_name.c_str());
+#elif defined(_WIN32)
+		// The mapping goes away with the last view, an attached viewer keeps it
+		UnmapViewOfFile(m_data);
+		CloseHandle(m_mapping);
+		m_mapping = nullptr;
+#endif
+		m_data = nullptr;
+	}
+
+	bool IsOpen() const { return m_data != nullptr; }
+	const std::string& GetName() const { return m_name; }
+
+	// @brief Write a frame into the slot readers are not pointed at and make it the latest.
+	// @param frame The frame, its frame number is set here.
+	void Publish(MetricsFrame& frame)
+	{
+		if (!m_data)
+			return;
+		frame.frame = ++m_frame;
+		const uint32_t w = 1 - m_data->latest.load(std::memory_order_relaxed);
+		MetricsSegmentData::Slot& slot = m_data->slots[w];
+		const uint64_t seq = slot.seq.load(std::memory_order_relaxed);
+		slot.seq.store(seq + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		std::memcpy(&slot.frame, &frame, sizeof(MetricsFrame));
+		slot.seq.store(seq + 2, std::memory_order_release);
+		m_data->latest.store(w, std::memory_order_release);
+	}
+
+private:
+	MetricsSegmentData* m_data;
+	std::string m_name;
+	uint64_t m_frame;
+	void* m_mapping;  // Windows: the file mapping handle
+};
+
+// Maps the segment of another process read-only.
+class MetricsReader
+{
+public:
+	MetricsReader() : m_data(nullptr), m_pid(0) {}
+	~MetricsReader() { Detach(); }
+	MetricsReader(const MetricsReader&) = delete;
+	MetricsReader& operator=(const MetricsReader&) = delete;
+
+	// @brief Map the segment a process publishes.
+	// @param pid The process.
+	// @param error Set on failure.
+	// @return True on success.
+	bool Attach(int pid, std::string& error)
+	{
+#if defined(__linux__) || defined(_WIN32)
+		Detach();
+		const std::string name = MetricsSegmentName(pid);
+#ifdef __linux__
+		int fd = shm_open(name.c_str(), O_RDONLY, 0);
+		if (fd < 0)
+		{
+			error = "no metrics segment " + name + " (is the process running with --publish?)";
+			return false;
+		}
+		void* mem = mmap(nullptr, sizeof(MetricsSegmentData), PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);
+		if (mem == MAP_FAILED)
+		{
+			error = "cannot map " + name + ": " + std::strerror(errno);
+			return false;
+		}
+#else
+		HANDLE mapping = OpenFileMappingW(FILE_MAP_READ, FALSE, MetricsWideName(name).c_str());
+		if (!mapping)
+		{
+			error = "no metrics segment " + name + " (is the process running with --publish?)";
+			return false;
+		}
+		// The view keeps the mapping alive, the handle is not needed any more
+		void* mem = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, sizeof(MetricsSegmentData));
+		const DWORD mapError = GetLastError();
+		CloseHandle(mapping);
+		if (!mem)
+		{
+			error = "cannot map " + name + ": error " + std::to_string(mapError);
+			return false;
+		}
+#endif
+		const MetricsSegmentData* data = static_cast<const MetricsSegmentData*>(mem);
+		if (data->magic != METRICS_MAGIC || data->version != METRICS_VERSION ||
+			data->frameSize != sizeof(MetricsFrame) || data->statCount != TableStats::COUNT)
+		{
+			unmap(mem);
+			error = name + " was written by an incompatible build";
+			return false;
+		}
+		m_data = data;
+		m_pid = pid;
+		return true;
+#else
+		(void)pid;
+		error = "the shared memory metrics segment needs Linux or Windows";
+		return false;
+#endif
+	}
+
+	void Detach()
+	{
+		if (m_data)
+			unmap(const_cast<MetricsSegmentData*>(m_data));
+		m_data = nullptr;
+	}
+
+	bool IsAttached() const { return m_data != nullptr; }
+	int GetPid() const { return m_pid; }
+	int GetLatencyTypes() const { return m_data ? static_cast<int>(m_data->latencyTypes) : 0; }
+	const char* GetLatencyName(int type) const { return m_data->latencyNames[type]; }
+
+	// @brief Whether the attached process still exists.
+	bool IsAlive() const
+	{
+#ifdef __linux__
+		return m_pid > 0 && (kill(m_pid, 0) == 0 || errno == EPERM);
+#elif defined(_WIN32)
+		HANDLE process = m_pid > 0 ? OpenProcess(SYNCHRONIZE, FALSE, static_cast<DWORD>(m_pid)) : nullptr;
+		if (!process)
+			return GetLastError() == ERROR_ACCESS_DENIED;
+		const bool running = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+		CloseHandle(process);
+		return running;
+#else
+		return false;
+#endif
+	}
+
+	// @brief Copy the latest frame.
+	// @param frame Receives the frame.
+	// @return False if nothing was published yet, or the writer kept rewriting the frame.
+	bool Read(MetricsFrame& frame) const
+	{
+		if (!m_data)
+			return false;
+		for (int attempt = 0; attempt < 64; ++attempt)
+		{
+			const MetricsSegmentData::Slot& slot = m_data->slots[m_data->latest.load(std::memory_order_acquire)];
+			const uint64_t before = slot.seq.load(std::memory_order_acquire);
+			if (before == 0)
+				return false;
+			if (before & 1)
+				continue;
+			std::memcpy(&frame, &slot.frame, sizeof(MetricsFrame));
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slot.seq.load(std::memory_order_relaxed) == before)
+				return true;
+		}
+		return false;
+	}
+
+private:
+	const MetricsSegmentData* m_data;
+	int m_pid;
+
+	// @brief Unmap a mapped segment.
+	static void unmap(void* mem)
+	{
+#ifdef __linux__
+		munmap(mem, sizeof(MetricsSegmentData));
+#elif defined(_WIN32)
+		UnmapViewOfFile(mem);
+#else
+		(void)mem;
+#endif
+	}
+};
@@ -0,0 +1,374 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define LFHT_HAS_TSC 1
+#endif
+#include "LockFreeHashTable.hpp"
+
+// Access to the private building blocks of LockFreeHashTable, for the micro benchmarks only
+template <typename K, typename V, typename H>
+struct TableInternals<LockFreeHashTable<K, V, H>>
+{
+	using Table = LockFreeHashTable<K, V, H>;
+	using NodeType = Node<K, V>;
+	using ArrayType = BucketArray<K, V>;
+
+	static size_t Hash(const Table& table, K key, size_t size) { return table.hash(key, size); }
+	static ArrayType* CurrentArray(Table& table) { return table.current_array.load(); }
+	static void RegisterThread(Table& table) { table.init_thread_hp(); }
+	static void PushRetired(NodeType* node)
+	{
+		Table::push_retired(node);
+		Table::retired_count.fetch_add(1, std::memory_order_relaxed);
+	}
+	static void RetireNode(Table& table, NodeType* node) { table.retire_node(node); }
+	static void ScanRetired(Table& table) { table.scan_retired_nodes(); }
+
+	// @brief find_bucket, with its hazard pointer publish and validate steps.
+	static NodeType* FindBucket(Table& table, ArrayType* array, size_t idx, K key)
+	{
+		return table.find_bucket(array, idx, key).second;
+	}
+
+	// @brief The same walk as find_bucket without hazard pointers, as a reference point.
+	static NodeType* WalkUnprotected(Table& table, ArrayType* array, size_t idx, K key)
+	{
+		NodeType* curr = table.get_node(array->buckets[idx].load());
+		while (curr && curr->key < key)
+			curr = table.get_node(curr->next.load());
+		return curr;
+	}
+
+	// @brief Move a bucket of to in from to->prev, if it is not moved yet.
+	static void MoveBucket(Table& table, ArrayType* to, size_t idx)
+	{
+		if (to->buckets[idx].load() == ArrayType::not_moved())
+			table.move_bucket(to, idx);
+	}
+
+	// @brief Delete a bucket array that was never published, with its nodes.
+	static void FreeArray(Table& table, ArrayType* array)
+	{
+		table.free_array_nodes(array);
+		delete array;
+	}
+};
+
+// @brief Keep the compiler from optimizing away a computed value.
+template <typename T>
+inline void DoNotOptimize(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "r,m"(value) : "memory");
+#else
+	static volatile const void* sink;
+	sink = &value;
+#endif
+}
+
+// @brief Read the time stamp counter.
+// @return Reference cycles, 0 where no counter is available.
+inline uint64_t ReadCycleCounter()
+{
+#ifdef LFHT_HAS_TSC
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+// One line of the micro benchmark report
+struct MicroResult
+{
+	std::string name;
+	std::string detail;
+	double nsPerOp;
+	double cyclesPerOp;  // < 0 when no cycle counter is available
+};
+
+// Elapsed time and cycles of one timed batch
+struct MicroSample
+{
+	double ns = 0.0;
+	uint64_t cycles = 0;
+};
+
+// @brief Time a single call.
+// @param fn The code to time.
+template <typename Fn>
+inline MicroSample TimeOnce(Fn&& fn)
+{
+	auto start = std::chrono::steady_clock::now();
+	uint64_t c0 = ReadCycleCounter();
+	fn();
+	uint64_t c1 = ReadCycleCounter();
+	auto end = std::chrono::steady_clock::now();
+	return { std::chrono::duration<double, std::nano>(end - start).count(), c1 - c0 };
+}
+
+// @brief Turn batch samples into a result, using the median batch.
+// @param samples One sample per batch.
+// @param opsPerSample Operations in each batch.
+inline MicroResult SummarizeSamples(const std::string& name, const std::string& detail,
+	std::vector<MicroSample> samples, double opsPerSample)
+{
+	std::sort(samples.begin(), samples.end(), [](const MicroSample& a, const MicroSample& b) { return a.ns < b.ns; });
+	const MicroSample& median = samples[samples.size() / 2];
+	double cycles = -1.0;
+#ifdef LFHT_HAS_TSC
+	cycles = median.cycles / opsPerSample;
+#endif
+	return { name, detail, median.ns / opsPerSample, cycles };
+}
+
+// Settings shared by all micro benchmarks
+struct MicroOptions
+{
+	std::string filter;       // only run benchmarks whose name contains this
+	double sampleMs = 20.0;   // target length of one timed batch
+	int samples = 7;          // batches per benchmark, the median is reported
+};
+
+// @brief Time fn(i) in a loop, calibrating the iteration count to the sample length.
+// @param fn Called with the iteration index, must be cheap enough to loop.
+template <typename Fn>
+inline MicroResult MeasureLoop(const std::string& name, const std::string& detail, const MicroOptions& options, Fn&& fn)
+{
+	uint64_t iterations = 1024;
+	while (true)
+	{
+		MicroSample s = TimeOnce([&] { for (uint64_t i = 0; i < iterations; ++i) fn(i); });
+		if (s.ns >= options.sampleMs * 1e6 || iterations >= (1ull << 34))
+			break;
+		iterations *= s.ns > 0.0 ? std::max<uint64_t>(2, static_cast<uint64_t>(options.sampleMs * 1e6 / s.ns)) : 16;
+	}
+
+	std::vector<MicroSample> samples;
+	for (int s = 0; s < options.samples; ++s)
+		samples.push_back(TimeOnce([&] { for (uint64_t i = 0; i < iterations; ++i) fn(i); }));
+	return SummarizeSamples(name, detail, samples, static_cast<double>(iterations));
+}
+
+// Runs the micro benchmarks of the lock-free table's primitives
+class MicroBench
+{
+public:
+	using Table = LockFreeHashTable<uint64_t, uint64_t>;
+	using Internals = TableInternals<Table>;
+
+	MicroBench(const MicroOptions& options) : m_options(options) {}
+
+	// @brief Run every benchmark that matches the filter and print the report.
+	void Run()
+	{
+		std::printf("%-20s %-34s %12s %12s\n", "benchmark", "detail", "ns/op", "cycles/op");
+		run("marked_ptr", [this] { markedPtr(); });
+		run("hash", [this] { hash(); });
+		run("find_bucket", [this] { findBucket(); });
+		run("retire", [this] { retire(); });
+		run("scan", [this] { scan(); });
+		run("rehash", [this] { rehash(); });
+#ifndef LFHT_HAS_TSC
+		std::printf("(no cycle counter on this platform)\n");
+#endif
+	}
+
+private:
+	MicroOptions m_options;
+
+	template <typename Fn>
+	void run(const char* name, Fn&& fn)
+	{
+		if (m_options.filter.empty() || std::string(name).find(m_options.filter) != std::string::npos)
+			fn();
+	}
+
+	void print(const MicroResult& r)
+	{
+		if (r.cyclesPerOp >= 0.0)
+			std::printf("%-20s %-34s %12.2f %12.1f\n", r.name.c_str(), r.detail.c_str(), r.nsPerOp, r.cyclesPerOp);
+		else
+			std::printf("%-20s %-34s %12.2f %12s\n", r.name.c_str(), r.detail.c_str(), r.nsPerOp, "-");
+		std::fflush(stdout);
+	}
+
+	// MarkedPtr packing and unpacking
+	void markedPtr()
+	{
+		std::vector<uint64_t> words(1024);
+		for (size_t i = 0; i < words.size(); ++i)
+			words[i] = 0x7f0000001000ull + i * 64;
+
+		print(MeasureLoop("marked_ptr", "encode", m_options, [&](uint64_t i)
+		{
+			MarkedPtr p(reinterpret_cast<void*>(words[i & 1023]), i & 1, static_cast<uint16_t>(i));
+			DoNotOptimize(p.data);
+		}));
+		print(MeasureLoop("marked_ptr", "encode + decode", m_options, [&](uint64_t i)
+		{
+			MarkedPtr p(reinterpret_cast<void*>(words[i & 1023]), i & 1, static_cast<uint16_t>(i));
+			uint64_t v = reinterpret_cast<uint64_t>(p.ptr()) ^ p.tag() ^ p.marked();
+			DoNotOptimize(v);
+		}));
+	}
+
+	// Bucket index computation: std::hash plus the modulo by a runtime size
+	void hash()
+	{
+		Table table;
+		for (size_t size : { size_t(64), size_t(1000003) })
+		{
+			volatile size_t opaque = size;  // keep the divisor a runtime value, as in the table
+			size_t divisor = opaque;
+			print(MeasureLoop("hash", "size " + std::to_string(size), m_options, [&](uint64_t i)
+			{
+				DoNotOptimize(Internals::Hash(table, i * 0x9E3779B97F4A7C15ull, divisor));
+			}));
+		}
+	}
+
+	// Hazard pointer publish and validate on a one-node bucket, against an unprotected walk
+	void findBucket()
+	{
+		Table table;
+		for (uint64_t k = 0; k < 64; ++k)
+			table.insert(k, k);
+		auto* array = Internals::CurrentArray(table);
+		size_t size = array->size;
+
+		print(MeasureLoop("find_bucket", "1-node bucket, hazard pointers", m_options, [&](uint64_t i)
+		{
+			uint64_t key = i & 63;
+			DoNotOptimize(Internals::FindBucket(table, array, Internals::Hash(table, key, size), key));
+		}));
+		print(MeasureLoop("find_bucket", "1-node bucket, unprotected walk", m_options, [&](uint64_t i)
+		{
+			uint64_t key = i & 63;
+			DoNotOptimize(Internals::WalkUnprotected(table, array, Internals::Hash(table, key, size), key));
+		}));
+	}
+
+	// The CAS push onto the retired list, alone and with retire_node's amortized scans
+	void retire()
+	{
+		const size_t batch = 4096;
+		Table table;
+		Internals::RegisterThread(table);
+
+		std::vector<Internals::NodeType*> nodes(batch);
+		std::vector<MicroSample> push, full;
+		for (int s = 0; s < m_options.samples * 4; ++s)
+		{
+			for (auto& n : nodes)
+				n = new Internals::NodeType(0, 0);
+			push.push_back(TimeOnce([&] { for (auto* n : nodes) Internals::PushRetired(n); }));
+			Internals::ScanRetired(table);
+
+			for (auto& n : nodes)
+				n = new Internals::NodeType(0, 0);
+			full.push_back(TimeOnce([&] { for (auto* n : nodes) Internals::RetireNode(table, n); }));
+			Internals::ScanRetired(table);
+		}
+		print(SummarizeSamples("retire", "CAS push", push, batch));
+		print(SummarizeSamples("retire", "retire_node incl. scans", full, batch));
+	}
+
+	// scan_retired_nodes for growing numbers of registered threads and retired list sizes
+	void scan()
+	{
+		Table table;
+		for (uint64_t k = 0; k < 1024; ++k)
+			table.insert(k, k);
+		Internals::RegisterThread(table);
+
+		// Each helper leaves its hazard pointers set to nodes of the table and
+		// stays parked, so its hazard records stay registered
+		std::atomic<bool> done{ false };
+		std::atomic<size_t> parked{ 0 };
+		std::vector<std::thread> helpers;
+		for (size_t threads : { size_t(1), size_t(4), size_t(16), size_t(64) })
+		{
+			while (helpers.size() + 1 < threads)
+			{
+				uint64_t key = helpers.size() % 1024;
+				helpers.emplace_back([&, key]
+				{
+					table.contains(key);
+					parked.fetch_add(1);
+					while (!done.load())
+						std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				});
+			}
+			while (parked.load() < helpers.size())
+				std::this_thread::yield();
+
+			for (size_t retired : { size_t(16), size_t(256), size_t(4096) })
+			{
+				std::vector<Internals::NodeType*> nodes(retired);
+				std::vector<MicroSample> samples;
+				for (int s = 0; s < m_options.samples * 4; ++s)
+				{
+					for (auto& n : nodes)
+					{
+						n = new Internals::NodeType(0, 0);
+						Internals::PushRetired(n);
+					}
+					samples.push_back(TimeOnce([&] { Internals::ScanRetired(table); }));
+				}
+				std::string detail = std::to_string(Table::getHazardRecordCount()) + " threads, " +
+					std::to_string(retired) + " retired";
+				MicroResult r = SummarizeSamples("scan", detail, samples, 1.0);
+				print(r);
+				r.detail = "  per retired node";
+				r.nsPerOp /= retired;
+				if (r.cyclesPerOp >= 0.0)
+					r.cyclesPerOp /= retired;
+				print(r);
+			}
+		}
+		done.store(true);
+		for (auto& h : helpers)
+			h.join();
+	}
+
+	// move_bucket into a twice as large array, per node moved. Moving retires
+	// the source nodes, so every sample fills a table of its own.
+	void rehash()
+	{
+		for (uint64_t keys : { uint64_t(1024), uint64_t(65536) })
+		{
+			size_t buckets = 0;
+			std::vector<MicroSample> samples;
+			for (int s = 0; s < m_options.samples; ++s)
+			{
+				Table table;
+				for (uint64_t k = 0; k < keys; ++k)
+					table.insert(k, k);
+				auto* from = Internals::CurrentArray(table);
+				buckets = from->size;
+
+				auto* to = new Internals::ArrayType(from->size * 2, from);
+				samples.push_back(TimeOnce([&]
+				{
+					for (size_t i = 0; i < to->size; ++i)
+						Internals::MoveBucket(table, to, i);
+				}));
+				Internals::FreeArray(table, to);
+			}
+			print(SummarizeSamples("rehash", std::to_string(keys) + " nodes, " +
+				std::to_string(buckets) + " buckets", samples, static_cast<double>(keys)));
+		}
+	}
+};
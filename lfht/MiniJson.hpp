@@ -0,0 +1,197 @@
+#pragma once
+#include <cctype>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+// Minimal JSON reader for the benchmark's own files (baselines).
+// Supports the full JSON grammar except \u escapes beyond ASCII.
+struct JsonValue
+{
+	enum class Type { Null, Bool, Number, String, Array, Object };
+
+	Type type = Type::Null;
+	bool boolean = false;
+	double number = 0.0;
+	std::string string;
+	std::vector<JsonValue> array;
+	std::map<std::string, JsonValue> object;
+
+	bool IsNull() const { return type == Type::Null; }
+	bool IsNumber() const { return type == Type::Number; }
+	bool IsString() const { return type == Type::String; }
+	bool IsArray() const { return type == Type::Array; }
+	bool IsObject() const { return type == Type::Object; }
+
+	// @brief Member of an object, or a null value if missing.
+	const JsonValue& operator[](const std::string& key) const
+	{
+		static const JsonValue null;
+		auto it = object.find(key);
+		return it != object.end() ? it->second : null;
+	}
+
+	// @brief Number value, or a fallback if this is not a number.
+	double NumberOr(double fallback) const { return IsNumber() ? number : fallback; }
+
+	// @brief String value, or a fallback if this is not a string.
+	std::string StringOr(const std::string& fallback) const { return IsString() ? string : fallback; }
+};
+
+class JsonParser
+{
+public:
+	// @brief Parse a complete JSON document.
+	// @param text The document.
+	// @param out The parsed value.
+	// @param error Set to a description with the offset when parsing fails.
+	// @return True on success.
+	static bool Parse(const std::string& text, JsonValue& out, std::string& error)
+	{
+		JsonParser p(text);
+		if (!p.parseValue(out) || (p.skipSpace(), p.m_pos != text.size()))
+		{
+			error = "invalid JSON near offset " + std::to_string(p.m_pos);
+			return false;
+		}
+		return true;
+	}
+
+private:
+	const std::string& m_text;
+	size_t m_pos = 0;
+
+	JsonParser(const std::string& text) : m_text(text) {}
+
+	void skipSpace()
+	{
+		while (m_pos < m_text.size() && std::isspace(static_cast<unsigned char>(m_text[m_pos])))
+			m_pos++;
+	}
+
+	bool consume(char c)
+	{
+		skipSpace();
+		if (m_pos < m_text.size() && m_text[m_pos] == c)
+		{
+			m_pos++;
+			return true;
+		}
+		return false;
+	}
+
+	bool consumeWord(const char* word)
+	{
+		size_t n = std::char_traits<char>::length(word);
+		if (m_text.compare(m_pos, n, word) != 0)
+			return false;
+		m_pos += n;
+		return true;
+	}
+
+	bool parseString(std::string& out)
+	{
+		if (!consume('"'))
+			return false;
+		out.clear();
+		while (m_pos < m_text.size())
+		{
+			char c = m_text[m_pos++];
+			if (c == '"')
+				return true;
+			if (c != '\\')
+			{
+				out += c;
+				continue;
+			}
+			if (m_pos >= m_text.size())
+				return false;
+			char e = m_text[m_pos++];
+			switch (e)
+			{
+			case 'n': out += '\n'; break;
+			case 't': out += '\t'; break;
+			case 'r': out += '\r'; break;
+			case 'b': out += '\b'; break;
+			case 'f': out += '\f'; break;
+			case 'u':
+				if (m_pos + 4 > m_text.size())
+					return false;
+				out += static_cast<char>(std::strtol(m_text.substr(m_pos, 4).c_str(), nullptr, 16) & 0x7F);
+				m_pos += 4;
+				break;
+			default: out += e; break;
+			}
+		}
+		return false;
+	}
+
+	bool parseValue(JsonValue& out)
+	{
+		skipSpace();
+		if (m_pos >= m_text.size())
+			return false;
+
+		char c = m_text[m_pos];
+		if (c == '{')
+		{
+			m_pos++;
+			out.type = JsonValue::Type::Object;
+			if (consume('}'))
+				return true;
+			do
+			{
+				std::string key;
+				skipSpace();
+				if (!parseString(key) || !consume(':') || !parseValue(out.object[key]))
+					return false;
+			} while (consume(','));
+			return consume('}');
+		}
+		if (c == '[')
+		{
+			m_pos++;
+			out.type = JsonValue::Type::Array;
+			if (consume(']'))
+				return true;
+			do
+			{
+				out.array.emplace_back();
+				if (!parseValue(out.array.back()))
+					return false;
+			} while (consume(','));
+			return consume(']');
+		}
+		if (c == '"')
+		{
+			out.type = JsonValue::Type::String;
+			return parseString(out.string);
+		}
+		if (consumeWord("true"))
+		{
+			out.type = JsonValue::Type::Bool;
+			out.boolean = true;
+			return true;
+		}
+		if (consumeWord("false"))
+		{
+			out.type = JsonValue::Type::Bool;
+			return true;
+		}
+		if (consumeWord("null"))
+		{
+			out.type = JsonValue::Type::Null;
+			return true;
+		}
+
+		const char* begin = m_text.c_str() + m_pos;
+		char* end = nullptr;
+		out.number = std::strtod(begin, &end);
+		if (end == begin)
+			return false;
+		out.type = JsonValue::Type::Number;
+		m_pos += end - begin;
+		return true;
+	}
+};
@@ -0,0 +1,58 @@
+#pragma once
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "BenchConfig.hpp"
+#include "BenchDriver.hpp"
+#include "BenchEngines.hpp"
+#include "Topology.hpp"
+
+// @brief Run every engine with more threads than CPUs, against the mutex baseline.
+// Threads are not pinned, the scheduler has to preempt them mid-operation.
+// @param base The workload; threads are overridden per run.
+// @param engines The engines to run. "mutex" is added as the baseline if missing.
+// @return The number of runs.
+inline int RunOversubscription(const BenchConfig& base, std::vector<std::string> engines)
+{
+	const int cpus = static_cast<int>(DiscoverCpus().size());
+	// The baseline runs first so every row can be compared against it
+	engines.erase(std::remove(engines.begin(), engines.end(), "mutex"), engines.end());
+	engines.insert(engines.begin(), "mutex");
+
+	std::printf("%d CPUs\n", cpus);
+	std::printf("%-14s %6s %7s %12s %10s %10s %10s %12s %9s %9s\n",
+		"engine", "factor", "threads", "ops/sec", "p50 ns", "p99 ns", "p99.9 ns", "max ns", "x mutex", "p99.9 x");
+
+	int runs = 0;
+	for (int factor : base.oversubFactors)
+	{
+		BenchConfig config = base;
+		config.threads = cpus * factor;
+		config.pinCpus.clear();
+		config.placement = "none";
+		config.recordLatency = true;
+
+		double baseOps = 0.0;
+		double baseTail = 0.0;
+		for (const auto& engine : engines)
+		{
+			BenchResult r = RunEngine(engine, config);
+			LatencyHistogram all = r.AllLatency();
+			double tail = static_cast<double>(all.Percentile(99.9));
+			if (engine == "mutex")
+			{
+				baseOps = r.opsPerSec;
+				baseTail = tail;
+			}
+			std::printf("%-14s %5dx %7d %12.0f %10llu %10llu %10llu %12llu %8.2fx %8.2fx\n",
+				engine.c_str(), factor, config.threads, r.opsPerSec,
+				(unsigned long long)all.Percentile(50.0), (unsigned long long)all.Percentile(99.0),
+				(unsigned long long)all.Percentile(99.9), (unsigned long long)all.Max(),
+				baseOps > 0.0 ? r.opsPerSec / baseOps : 0.0, baseTail > 0.0 ? tail / baseTail : 0.0);
+			std::fflush(stdout);
+			runs++;
+		}
+	}
+	return runs;
+}
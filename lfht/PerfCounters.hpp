@@ -0,0 +1,203 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Hardware events counted per worker thread
+enum class PerfEvent
+{
+	Cycles,
+	Instructions,
+	L1DMisses,
+	LlcMisses,
+	DtlbMisses,
+	BranchMisses
+};
+
+constexpr int PERF_EVENT_COUNT = 6;
+static const char* PERF_EVENT_NAMES[PERF_EVENT_COUNT] = { "cycles", "instructions", "L1D miss", "LLC miss", "dTLB miss", "branch miss" };
+
+// Event totals of one or more threads. An event is only valid if every
+// thread could count it.
+struct PerfCounts
+{
+	double values[PERF_EVENT_COUNT] = {};
+	bool valid[PERF_EVENT_COUNT] = {};
+	int threads = 0;
+
+	// @brief Add the counts of another thread.
+	void Merge(const PerfCounts& other)
+	{
+		if (other.threads == 0)
+			return;
+		for (int i = 0; i < PERF_EVENT_COUNT; ++i)
+		{
+			values[i] += other.values[i];
+			valid[i] = (threads == 0 || valid[i]) && other.valid[i];
+		}
+		threads += other.threads;
+	}
+
+	bool Valid(PerfEvent e) const { return threads > 0 && valid[static_cast<int>(e)]; }
+	double Value(PerfEvent e) const { return values[static_cast<int>(e)]; }
+
+	// @brief Whether any event could be counted.
+	bool Any() const
+	{
+		for (int i = 0; i < PERF_EVENT_COUNT; ++i)
+		{
+			if (Valid(static_cast<PerfEvent>(i)))
+				return true;
+		}
+		return false;
+	}
+};
+
+// Hardware counters of the calling thread, through perf_event_open.
+// Every event is opened on its own rather than as a group: six hardware
+// events often do not fit the PMU at once, and a group that does not fit is
+// never scheduled. The kernel multiplexes the events instead and the counts
+// are scaled by the time each one was actually running.
+class PerfCounterSet
+{
+public:
+	PerfCounterSet()
+	{
+		for (int& fd : m_fds)
+			fd = -1;
+	}
+
+	~PerfCounterSet()
+	{
+		Close();
+	}
+
+	PerfCounterSet(const PerfCounterSet&) = delete;
+	PerfCounterSet& operator=(const PerfCounterSet&) = delete;
+
+	// @brief Open the counters for the calling thread, user space only.
+	// @return True if at least one event could be opened.
+	bool Open()
+	{
+		bool any = false;
+#ifdef __linux__
+		for (int i = 0; i < PERF_EVENT_COUNT; ++i)
+		{
+			perf_event_attr attr;
+			std::memset(&attr, 0, sizeof(attr));
+			attr.size = sizeof(attr);
+			attr.disabled = 1;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+			configure(static_cast<PerfEvent>(i), attr);
+			m_fds[i] = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+			any = any || m_fds[i] >= 0;
+		}
+#endif
+		return any;
+	}
+
+	// @brief Reset and start counting.
+	void Start()
+	{
+#ifdef __linux__
+		for (int fd : m_fds)
+		{
+			if (fd < 0)
+				continue;
+			ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+			ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+#endif
+	}
+
+	// @brief Stop counting.
+	void Stop()
+	{
+#ifdef __linux__
+		for (int fd : m_fds)
+		{
+			if (fd >= 0)
+				ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+		}
+#endif
+	}
+
+	// @brief Read the counts since Start, scaled for multiplexing.
+	PerfCounts Read() const
+	{
+		PerfCounts counts;
+		counts.threads = 1;
+#ifdef __linux__
+		for (int i = 0; i < PERF_EVENT_COUNT; ++i)
+		{
+			uint64_t data[3] = {};  // value, time enabled, time running
+			if (m_fds[i] < 0 || read(m_fds[i], data, sizeof(data)) != static_cast<ssize_t>(sizeof(data)))
+				continue;
+			if (data[2] == 0)
+				continue;  // never got a hardware counter
+			counts.values[i] = static_cast<double>(data[0]) * data[1] / data[2];
+			counts.valid[i] = true;
+		}
+#endif
+		return counts;
+	}
+
+	void Close()
+	{
+#ifdef __linux__
+		for (int& fd : m_fds)
+		{
+			if (fd >= 0)
+				close(fd);
+			fd = -1;
+		}
+#endif
+	}
+
+private:
+	int m_fds[PERF_EVENT_COUNT];
+
+#ifdef __linux__
+	static void configure(PerfEvent e, perf_event_attr& attr)
+	{
+		auto cacheMiss = [](uint64_t cache)
+		{
+			return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		};
+		switch (e)
+		{
+		case PerfEvent::Cycles:
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = PERF_COUNT_HW_CPU_CYCLES;
+			break;
+		case PerfEvent::Instructions:
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+			break;
+		case PerfEvent::L1DMisses:
+			attr.type = PERF_TYPE_HW_CACHE;
+			attr.config = cacheMiss(PERF_COUNT_HW_CACHE_L1D);
+			break;
+		case PerfEvent::LlcMisses:
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = PERF_COUNT_HW_CACHE_MISSES;
+			break;
+		case PerfEvent::DtlbMisses:
+			attr.type = PERF_TYPE_HW_CACHE;
+			attr.config = cacheMiss(PERF_COUNT_HW_CACHE_DTLB);
+			break;
+		case PerfEvent::BranchMisses:
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+			break;
+		}
+	}
+#endif
+};
@@ -0,0 +1,269 @@
+#pragma once
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "BenchConfig.hpp"
+#include "BenchDriver.hpp"
+#include "BenchEngines.hpp"
+#include "MiniJson.hpp"
+
+// The fixed workload set the regression gate measures. Keep it stable:
+// baselines are only comparable when the set and the settings match.
+struct StandardWorkload
+{
+	const char* name;
+	const char* ycsb;   // preset letter, or nullptr to use the mix below
+	const char* mix;
+	double prefill;
+};
+
+static const StandardWorkload STANDARD_WORKLOADS[] = {
+	{ "ycsb-a", "a", nullptr, 1.0 },
+	{ "ycsb-b", "b", nullptr, 1.0 },
+	{ "ycsb-c", "c", nullptr, 1.0 },
+	{ "mixed", nullptr, "50:25:25", 0.5 },
+	{ "churn", nullptr, "0:50:50", 0.5 },
+};
+
+// Repeated measurements of one workload/engine/thread count
+struct RegressionSample
+{
+	std::string name;
+	std::vector<double> throughput;  // ops/sec per repetition
+	std::vector<double> p99;         // ns per repetition
+};
+
+// Mean and 95% confidence interval half-width of a set of samples
+struct SampleStats
+{
+	double mean = 0.0;
+	double stddev = 0.0;
+	double ci95 = 0.0;
+	size_t n = 0;
+};
+
+// @brief Two-sided 95% Student t critical value.
+// @param df Degrees of freedom.
+inline double StudentT95(double df)
+{
+	static const double TABLE[] = { 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+		2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+		2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+	if (df < 1.0)
+		df = 1.0;
+	int i = static_cast<int>(df);
+	return i <= 30 ? TABLE[i - 1] : 1.96;
+}
+
+// @brief Mean, standard deviation and 95% CI of samples.
+inline SampleStats ComputeStats(const std::vector<double>& samples)
+{
+	SampleStats s;
+	s.n = samples.size();
+	if (s.n == 0)
+		return s;
+	for (double v : samples)
+		s.mean += v;
+	s.mean /= s.n;
+	if (s.n < 2)
+		return s;
+	double sq = 0.0;
+	for (double v : samples)
+		sq += (v - s.mean) * (v - s.mean);
+	s.stddev = std::sqrt(sq / (s.n - 1));
+	s.ci95 = StudentT95(static_cast<double>(s.n - 1)) * s.stddev / std::sqrt(static_cast<double>(s.n));
+	return s;
+}
+
+// @brief Welch's t statistic of the difference of two means.
+// @param a, b Statistics of at least 2 samples each, not both without spread.
+// @param df Receives the Welch-Satterthwaite degrees of freedom.
+// @return (a.mean - b.mean) over its standard error.
+inline double WelchT(const SampleStats& a, const SampleStats& b, double& df)
+{
+	double va = a.stddev * a.stddev / a.n;
+	double vb = b.stddev * b.stddev / b.n;
+	df = (va + vb) * (va + vb) / (va * va / (a.n - 1) + vb * vb / (b.n - 1));
+	return (a.mean - b.mean) / std::sqrt(va + vb);
+}
+
+// @brief Welch's t-test at 95%: is the difference of the means significant?
+inline bool SignificantlyDifferent(const SampleStats& a, const SampleStats& b)
+{
+	if (a.n < 2 || b.n < 2)
+		return true;  // no spread information, rely on the threshold alone
+	if (a.stddev == 0.0 && b.stddev == 0.0)
+		return a.mean != b.mean;
+	double df;
+	double t = std::fabs(WelchT(a, b, df));
+	return t > StudentT95(df);
+}
+
+// @brief Thread counts the gate runs each workload at.
+inline std::vector<int> RegressionThreadCounts(const BenchConfig& config)
+{
+	std::vector<int> counts{ 1 };
+	if (config.threads > 1)
+		counts.push_back(config.threads);
+	return counts;
+}
+
+// @brief Run the standard workload set, reps times each.
+// @param base Duration, key range, threads, reps and engines come from here.
+// @param engines The engines to measure.
+inline std::vector<RegressionSample> RunStandardWorkloads(const BenchConfig& base, const std::vector<std::string>& engines)
+{
+	std::vector<RegressionSample> samples;
+	for (const auto& w : STANDARD_WORKLOADS)
+	{
+		for (const auto& engine : engines)
+		{
+			for (int threads : RegressionThreadCounts(base))
+			{
+				BenchConfig config = base;
+				config.threads = threads;
+				config.targetRate = 0.0;
+				config.recordLatency = true;
+				config.workload = WorkloadSpec();
+				if (w.ycsb)
+					ApplyYcsbPreset(w.ycsb, config.workload);
+				else
+					ParseOpMix(w.mix, config.workload);
+				config.workload.prefill = w.prefill;
+
+				RegressionSample sample;
+				sample.name = std::string(w.name) + "/" + engine + "/" + std::to_string(threads) + "t";
+				for (int rep = 0; rep < base.reps; ++rep)
+				{
+					config.seed = base.seed + rep;
+					BenchResult r = RunEngine(engine, config);
+					sample.throughput.push_back(r.opsPerSec);
+					sample.p99.push_back(static_cast<double>(r.AllLatency().Percentile(99.0)));
+				}
+				SampleStats t = ComputeStats(sample.throughput);
+				std::printf("  %-28s %12.0f ops/sec +/- %.1f%%\n", sample.name.c_str(), t.mean,
+					t.mean > 0.0 ? 100.0 * t.ci95 / t.mean : 0.0);
+				std::fflush(stdout);
+				samples.push_back(std::move(sample));
+			}
+		}
+	}
+	return samples;
+}
+
+// @brief Write measured samples as a baseline file.
+// @return False if the file could not be written.
+inline bool WriteBaseline(const std::string& path, const BenchConfig& config, const std::vector<RegressionSample>& samples)
+{
+	FILE* f = std::fopen(path.c_str(), "w");
+	if (!f)
+		return false;
+	std::fprintf(f, "{\n  \"version\": 1,\n  \"duration_sec\": %g,\n  \"keys\": %llu,\n  \"threads\": %d,\n  \"placement\": \"%s\",\n  \"samples\": [\n",
+		config.durationSec, (unsigned long long)config.keyRange, config.threads, config.placement.c_str());
+	for (size_t i = 0; i < samples.size(); ++i)
+	{
+		const RegressionSample& s = samples[i];
+		std::fprintf(f, "    {\"name\": \"%s\", \"throughput\": [", s.name.c_str());
+		for (size_t j = 0; j < s.throughput.size(); ++j)
+			std::fprintf(f, "%s%.1f", j ? ", " : "", s.throughput[j]);
+		std::fprintf(f, "], \"p99_ns\": [");
+		for (size_t j = 0; j < s.p99.size(); ++j)
+			std::fprintf(f, "%s%.0f", j ? ", " : "", s.p99[j]);
+		std::fprintf(f, "]}%s\n", i + 1 < samples.size() ? "," : "");
+	}
+	std::fprintf(f, "  ]\n}\n");
+	std::fclose(f);
+	return true;
+}
+
+// @brief Read a baseline file written by WriteBaseline.
+// @param path The file.
+// @param config Receives the duration, key range, threads and placement the baseline was taken with.
+// @param samples Receives the samples.
+// @param error Set on failure.
+// @return True on success.
+inline bool ReadBaseline(const std::string& path, BenchConfig& config, std::vector<RegressionSample>& samples, std::string& error)
+{
+	std::ifstream in(path);
+	if (!in)
+	{
+		error = "cannot open " + path;
+		return false;
+	}
+	std::stringstream text;
+	text << in.rdbuf();
+
+	JsonValue root;
+	if (!JsonParser::Parse(text.str(), root, error))
+		return false;
+	if (root["version"].NumberOr(0) != 1 || !root["samples"].IsArray())
+	{
+		error = path + " is not a version 1 baseline";
+		return false;
+	}
+
+	config.durationSec = root["duration_sec"].NumberOr(config.durationSec);
+	config.keyRange = static_cast<uint64_t>(root["keys"].NumberOr(static_cast<double>(config.keyRange)));
+	config.threads = static_cast<int>(root["threads"].NumberOr(config.threads));
+	config.placement = root["placement"].StringOr("none");
+	for (const auto& item : root["samples"].array)
+	{
+		RegressionSample s;
+		s.name = item["name"].StringOr("");
+		for (const auto& v : item["throughput"].array)
+			s.throughput.push_back(v.NumberOr(0.0));
+		for (const auto& v : item["p99_ns"].array)
+			s.p99.push_back(v.NumberOr(0.0));
+		samples.push_back(std::move(s));
+	}
+	return true;
+}
+
+// @brief Compare a new measurement against a baseline and print a report.
+// @param baseline The stored samples.
+// @param current The new samples.
+// @param throughputPct Allowed throughput drop in percent.
+// @param latencyPct Allowed p99 increase in percent.
+// @return The number of regressions: beyond the threshold and statistically significant.
+inline int CompareToBaseline(const std::vector<RegressionSample>& baseline, const std::vector<RegressionSample>& current,
+	double throughputPct, double latencyPct)
+{
+	int regressions = 0;
+	std::printf("%-28s %14s %14s %8s %10s %10s %8s  %s\n",
+		"workload", "base ops/s", "new ops/s", "delta", "base p99", "new p99", "delta", "verdict");
+	for (const auto& cur : current)
+	{
+		const RegressionSample* base = nullptr;
+		for (const auto& b : baseline)
+		{
+			if (b.name == cur.name)
+				base = &b;
+		}
+		if (!base)
+		{
+			std::printf("%-28s not in baseline\n", cur.name.c_str());
+			continue;
+		}
+
+		SampleStats bt = ComputeStats(base->throughput), ct = ComputeStats(cur.throughput);
+		SampleStats bl = ComputeStats(base->p99), cl = ComputeStats(cur.p99);
+		double dt = bt.mean > 0.0 ? 100.0 * (ct.mean - bt.mean) / bt.mean : 0.0;
+		double dl = bl.mean > 0.0 ? 100.0 * (cl.mean - bl.mean) / bl.mean : 0.0;
+
+		bool slower = dt < -throughputPct && SignificantlyDifferent(bt, ct);
+		bool tail = dl > latencyPct && SignificantlyDifferent(bl, cl);
+		const char* verdict = "ok";
+		if (slower && tail) verdict = "REGRESSION (throughput, p99)";
+		else if (slower) verdict = "REGRESSION (throughput)";
+		else if (tail) verdict = "REGRESSION (p99)";
+		if (slower || tail)
+			regressions++;
+
+		std::printf("%-28s %14.0f %14.0f %+7.1f%% %10.0f %10.0f %+7.1f%%  %s\n", cur.name.c_str(),
+			bt.mean, ct.mean, dt, bl.mean, cl.mean, dl, verdict);
+	}
+	return regressions;
+}
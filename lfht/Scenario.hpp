@@ -0,0 +1,171 @@
+#pragma once
+#include <cstdio>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "BenchConfig.hpp"
+#include "BenchDriver.hpp"
+#include "BenchEngines.hpp"
+#include "IniFile.hpp"
+#include "Sweep.hpp"
+
+// One phase of a scenario, a complete benchmark configuration
+struct ScenarioPhase
+{
+	std::string name;
+	BenchConfig config;
+};
+
+// Phases run back to back against one table
+struct Scenario
+{
+	BenchConfig base;  // the [scenario] settings: keys, prefill, threads of the prefill...
+	std::vector<ScenarioPhase> phases;
+};
+
+// Measured result of one phase
+struct ScenarioPoint
+{
+	std::string engine;
+	std::string phase;
+	BenchConfig config;
+	BenchResult result;
+	size_t live;       // table size at the end of the phase
+	size_t buckets;
+};
+
+// @brief Apply the settings of a section as if each "key = value" was "--key value"
+// on the command line. Underscores in keys become dashes, "true" stands for a flag.
+// @param section The section.
+// @param config The config to update.
+// @param error Set on failure.
+// @return True on success.
+inline bool ApplyIniSection(const IniSection& section, BenchConfig& config, std::string& error)
+{
+	std::vector<std::string> args{ "scenario" };
+	for (const auto& kv : section.values)
+	{
+		std::string option = "--" + kv.first;
+		for (char& c : option)
+			c = c == '_' ? '-' : c;
+		if (kv.second == "false")
+			continue;
+		args.push_back(option);
+		if (kv.second != "true")
+			args.push_back(kv.second);
+	}
+
+	std::vector<char*> argv;
+	for (auto& a : args)
+		argv.push_back(&a[0]);
+	if (!ParseBenchArgs(static_cast<int>(argv.size()), argv.data(), config, error))
+	{
+		error = "[" + section.name + "] (line " + std::to_string(section.line) + "): " +
+			(error.empty() ? "unexpected help option" : error);
+		return false;
+	}
+	return true;
+}
+
+// @brief Read a scenario file.
+// [scenario] holds the settings shared by all phases (and the prefill),
+// each [phase NAME] section starts from those and sets its own.
+// @param path The INI file.
+// @param base The command line settings the file builds on.
+// @param scenario Receives the phases.
+// @param error Set on failure.
+// @return True on success.
+inline bool LoadScenario(const std::string& path, const BenchConfig& base, Scenario& scenario, std::string& error)
+{
+	std::vector<IniSection> sections;
+	if (!IniFile::Load(path, sections, error))
+		return false;
+
+	scenario.base = base;
+	for (const auto& s : sections)
+	{
+		if ((s.name.empty() || s.name == "scenario") && !ApplyIniSection(s, scenario.base, error))
+			return false;
+	}
+	for (const auto& s : sections)
+	{
+		if (s.name.empty() || s.name == "scenario")
+			continue;
+		if (s.name.compare(0, 6, "phase ") != 0)
+		{
+			error = "unknown section [" + s.name + "], expected [scenario] or [phase NAME]";
+			return false;
+		}
+		ScenarioPhase phase{ s.name.substr(6), scenario.base };
+		if (!ApplyIniSection(s, phase.config, error))
+			return false;
+		scenario.phases.push_back(phase);
+	}
+	if (scenario.phases.empty())
+	{
+		error = path + " has no [phase NAME] sections";
+		return false;
+	}
+	return true;
+}
+
+// @brief Prefill one engine and run all phases of a scenario on it.
+// @param scenario The scenario.
+// @param engine One of ENGINE_NAMES.
+// @return One point per phase.
+inline std::vector<ScenarioPoint> RunScenario(const Scenario& scenario, const std::string& engine)
+{
+	return WithEngine(engine, scenario.base, [&](auto& table)
+	{
+		using Table = std::remove_reference_t<decltype(table)>;
+		WorkloadShared shared(scenario.base.workload, scenario.base.keyRange);
+		Prefill(table, shared, scenario.base.threads);
+
+		std::vector<ScenarioPoint> points;
+		for (const auto& phase : scenario.phases)
+		{
+			WorkloadShared phaseShared(phase.config.workload, phase.config.keyRange);
+			BenchResult r = RunPhase(table, phase.config, phaseShared);
+			ScenarioPoint p{ engine, phase.name, phase.config, r, TableProbe<Table>::Live(table), TableProbe<Table>::Buckets(table) };
+			LatencyHistogram all = r.AllLatency();
+			std::printf("%-12s %-14s %7d %-22s %7.1f %12.0f %10llu %10llu %10llu %8zu %10zu %10zu %10zu\n",
+				engine.c_str(), phase.name.c_str(), phase.config.threads, WorkloadLabel(phase.config.workload).c_str(),
+				phase.config.durationSec, r.opsPerSec, (unsigned long long)all.Percentile(50.0),
+				(unsigned long long)all.Percentile(99.0), (unsigned long long)all.Percentile(99.9),
+				r.resizes, r.retiredPeak, p.live, p.buckets);
+			std::fflush(stdout);
+			points.push_back(std::move(p));
+		}
+		return points;
+	});
+}
+
+// @brief Print the header of the per-phase table.
+inline void PrintScenarioHeader()
+{
+	std::printf("%-12s %-14s %7s %-22s %7s %12s %10s %10s %10s %8s %10s %10s %10s\n",
+		"engine", "phase", "threads", "workload", "sec", "ops/sec", "p50 ns", "p99 ns", "p99.9 ns",
+		"resizes", "retired pk", "live", "buckets");
+}
+
+// @brief Write scenario results as CSV, one row per engine and phase.
+// @return False if the file could not be written.
+inline bool WriteScenarioCsv(const std::string& path, const std::vector<ScenarioPoint>& points)
+{
+	FILE* f = std::fopen(path.c_str(), "w");
+	if (!f)
+		return false;
+	std::fprintf(f, "engine,phase,threads,placement,workload,key_offset,rate,duration_sec,ops,ops_per_sec,p50_ns,p99_ns,p999_ns,max_ns,resizes,retired_peak,live,buckets\n");
+	for (const auto& p : points)
+	{
+		LatencyHistogram all = p.result.AllLatency();
+		std::fprintf(f, "%s,%s,%d,%s,%s,%llu,%g,%g,%llu,%.1f,%llu,%llu,%llu,%llu,%zu,%zu,%zu,%zu\n",
+			p.engine.c_str(), p.phase.c_str(), p.config.threads, p.config.placement.c_str(),
+			WorkloadLabel(p.config.workload).c_str(), (unsigned long long)p.config.workload.keyOffset, p.config.targetRate, p.config.durationSec,
+			(unsigned long long)p.result.ops, p.result.opsPerSec, (unsigned long long)all.Percentile(50.0),
+			(unsigned long long)all.Percentile(99.0), (unsigned long long)all.Percentile(99.9),
+			(unsigned long long)all.Max(), p.result.resizes, p.result.retiredPeak, p.live, p.buckets);
+	}
+	std::fclose(f);
+	return true;
+}
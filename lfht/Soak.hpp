@@ -0,0 +1,208 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BenchConfig.hpp"
+#include "BenchDriver.hpp"
+#include "SystemStats.hpp"
+
+// One once-per-second sample of a soak run
+struct SoakSample
+{
+	double timeSec;
+	const char* phase;
+	uint64_t ops;            // during the last interval
+	uint64_t rssBytes;
+	size_t retired;
+	size_t hazardRecords;
+	size_t live;
+	size_t buckets;
+};
+
+// The soak cycles through these phases, fresh worker threads each time, so
+// thread churn, steady state, growth and shrinking are all exercised.
+struct SoakPhase
+{
+	const char* name;
+	const char* mix;  // nullptr = the configured workload
+};
+
+static const SoakPhase SOAK_PHASES[] = {
+	{ "mixed", nullptr },
+	{ "grow", "0:90:10" },
+	{ "shrink", "0:10:90" },
+};
+
+// Per-thread counters read by the sampling thread
+struct alignas(64) SoakCounter
+{
+	std::atomic<uint64_t> ops{ 0 };
+	std::atomic<int64_t> sizeDelta{ 0 };  // successful inserts minus successful removes
+};
+
+constexpr size_t SOAK_PHASE_COUNT = sizeof(SOAK_PHASES) / sizeof(SOAK_PHASES[0]);
+
+// @brief Whether a series kept growing over the run.
+// Growth means every value of the last third is more than 2% above every
+// value of the first third, so a series that levels off is not flagged.
+// @param series One value per sample.
+// @param warmup Samples to ignore at the start.
+// @return False if there are too few samples to tell.
+inline bool KeepsGrowing(const std::vector<double>& series, size_t warmup)
+{
+	if (series.size() < warmup + 9)
+		return false;
+	size_t n = series.size() - warmup;
+	auto first = series.begin() + warmup;
+	auto last = series.end() - n / 3;
+	double firstMax = *std::max_element(first, first + n / 3);
+	double lastMin = *std::min_element(last, series.end());
+	return lastMin > firstMax * 1.02;
+}
+
+// @brief Write soak samples as CSV.
+// @return False if the file could not be written.
+inline bool WriteSoakCsv(const std::string& path, const std::vector<SoakSample>& samples)
+{
+	FILE* f = std::fopen(path.c_str(), "w");
+	if (!f)
+		return false;
+	std::fprintf(f, "time_sec,phase,ops,rss_bytes,retired,hazard_records,live,buckets\n");
+	for (const auto& s : samples)
+	{
+		std::fprintf(f, "%.1f,%s,%llu,%llu,%zu,%zu,%zu,%zu\n", s.timeSec, s.phase, (unsigned long long)s.ops,
+			(unsigned long long)s.rssBytes, s.retired, s.hazardRecords, s.live, s.buckets);
+	}
+	std::fclose(f);
+	return true;
+}
+
+// @brief Run the soak phases against a table until config.soakSec has passed,
+// sampling memory and table internals once per second.
+// @param table The table, empty.
+// @param config Threads, key range, workload, soak length and phase length.
+// @param samples Receives the samples.
+// @return The number of series that kept growing.
+template <typename Table>
+int RunSoak(Table& table, const BenchConfig& config, std::vector<SoakSample>& samples)
+{
+	using Clock = std::chrono::steady_clock;
+	WorkloadShared prefill(config.workload, config.keyRange);
+	uint64_t prefilled = 0;
+	Prefill(table, prefill, config.threads, nullptr, &prefilled);
+	// Entries before the current phase. The live series adds the workers'
+	// deltas to it instead of reading the table's count, which a remove can
+	// take below 0 before the matching insert has counted itself.
+	int64_t liveBase = static_cast<int64_t>(prefilled);
+
+	std::printf("%8s %-7s %12s %10s %10s %8s %10s %10s\n",
+		"time s", "phase", "ops/sec", "rss MB", "retired", "hazards", "live", "buckets");
+
+	const Clock::time_point begin = Clock::now();
+	const Clock::time_point deadline = begin + std::chrono::duration_cast<Clock::duration>(
+		std::chrono::duration<double>(config.soakSec));
+	Clock::time_point nextSample = begin + std::chrono::seconds(1);
+	uint64_t lastOps = 0;
+
+	for (int phase = 0; Clock::now() < deadline; ++phase)
+	{
+		const SoakPhase& p = SOAK_PHASES[phase % SOAK_PHASE_COUNT];
+		WorkloadSpec spec = config.workload;
+		if (p.mix)
+			ParseOpMix(p.mix, spec);
+		WorkloadShared shared(spec, config.keyRange);
+
+		std::vector<SoakCounter> counters(config.threads);
+		std::atomic<bool> stop{ false };
+		std::vector<std::thread> workers;
+		for (int t = 0; t < config.threads; ++t)
+		{
+			workers.emplace_back([&, t]()
+			{
+				WorkloadGenerator gen(shared, (config.seed + phase) * 0x9E3779B97F4A7C15ULL + t, t, config.threads);
+				uint64_t ops = 0;
+				int64_t sizeDelta = 0;
+				while (!stop.load(std::memory_order_relaxed))
+				{
+					OpType op = gen.NextOp();
+					ExecuteOp(table, op, gen.NextKey(op), sizeDelta);
+					counters[t].ops.store(++ops, std::memory_order_relaxed);
+					counters[t].sizeDelta.store(sizeDelta, std::memory_order_relaxed);
+				}
+			});
+		}
+
+		const Clock::time_point phaseEnd = std::min(deadline, Clock::now() +
+			std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(config.soakPhaseSec)));
+		while (nextSample <= phaseEnd)
+		{
+			std::this_thread::sleep_until(nextSample);
+			uint64_t ops = 0;
+			int64_t live = liveBase;
+			for (const auto& c : counters)
+			{
+				ops += c.ops.load(std::memory_order_relaxed);
+				live += c.sizeDelta.load(std::memory_order_relaxed);
+			}
+
+			SoakSample s;
+			s.timeSec = std::chrono::duration<double>(Clock::now() - begin).count();
+			s.phase = p.name;
+			s.ops = ops - lastOps;
+			s.rssBytes = ReadRssBytes();
+			s.retired = TableProbe<Table>::Retired(table);
+			s.hazardRecords = TableProbe<Table>::HazardRecords(table);
+			// The workers' counters are read one by one, a remove may be seen before its insert
+			s.live = static_cast<size_t>(std::max<int64_t>(live, 0));
+			s.buckets = TableProbe<Table>::Buckets(table);
+			samples.push_back(s);
+			lastOps = ops;
+			nextSample += std::chrono::seconds(1);
+
+			std::printf("%8.0f %-7s %12llu %10.1f %10zu %8zu %10zu %10zu\n", s.timeSec, s.phase,
+				(unsigned long long)s.ops, s.rssBytes / (1024.0 * 1024.0), s.retired, s.hazardRecords, s.live, s.buckets);
+			std::fflush(stdout);
+		}
+
+		stop.store(true, std::memory_order_relaxed);
+		for (auto& w : workers)
+			w.join();
+		for (const auto& c : counters)
+			liveBase += c.sizeDelta.load(std::memory_order_relaxed);
+		lastOps = 0;
+	}
+
+	// Flag every series that never came back down. The first cycle of
+	// phases is warm-up (the table reaches its largest size there), unless
+	// the run is too short to have more than that.
+	size_t warmup = 0;
+	while (warmup < samples.size() && samples[warmup].timeSec < SOAK_PHASE_COUNT * config.soakPhaseSec)
+		warmup++;
+	if (samples.size() < warmup + 9)
+		warmup = samples.size() / 10;
+
+	std::vector<std::pair<const char*, std::vector<double>>> series = {
+		{ "rss", {} }, { "retired", {} }, { "hazard records", {} }, { "live nodes", {} }, { "buckets", {} } };
+	for (const auto& s : samples)
+	{
+		series[0].second.push_back(static_cast<double>(s.rssBytes));
+		series[1].second.push_back(static_cast<double>(s.retired));
+		series[2].second.push_back(static_cast<double>(s.hazardRecords));
+		series[3].second.push_back(static_cast<double>(s.live));
+		series[4].second.push_back(static_cast<double>(s.buckets));
+	}
+
+	int growing = 0;
+	std::printf("%zu samples, %zu warm-up\n", samples.size(), warmup);
+	for (const auto& s : series)
+	{
+		bool grows = KeepsGrowing(s.second, warmup);
+		std::printf("  %-16s %s\n", s.first, s.second.size() < warmup + 9 ? "too few samples" : (grows ? "GROWING" : "steady"));
+		growing += grows ? 1 : 0;
+	}
+	return growing;
+}
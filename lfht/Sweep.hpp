@@ -0,0 +1,146 @@
+#pragma once
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "BenchConfig.hpp"
+#include "BenchDriver.hpp"
+#include "BenchEngines.hpp"
+#include "Topology.hpp"
+
+// One measured run of a thread-scaling sweep
+struct SweepPoint
+{
+	std::string engine;
+	std::string layout;
+	int threads;
+	int rep;
+	BenchResult result;
+};
+
+// @brief Thread counts of a sweep: powers of two up to max, plus max itself.
+// @param maxThreads The largest thread count.
+inline std::vector<int> SweepThreadCounts(int maxThreads)
+{
+	std::vector<int> counts;
+	for (int t = 1; t < maxThreads; t *= 2)
+		counts.push_back(t);
+	counts.push_back(maxThreads);
+	return counts;
+}
+
+// @brief Describe the op mix and key distribution of a workload.
+inline std::string WorkloadLabel(const WorkloadSpec& w)
+{
+	char buf[128];
+	std::snprintf(buf, sizeof(buf), "%d:%d:%d:%d:%d %s", w.readPct, w.insertPct, w.removePct,
+		w.updatePct, w.rmwPct, KeyDistName(w.dist));
+	return buf;
+}
+
+// @brief Run every engine at every thread count and layout, reps times each.
+// @param base The workload; threads and pinning are overridden per point.
+// @param engines The engines to run.
+// @return All measured points, in the order they ran.
+inline std::vector<SweepPoint> RunSweep(const BenchConfig& base, const std::vector<std::string>& engines)
+{
+	std::vector<CpuInfo> cpus = DiscoverCpus();
+	int maxThreads = base.maxThreads > 0 ? base.maxThreads : static_cast<int>(cpus.size());
+
+	std::vector<std::string> layouts = base.layouts;
+	if (layouts.empty())
+	{
+		layouts.push_back("cores");
+		if (HasSmt(cpus))
+			layouts.push_back("smt");
+	}
+
+	std::printf("%-14s %-7s %7s %4s %12s %10s %10s %10s %8s %12s %10s\n",
+		"engine", "layout", "threads", "rep", "ops/sec", "p50 ns", "p99 ns", "p99.9 ns", "resizes", "retired pk", "rss MB");
+
+	std::vector<SweepPoint> points;
+	for (const auto& engine : engines)
+	{
+		for (const auto& layout : layouts)
+		{
+			for (int threads : SweepThreadCounts(maxThreads))
+			{
+				for (int rep = 0; rep < base.reps; ++rep)
+				{
+					BenchConfig config = base;
+					config.threads = threads;
+					config.seed = base.seed + rep;
+					if (base.pin)
+						config.pinCpus = PlacementOrder(cpus, layout);
+
+					SweepPoint p{ engine, base.pin ? layout : "none", threads, rep, RunEngine(engine, config) };
+					LatencyHistogram all = p.result.AllLatency();
+					std::printf("%-14s %-7s %7d %4d %12.0f %10llu %10llu %10llu %8zu %12zu %10.1f\n",
+						engine.c_str(), p.layout.c_str(), threads, rep, p.result.opsPerSec,
+						(unsigned long long)all.Percentile(50.0), (unsigned long long)all.Percentile(99.0),
+						(unsigned long long)all.Percentile(99.9), p.result.resizes, p.result.retiredPeak,
+						p.result.rssBytes / (1024.0 * 1024.0));
+					std::fflush(stdout);
+					points.push_back(std::move(p));
+				}
+			}
+			if (!base.pin)
+				break;  // layouts only differ in pinning
+		}
+	}
+	return points;
+}
+
+// @brief Write sweep points as CSV, one row per run.
+// @return False if the file could not be written.
+inline bool WriteSweepCsv(const std::string& path, const BenchConfig& config, const std::vector<SweepPoint>& points)
+{
+	FILE* f = std::fopen(path.c_str(), "w");
+	if (!f)
+		return false;
+	std::fprintf(f, "engine,workload,keys,layout,threads,rep,ops,ops_per_sec,p50_ns,p90_ns,p99_ns,p999_ns,max_ns,resizes,retired_peak,rss_bytes\n");
+	std::string workload = WorkloadLabel(config.workload);
+	for (const auto& p : points)
+	{
+		LatencyHistogram all = p.result.AllLatency();
+		std::fprintf(f, "%s,%s,%llu,%s,%d,%d,%llu,%.1f,%llu,%llu,%llu,%llu,%llu,%zu,%zu,%llu\n",
+			p.engine.c_str(), workload.c_str(), (unsigned long long)config.keyRange, p.layout.c_str(),
+			p.threads, p.rep, (unsigned long long)p.result.ops, p.result.opsPerSec,
+			(unsigned long long)all.Percentile(50.0), (unsigned long long)all.Percentile(90.0),
+			(unsigned long long)all.Percentile(99.0), (unsigned long long)all.Percentile(99.9),
+			(unsigned long long)all.Max(), p.result.resizes, p.result.retiredPeak,
+			(unsigned long long)p.result.rssBytes);
+	}
+	std::fclose(f);
+	return true;
+}
+
+// @brief Write sweep points as JSON: the workload settings and an array of runs.
+// @return False if the file could not be written.
+inline bool WriteSweepJson(const std::string& path, const BenchConfig& config, const std::vector<SweepPoint>& points)
+{
+	FILE* f = std::fopen(path.c_str(), "w");
+	if (!f)
+		return false;
+	const WorkloadSpec& w = config.workload;
+	std::fprintf(f, "{\n  \"workload\": {\"mix\": [%d, %d, %d, %d, %d], \"dist\": \"%s\", \"theta\": %g, "
+		"\"keys\": %llu, \"prefill\": %g, \"duration_sec\": %g, \"rate\": %g},\n  \"points\": [\n",
+		w.readPct, w.insertPct, w.removePct, w.updatePct, w.rmwPct, KeyDistName(w.dist), w.zipfTheta,
+		(unsigned long long)config.keyRange, w.prefill, config.durationSec, config.targetRate);
+	for (size_t i = 0; i < points.size(); ++i)
+	{
+		const SweepPoint& p = points[i];
+		LatencyHistogram all = p.result.AllLatency();
+		std::fprintf(f, "    {\"engine\": \"%s\", \"layout\": \"%s\", \"threads\": %d, \"rep\": %d, "
+			"\"ops\": %llu, \"ops_per_sec\": %.1f, \"p50_ns\": %llu, \"p90_ns\": %llu, \"p99_ns\": %llu, "
+			"\"p999_ns\": %llu, \"max_ns\": %llu, \"resizes\": %zu, \"retired_peak\": %zu, \"rss_bytes\": %llu}%s\n",
+			p.engine.c_str(), p.layout.c_str(), p.threads, p.rep, (unsigned long long)p.result.ops,
+			p.result.opsPerSec, (unsigned long long)all.Percentile(50.0), (unsigned long long)all.Percentile(90.0),
+			(unsigned long long)all.Percentile(99.0), (unsigned long long)all.Percentile(99.9),
+			(unsigned long long)all.Max(), p.result.resizes, p.result.retiredPeak,
+			(unsigned long long)p.result.rssBytes, i + 1 < points.size() ? "," : "");
+	}
+	std::fprintf(f, "  ]\n}\n");
+	std::fclose(f);
+	return true;
+}
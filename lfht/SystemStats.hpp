@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+// @brief Read a "kB" field such as VmRSS from /proc/self/status.
+// @param field The field name including the colon, e.g. "VmRSS:".
+// @return The value in bytes, 0 if it cannot be read (e.g. not on Linux).
+inline uint64_t ReadProcStatusBytes(const std::string& field)
+{
+	std::ifstream in("/proc/self/status");
+	std::string name;
+	while (in >> name)
+	{
+		if (name == field)
+		{
+			uint64_t kb = 0;
+			in >> kb;
+			return kb * 1024;
+		}
+		std::getline(in, name);
+	}
+	return 0;
+}
+
+// @brief Current resident set size of the process in bytes.
+inline uint64_t ReadRssBytes()
+{
+	return ReadProcStatusBytes("VmRSS:");
+}
+
+// @brief Peak resident set size of the process in bytes.
+inline uint64_t ReadPeakRssBytes()
+{
+	return ReadProcStatusBytes("VmHWM:");
+}
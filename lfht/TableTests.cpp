@@ -0,0 +1,372 @@
+// TableTests.cpp
+// Correctness checks for LockFreeHashTable (make check). Exits non-zero if any check fails.
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+#include "LockFreeHashTable.hpp"
+
+static int g_failures = 0;
+
+#define CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			++g_failures; \
+		} \
+	} while (0)
+
+// Single thread: grow well past the initial array, then shrink back down.
+static void TestGrowAndShrink()
+{
+	LockFreeHashTable<int, std::string> table;
+	const int n = 10000;
+	for (int i = 0; i < n; ++i)
+		CHECK(table.insert(i, std::to_string(i)));
+	CHECK(!table.insert(42, "again"));
+	CHECK(table.getBucketSize() > 64);
+
+	for (int i = 0; i < n; ++i)
+		CHECK(table.contains(i));
+	CHECK(!table.contains(n));
+
+	for (int i = 0; i < n; i += 2)
+		CHECK(table.remove(i));
+	CHECK(!table.remove(0));
+	for (int i = 0; i < n; ++i)
+		CHECK(table.contains(i) == (i % 2 == 1));
+
+	for (int i = 1; i < n; i += 2)
+		CHECK(table.remove(i));
+	CHECK(table.getBucketSize() == 64);
+	for (int i = 0; i < n; ++i)
+		CHECK(!table.contains(i));
+}
+
+// Threads toggle their own keys in a table whose load factor stays between
+// the resize thresholds, so only find_bucket, insert and remove race.
+static void TestConcurrentToggle()
+{
+	LockFreeHashTable<uint64_t, uint64_t> table;
+	const int threads = 4;
+	const uint64_t keysPerThread = 16;
+	const int rounds = 20000;
+	for (uint64_t k = 0; k < 64; ++k)
+		table.insert(1000000 + k, k);
+
+	std::vector<std::thread> workers;
+	for (int t = 0; t < threads; ++t)
+	{
+		workers.emplace_back([&table, t]() {
+			const uint64_t base = t * keysPerThread;
+			for (int r = 0; r < rounds; ++r)
+			{
+				for (uint64_t k = base; k < base + keysPerThread; ++k)
+				{
+					if (!table.insert(k, k)) std::abort();
+					if (!table.contains(k)) std::abort();
+				}
+				// Leave every other key in on the last round
+				for (uint64_t k = base; k < base + keysPerThread; ++k)
+				{
+					if (r == rounds - 1 && k % 2 == 0) continue;
+					if (!table.remove(k)) std::abort();
+				}
+			}
+		});
+	}
+	for (auto& worker : workers) worker.join();
+
+	for (uint64_t k = 0; k < threads * keysPerThread; ++k)
+		CHECK(table.contains(k) == (k % 2 == 0));
+	for (uint64_t k = 0; k < 64; ++k)
+		CHECK(table.contains(1000000 + k));
+}
+
+// Threads insert distinct keys while the table grows from 64 buckets to
+// hundreds of thousands, then remove them all while it shrinks back. Writes
+// made while a resize is moving the buckets must not be lost.
+static void TestConcurrentResize()
+{
+	LockFreeHashTable<uint64_t, uint64_t> table;
+	const int threads = 4;
+	const uint64_t keysPerThread = 200000;
+	auto runAll = [&](auto&& work) {
+		std::vector<std::thread> workers;
+		for (int t = 0; t < threads; ++t)
+			workers.emplace_back(work, t);
+		for (auto& worker : workers) worker.join();
+	};
+
+	std::atomic<uint64_t> failed{ 0 };
+	runAll([&](int t) {
+		for (uint64_t k = t * keysPerThread; k < (t + 1) * keysPerThread; ++k)
+			if (!table.insert(k, k)) failed++;
+	});
+	CHECK(failed == 0);
+	CHECK(table.getCount() == threads * keysPerThread);
+	CHECK(table.getResizeCount() > 0);
+	uint64_t missing = 0;
+	for (uint64_t k = 0; k < threads * keysPerThread; ++k)
+		if (!table.contains(k)) missing++;
+	CHECK(missing == 0);
+
+	runAll([&](int t) {
+		for (uint64_t k = t * keysPerThread; k < (t + 1) * keysPerThread; ++k)
+			if (!table.remove(k)) failed++;
+	});
+	CHECK(failed == 0);
+	CHECK(table.getCount() == 0);
+	CHECK(table.getBucketSize() == 64);
+	uint64_t left = 0;
+	for (uint64_t k = 0; k < threads * keysPerThread; ++k)
+		if (table.contains(k)) left++;
+	CHECK(left == 0);
+}
+
+// Threads insert and remove their own keys at random while the load factor
+// keeps crossing the resize thresholds. Each thread tracks what it expects.
+static void TestChurnAcrossResizes()
+{
+	LockFreeHashTable<uint64_t, std::string> table;
+	const int threads = 4;
+	const uint64_t keysPerThread = 4096;
+	std::vector<std::vector<bool>> present(threads, std::vector<bool>(keysPerThread, false));
+
+	std::vector<std::thread> workers;
+	for (int t = 0; t < threads; ++t)
+	{
+		workers.emplace_back([&table, &present, t]() {
+			std::vector<bool>& mine = present[t];
+			uint64_t x = 0x9E3779B97F4A7C15ull * (t + 1);
+			for (int i = 0; i < 400000; ++i)
+			{
+				x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+				// Phases of mostly inserts and mostly removes move the count up and down
+				const bool grow = (i / 50000) % 2 == 0;
+				const uint64_t k = x % keysPerThread;
+				const uint64_t key = t * keysPerThread + k;
+				if ((x >> 32) % 4 != 0 ? grow : !grow)
+				{
+					if (table.insert(key, std::to_string(key)) == mine[k]) std::abort();
+					mine[k] = true;
+				}
+				else
+				{
+					if (table.remove(key) != mine[k]) std::abort();
+					mine[k] = false;
+				}
+			}
+		});
+	}
+	for (auto& worker : workers) worker.join();
+
+	size_t expected = 0;
+	uint64_t wrong = 0;
+	for (int t = 0; t < threads; ++t)
+	{
+		for (uint64_t k = 0; k < keysPerThread; ++k)
+		{
+			expected += present[t][k];
+			if (table.contains(t * keysPerThread + k) != present[t][k]) wrong++;
+		}
+	}
+	CHECK(wrong == 0);
+	CHECK(table.getCount() == expected);
+	CHECK(table.getResizeCount() > 2);
+}
+
+// Threads fill and drain the table over and over. The arrays each resize
+// replaces must be freed as it goes, not kept until the table is destroyed.
+static void TestOldArraysFreed()
+{
+	LockFreeHashTable<uint64_t, uint64_t> table;
+	const int threads = 4;
+	const uint64_t keysPerThread = 25000;
+	const int cycles = 30;
+	size_t peakArrayBytes = 0;
+	size_t maxOldBytes = 0;
+	size_t resizes = 0;
+	for (int c = 0; c < cycles; ++c)
+	{
+		std::vector<std::thread> workers;
+		for (int t = 0; t < threads; ++t)
+		{
+			workers.emplace_back([&table, t]() {
+				for (uint64_t k = t * keysPerThread; k < (t + 1) * keysPerThread; ++k)
+					if (!table.insert(k, k)) std::abort();
+			});
+		}
+		for (auto& worker : workers) worker.join();
+		peakArrayBytes = std::max(peakArrayBytes, table.memory_usage().bucket_array_bytes);
+
+		workers.clear();
+		for (int t = 0; t < threads; ++t)
+		{
+			workers.emplace_back([&table, t]() {
+				for (uint64_t k = t * keysPerThread; k < (t + 1) * keysPerThread; ++k)
+					if (!table.remove(k)) std::abort();
+			});
+		}
+		for (auto& worker : workers) worker.join();
+		maxOldBytes = std::max(maxOldBytes, table.memory_usage().old_array_bytes);
+	}
+	resizes = table.getResizeCount();
+
+	CHECK(table.getCount() == 0);
+	CHECK(resizes >= static_cast<size_t>(cycles) * 20);
+	// Only arrays a thread was still holding at the last resize are left, at
+	// most two per thread, never the hundreds of arrays the cycles replaced
+	CHECK(maxOldBytes <= 2 * (threads + 1) * peakArrayBytes);
+}
+
+// After threads fill and drain the table, memory_usage() is back near what the
+// empty table reported: one minimal array, no old arrays, a few retired nodes.
+static void TestMemoryAfterDrain()
+{
+	// Its own K and V: the retired list and hazard records are shared per type
+	LockFreeHashTable<uint32_t, uint64_t> table;
+	table.insert(0, 0);
+	table.remove(0);
+	const MemoryUsage base = table.memory_usage();
+	const int threads = 4;
+	const uint32_t keysPerThread = 50000;
+	MemoryUsage peak;
+	for (int c = 0; c < 3; ++c)
+	{
+		std::vector<std::thread> workers;
+		for (int t = 0; t < threads; ++t)
+		{
+			workers.emplace_back([&table, t]() {
+				for (uint32_t k = t * keysPerThread; k < (t + 1) * keysPerThread; ++k)
+					if (!table.insert(k, k)) std::abort();
+			});
+		}
+		for (auto& worker : workers) worker.join();
+		peak = table.memory_usage();
+
+		workers.clear();
+		for (int t = 0; t < threads; ++t)
+		{
+			workers.emplace_back([&table, t]() {
+				for (uint32_t k = t * keysPerThread; k < (t + 1) * keysPerThread; ++k)
+					if (!table.remove(k)) std::abort();
+			});
+		}
+		for (auto& worker : workers) worker.join();
+	}
+
+	const MemoryUsage after = table.memory_usage();
+	CHECK(peak.entries == threads * keysPerThread);
+	CHECK(after.entries == 0 && after.live_node_bytes == 0);
+	CHECK(after.bucket_array_bytes == base.bucket_array_bytes);
+	// A thread still on an array when the last shrinks replaced it may leave it behind
+	CHECK(after.old_array_bytes <= 8 * base.bucket_array_bytes);
+	CHECK(after.total() < base.total() + peak.total() / 100);
+}
+
+// sample_buckets counts every node and copies only the selected bucket.
+static void TestSampleBuckets()
+{
+	LockFreeHashTable<int, std::string> table;
+	const int n = 1000;
+	for (int i = 0; i < n; ++i)
+		table.insert(i, std::to_string(i));
+
+	std::vector<size_t> live;
+	std::vector<std::tuple<int, std::string, bool>> nodes;
+	size_t marked = 1;
+	const size_t selected = table.bucket_of(7, table.getBucketSize());
+	table.sample_buckets(live, marked, selected, nodes);
+	CHECK(live.size() == table.getBucketSize());
+	CHECK(marked == 0);
+	size_t total = 0;
+	for (size_t count : live)
+		total += count;
+	CHECK(total == static_cast<size_t>(n));
+	CHECK(nodes.size() == live[selected]);
+	bool seven = false;
+	for (const auto& node : nodes)
+	{
+		CHECK(table.bucket_of(std::get<0>(node), live.size()) == selected);
+		CHECK(std::get<1>(node) == std::to_string(std::get<0>(node)));
+		seven = seven || std::get<0>(node) == 7;
+	}
+	CHECK(seven);
+
+	table.sample_buckets(live, marked, live.size(), nodes);
+	CHECK(nodes.empty());
+}
+
+// Space-Saving counts overestimate by at most their error, the error is at most
+// total / N, and every item more frequent than total / N is kept.
+static void TestSpaceSaving()
+{
+	const size_t N = 8;
+	SpaceSaving<int, N> sketch;
+	std::vector<uint64_t> truth(100000, 0);
+	const int total = 100000;
+	for (int i = 0; i < total; ++i)
+	{
+		// 1 and 2 are heavy hitters, 3 is frequent but below total / N, the rest are rare
+		int item = i % 3 == 0 ? 1 : (i % 5 == 0 ? 2 : (i % 31 == 0 ? 3 : 1000 + i % 50000));
+		truth[item]++;
+		sketch.observe(item);
+	}
+	CHECK(sketch.used == N);
+	CHECK(truth[3] < total / N);
+	for (int heavy = 1; heavy <= 2; ++heavy)
+	{
+		CHECK(truth[heavy] > total / N);
+		bool kept = false;
+		for (size_t i = 0; i < sketch.used; ++i)
+			kept = kept || sketch.entries[i].item == heavy;
+		CHECK(kept);
+	}
+	uint64_t sum = 0;
+	for (size_t i = 0; i < sketch.used; ++i)
+	{
+		const HotItem<int>& e = sketch.entries[i];
+		CHECK(e.count >= truth[e.item]);
+		CHECK(e.count - e.error <= truth[e.item]);
+		CHECK(e.error <= total / N);
+		sum += e.count;
+	}
+	CHECK(sum == static_cast<uint64_t>(total));
+
+	// Merging per-thread sketches adds the counts and the errors of equal items
+	std::vector<HotItem<int>> merged;
+	sketch.merge_into(merged);
+	sketch.merge_into(merged);
+	CHECK(merged.size() == N);
+	for (const auto& m : merged)
+	{
+		CHECK(m.count >= 2 * truth[m.item]);
+		CHECK(m.count - m.error <= 2 * truth[m.item]);
+	}
+}
+
+int main()
+{
+	TestGrowAndShrink();
+	TestConcurrentToggle();
+	TestConcurrentResize();
+	TestChurnAcrossResizes();
+	TestSampleBuckets();
+	TestOldArraysFreed();
+	TestSpaceSaving();
+	TestMemoryAfterDrain();
+
+	if (g_failures)
+	{
+		std::fprintf(stderr, "%d check(s) failed\n", g_failures);
+		return 1;
+	}
+	std::printf("all table tests passed\n");
+	return 0;
+}
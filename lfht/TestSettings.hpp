@@ -5,36 +5,146 @@
 #include <sstream>
 #include <random>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <tuple>
+#include "MetricsSegment.hpp"
+#include "Topology.hpp"
+#include "TripleBuffer.hpp"
 
 const int MAX_HISTORY_SIZE = 200;
+const int HISTOGRAM_COLUMNS = 512;  // larger tables are drawn as min/avg/max of bucket groups
+const int CHAIN_LENGTH_BINS = 32;   // chain length 0 .. 30, the last bin holds 31 and longer
+const int HEATMAP_CELLS = 4096;     // larger tables color groups of buckets
+const int HEAT_METRICS = static_cast<int>(BucketContention::COUNT) + 1;  // the BucketStats and their sum
+static const char* HEAT_METRIC_NAMES[HEAT_METRICS] = { "CAS Failures", "Help Unlinks", "Retries", "All" };
+const int TIMELINE_TICK_MS = 100;
+const int TIMELINE_POINTS = 600;    // 60 seconds of ticks
+
+// Operations the workers time, rows of their LiveOpMetrics
+enum TimedOp
+{
+	TIMED_INSERT = 0,
+	TIMED_REMOVE = 1,
+	TIMED_OP_COUNT
+};
+static const char* TIMED_OP_NAMES[TIMED_OP_COUNT] = { "Insert", "Remove" };
+
+// One sample of the visual table, built by the sampler thread and read by the
+// UI. The sampler reuses the buffers, so they keep their capacity.
+struct TableFrame
+{
+	uint64_t sample = 0;  // number of the sample, 0 until the sampler published once
+	int selectedBucket = -1;  // bucket whose nodes were copied, -1 = none
+	std::vector<std::tuple<int, std::string, bool>> nodes;  // (key, value, marked) of selectedBucket
+	std::vector<float> activeCounts;  // unmarked nodes of each bucket
+	float maxActive = 0.0f;
+	size_t bucketsPerGroup = 1;  // buckets summarized by one entry of groupMin/Avg/Max
+	std::vector<float> groupMin;  // active nodes of the buckets of each group, at most HISTOGRAM_COLUMNS groups
+	std::vector<float> groupAvg;
+	std::vector<float> groupMax;
+	float chainLengths[CHAIN_LENGTH_BINS] = {};  // buckets by active nodes
+	float maxChainBin = 0.0f;
+	size_t activeNodes = 0;
+	size_t markedNodes = 0;
+	float loadFactor = 0.0f;
+	bool contentionEnabled = false;  // false: built without LFHT_ENABLE_STATS
+	double heatIntervalSec = 0.0;    // the heat counts events since the previous sample
+	size_t heatBucketsPerCell = 1;
+	std::vector<float> heat[HEAT_METRICS];  // events per cell, by HEAT_METRIC_NAMES
+	float heatMax[HEAT_METRICS] = {};
+	uint64_t heatTotal[HEAT_METRICS] = {};
+	size_t heatBuckets = 0;          // buckets with any event
+	float heatTopShare = 0.0f;       // share of all events in the busiest 1% of the buckets
+	HotSpots<int> hotSpots;          // the 10 hottest keys and buckets, empty without LFHT_ENABLE_STATS
+	float loadFactorHistory[MAX_HISTORY_SIZE] = {};  // ring buffer, the oldest value at historyOffset
+	int historySize = 0;
+	int historyOffset = 0;
+};
 
-struct BucketInfo {
-    int nodeCount;
+// The last TIMELINE_POINTS ticks of the workers' latency and throughput, built
+// by the sampler thread every TIMELINE_TICK_MS. All arrays are ring buffers with
+// the oldest point at offset.
+struct TimelineFrame
+{
+	int size = 0;
+	int offset = 0;
+	float p50[TIMED_OP_COUNT][TIMELINE_POINTS] = {};   // ns, of the operations of the tick
+	float p99[TIMED_OP_COUNT][TIMELINE_POINTS] = {};
+	float p999[TIMED_OP_COUNT][TIMELINE_POINTS] = {};
+	float opsPerSec[TIMELINE_POINTS] = {};
+	float resizes[TIMELINE_POINTS] = {};  // bucket arrays published during the tick
+	float scans[TIMELINE_POINTS] = {};    // reclamation scans during the tick
+
+	// @brief Ring index of the i-th oldest point.
+	int At(int i) const { return (offset + i) % TIMELINE_POINTS; }
+};
+
+// Worker types of TestSettings::WorkerFunction
+enum WorkerType
+{
+	WORKER_RANDOM = 0,
+	WORKER_INSERT = 1,
+	WORKER_REMOVE = 2,
+	WORKER_CALIBRATE = 3  // the worker loop without table operations, measures the harness itself
+};
+
+// Counters of one worker thread. Only the owning worker writes them, the UI
+// thread reads them once per frame. Each block has its own cache line so the
+// workers' bookkeeping does not contend.
+struct alignas(64) ThreadStats
+{
+	std::atomic<uint64_t> ops{ 0 };
+	std::atomic<uint64_t> inserts{ 0 };  // successful inserts
+	std::atomic<uint64_t> removes{ 0 };  // successful removes
+	std::atomic<uint64_t> busyNs{ 0 };   // time spent in the loop, without the throttling sleep
+	std::atomic<int> cpu{ -1 };          // CPU the worker is pinned to, -1 = not pinned
+
+	// @brief Add to a counter. There is a single writer, so no read-modify-write is needed.
+	static void Add(std::atomic<uint64_t>& counter, uint64_t n)
+	{
+		counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+	}
 };
 
 class TestSettings
 {
 public:
-	TestSettings(int maxThreads): m_maxThreads(maxThreads), m_threadOpCounts(maxThreads)
+	TestSettings(int maxThreads): m_threadStats(maxThreads), m_opMetrics(maxThreads), m_maxThreads(maxThreads)
 	{
 		m_pVisualTable = new VisualLockFreeHashTable<int, std::string>();
 		m_lastThreadCounts.resize(m_maxThreads, 0);
 		m_threadOpsPerSec.resize(m_maxThreads, 0);
 		m_runWorkers.store(false);
+		m_limitOps.store(false);
 		m_keyLimit = 64;
-		m_workerType = 0;
-
-		m_opInsertCount.store(0);
-		m_opRemoveCount.store(0);
-		for (auto& counter : m_threadOpCounts)
-		{
-			counter.store(0);
-		}
+		m_workerType = WORKER_RANDOM;
+
+		m_manualInserts = 0;
+		m_manualRemoves = 0;
+		m_totalInserts = 0;
+		m_totalRemoves = 0;
+		m_totalOps = 0;
+		m_nsPerOp = 0.0;
+		m_cpus = DiscoverCpus();
+		m_placement.store(0);
 		m_lastOpsUpdateTime = std::chrono::steady_clock::now();
+		m_sampleIntervalMs.store(100);
+		m_selectedBucket.store(-1);
+		m_samples = 0;
+		m_historyNext = 0;
+		m_historySize = 0;
+		m_lastContentionTime = std::chrono::steady_clock::now();
+		m_lastContentionResizes = 0;
+		resetTimeline();
+		StartSampler();
 	}
 
 	~TestSettings()
 	{
+		StopSampler();
 		delete m_pVisualTable;
 	}
 
@@ -42,39 +152,68 @@ public:
 	// @param threadID The ID of the thread to start.
 	void WorkerFunction(int threadID)
 	{
+		ThreadStats& stats = m_threadStats[threadID];
+		const std::vector<int> cpuOrder = PlacementOrder(m_cpus, PLACEMENT_NAMES[m_placement.load()]);
+		if (!cpuOrder.empty())
+		{
+			int cpu = cpuOrder[threadID % cpuOrder.size()];
+			stats.cpu.store(PinCurrentThread(cpu) ? cpu : -1);
+		}
+		else
+		{
+			stats.cpu.store(-1);
+		}
 		std::mt19937 rng(threadID + std::random_device{}());
 		std::uniform_int_distribution<int> distOp(0, 1);
 		while (m_runWorkers.load())
 		{
+			auto start = std::chrono::steady_clock::now();
 			std::uniform_int_distribution<int> distKey(0, m_keyLimit);
 			int key = distKey(rng);
 
-			if (m_workerType == 0)
+			int timedOp = -1;
+			auto opStart = std::chrono::steady_clock::now();
+			if (m_workerType == WORKER_RANDOM)
 			{
 				if (distOp(rng) == 0)
 				{
+					timedOp = TIMED_INSERT;
 					if (m_pVisualTable->Insert(key, "val"))
-						m_opInsertCount.fetch_add(1);
+						ThreadStats::Add(stats.inserts, 1);
 				}
 				else
 				{
+					timedOp = TIMED_REMOVE;
 					if (m_pVisualTable->Remove(key))
-						m_opRemoveCount.fetch_add(1);
+						ThreadStats::Add(stats.removes, 1);
 				}
 			}
-			else if (m_workerType == 1)
+			else if (m_workerType == WORKER_INSERT)
 			{
+				timedOp = TIMED_INSERT;
 				if (m_pVisualTable->Insert(key, "val"))
-					m_opInsertCount.fetch_add(1);
+					ThreadStats::Add(stats.inserts, 1);
+			}
+			else if (m_workerType == WORKER_REMOVE)
+			{
+				timedOp = TIMED_REMOVE;
+				if (m_pVisualTable->Remove(key))
+					ThreadStats::Add(stats.removes, 1);
 			}
 			else
 			{
+				// Calibration: keep the key draw, the counters and the clock reads, skip the table
+				ThreadStats::Add(distOp(rng) == 0 ? stats.inserts : stats.removes, 0);
+			}
 
-				if (m_pVisualTable->Remove(key))
-					m_opRemoveCount.fetch_add(1);
+			auto end = std::chrono::steady_clock::now();
+			if (timedOp >= 0)
+			{
+				m_opMetrics[threadID].Record(timedOp,
+					std::chrono::duration_cast<std::chrono::nanoseconds>(end - opStart).count());
 			}
-			
-			m_threadOpCounts[threadID].fetch_add(1);
+			ThreadStats::Add(stats.ops, 1);
+			ThreadStats::Add(stats.busyNs, std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
 			// This prevents the worker threads from running too fast and overloading the CPU.
 			if (m_limitOps.load())
 			{
@@ -87,36 +226,110 @@ public:
 		}
 	}
 
-	// @brief Update the load factor history for visualization.
-	void UpdateLoadFactorHistory()
+	// @brief Aggregate the per-thread counters. Called by the UI once per frame;
+	// the per-thread rates are refreshed once per second.
+	// @param now The current time.
+	void UpdateStats(std::chrono::steady_clock::time_point now)
 	{
-		float loadFactor = m_pVisualTable->ComputeLoadFactor();
-		m_loadFactorHistory.push_back(loadFactor);
-		if (m_loadFactorHistory.size() > MAX_HISTORY_SIZE)
+		uint64_t inserts = m_manualInserts;
+		uint64_t removes = m_manualRemoves;
+		uint64_t ops = 0;
+		uint64_t busyNs = 0;
+		for (const auto& stats : m_threadStats)
+		{
+			inserts += stats.inserts.load(std::memory_order_relaxed);
+			removes += stats.removes.load(std::memory_order_relaxed);
+			ops += stats.ops.load(std::memory_order_relaxed);
+			busyNs += stats.busyNs.load(std::memory_order_relaxed);
+		}
+		m_totalInserts = inserts;
+		m_totalRemoves = removes;
+		m_totalOps = ops;
+		m_nsPerOp = ops > 0 ? static_cast<double>(busyNs) / ops : 0.0;
+
+		if (std::chrono::duration_cast<std::chrono::seconds>(now - m_lastOpsUpdateTime).count() >= 1)
 		{
-			m_loadFactorHistory.erase(m_loadFactorHistory.begin());
+			for (int i = 0; i < m_maxThreads; i++)
+			{
+				uint64_t current = m_threadStats[i].ops.load(std::memory_order_relaxed);
+				m_threadOpsPerSec[i] = current - m_lastThreadCounts[i];
+				m_lastThreadCounts[i] = current;
+			}
+			m_lastOpsUpdateTime = now;
 		}
 	}
 
-	// @brief Get a snapshot of the bucket information.
-	// @return A vector of BucketInfo structures.
-	std::vector<BucketInfo> GetBucketInfoSnapshot()
+	// @brief Sample the table until StopSampler, at the rate set by SetSampleRate,
+	// and add a timeline point every TIMELINE_TICK_MS.
+	void SamplerFunction()
 	{
-		auto snapshot = m_pVisualTable->GetSnapshot();
-		std::vector<BucketInfo> buckets;
-		for (const auto& bucket : snapshot)
+		using Clock = std::chrono::steady_clock;
+		Clock::time_point nextFrame = Clock::now();
+		Clock::time_point nextTick = nextFrame + std::chrono::milliseconds(TIMELINE_TICK_MS);
+		Clock::time_point lastTick = nextFrame;
+		while (m_runSampler.load())
 		{
-			BucketInfo info;
-			int active = 0;
-			for (const auto& node : bucket)
+			Clock::time_point now = Clock::now();
+			if (now >= nextFrame)
+			{
+				sampleTable();
+				nextFrame = now + std::chrono::milliseconds(m_sampleIntervalMs.load());
+			}
+			if (now >= nextTick)
 			{
-				if (!std::get<2>(node))
-					active++;
+				sampleTimeline(std::chrono::duration<double>(now - lastTick).count());
+				lastTick = now;
+				nextTick = std::max(nextTick + std::chrono::milliseconds(TIMELINE_TICK_MS), now);
 			}
-			info.nodeCount = active;
-			buckets.push_back(info);
+			// Sleep in short steps so StopSampler does not wait for a whole interval
+			now = Clock::now();
+			Clock::time_point wake = std::min(nextFrame, nextTick);
+			if (wake > now)
+				std::this_thread::sleep_for(std::min<Clock::duration>(wake - now, std::chrono::milliseconds(20)));
 		}
-		return buckets;
+	}
+
+	// @brief Start the sampler thread.
+	void StartSampler()
+	{
+		m_runSampler.store(true);
+		m_sampler = std::thread(&TestSettings::SamplerFunction, this);
+	}
+
+	// @brief Stop the sampler thread and wait for it.
+	void StopSampler()
+	{
+		m_runSampler.store(false);
+		if (m_sampler.joinable())
+			m_sampler.join();
+	}
+
+	// @brief Get the newest sample of the table. UI thread only, never waits.
+	// @return The frame, valid until the next call.
+	inline const TableFrame& GetFrame()
+	{
+		return m_frames.Front();
+	}
+
+	// @brief Choose the bucket whose nodes the sampler copies into the frames.
+	// @param bucket The bucket index, -1 for none.
+	inline void SelectBucket(int bucket)
+	{
+		m_selectedBucket.store(bucket, std::memory_order_relaxed);
+	}
+
+	// @brief Get the newest latency and throughput timeline. UI thread only, never waits.
+	// @return The timeline, valid until the next call.
+	inline const TimelineFrame& GetTimeline()
+	{
+		return m_timelines.Front();
+	}
+
+	// @brief Set how often the sampler thread walks the table.
+	// @param hz Samples per second.
+	inline void SetSampleRate(int hz)
+	{
+		m_sampleIntervalMs.store(1000 / std::max(hz, 1));
 	}
 
 	// @brief Get visual table instance.
@@ -140,52 +353,43 @@ public:
 		return m_workers;
 	}
 
-	// @brief Get the load factor history.
-	// @return A vector of load factor values.
-	inline const std::vector<float>& GetLoadFactorHistory() const
-	{
-		return m_loadFactorHistory;
-	}
-
-	// @brief Get the last thread counts.
-	// @param threadID The index of the thread.
-	// @return A vector of last thread counts.
-	inline const int GetLastThreadCounts(int threadID) const
-	{
-		if (threadID < 0 || threadID >= m_maxThreads)
-			throw std::out_of_range("Thread ID out of range");
-		return m_lastThreadCounts[threadID];
-	}
-
-	// @brief Get the thread operations per second.
+	// @brief Get the thread operations per second, as of the last UpdateStats.
 	// @param threadID The index of the thread.
-	// @return A vector of thread operations per second.
-	inline const int GetThreadOpsPerSec(int threadID) const
+	// @return The operations per second of the thread.
+	inline uint64_t GetThreadOpsPerSec(int threadID) const
 	{
 		if (threadID < 0 || threadID >= m_maxThreads)
 			throw std::out_of_range("Thread ID out of range");
 		return m_threadOpsPerSec[threadID];
 	}
 
-	// @brief Get the operation insert count.
+	// @brief Get the operation insert count, as of the last UpdateStats.
 	// @return The operation insert count.
-	inline int GetOpInsertCount() const
+	inline uint64_t GetOpInsertCount() const
 	{
-		return m_opInsertCount.load();
+		return m_totalInserts;
 	}
 
-	// @brief Get the operation remove count.
+	// @brief Get the operation remove count, as of the last UpdateStats.
 	// @return The operation remove count.
-	inline int GetOpRemoveCount() const
+	inline uint64_t GetOpRemoveCount() const
+	{
+		return m_totalRemoves;
+	}
+
+	// @brief Get the worker loop iterations, as of the last UpdateStats.
+	// @return The iterations of all workers.
+	inline uint64_t GetWorkerOpCount() const
 	{
-		return m_opRemoveCount.load();
+		return m_totalOps;
 	}
 
-	// @brief Get the operation counts for each thread.
-	// @return A vector of operation counts for each thread.
-	inline const std::vector<std::atomic<int>>& GetThreadOpCounts() const
+	// @brief Get the average cost of one worker loop iteration without the throttling sleep.
+	// In the calibration mode this is the harness's own overhead per operation.
+	// @return Nanoseconds per iteration, as of the last UpdateStats.
+	inline double GetNsPerOp() const
 	{
-		return m_threadOpCounts;
+		return m_nsPerOp;
 	}
 
 	// @brief Set the run workers flag.
@@ -209,38 +413,18 @@ public:
 		m_workerType = type;
 	}
 
-	// @brief Set thread ops per second.
-	// @param threadID The index of the thread.
-	// @param ops The operations per second to set.
-	inline void SetThreadOpsPerSec(int threadID, int ops)
-	{
-		if (threadID < 0 || threadID >= m_maxThreads)
-			throw std::out_of_range("Thread ID out of range");
-		m_threadOpsPerSec[threadID] = ops;
-	}
-
-	// @brief Set last thread counts.
-	// @param threadID The index of the thread.
-	// @param count The last count to set.
-	inline void SetLastThreadCounts(int threadID, int count)
-	{
-		if (threadID < 0 || threadID >= m_maxThreads)
-			throw std::out_of_range("Thread ID out of range");
-		m_lastThreadCounts[threadID] = count;
-	}
-
-	// @brief Add insert operation count.
+	// @brief Add insert operation count, for operations issued from the UI thread.
 	// @param count The count to add.
 	inline void AddInsertOpCount(int count)
 	{
-		m_opInsertCount.fetch_add(count);
+		m_manualInserts += count;
 	}
 
-	// @brief Add remove operation count.
+	// @brief Add remove operation count, for operations issued from the UI thread.
 	// @param count The count to add.
 	inline void AddRemoveOpCount(int count)
 	{
-		m_opRemoveCount.fetch_add(count);
+		m_manualRemoves += count;
 	}
 
 	// @brief Reset operation counts.
@@ -253,31 +437,71 @@ public:
 				t.join();
 		}
 		m_workers.clear();
+		// The sampler reads the counters and the table, so it stops before either is cleared
+		StopSampler();
 
-		m_opInsertCount.store(0);
-		m_opRemoveCount.store(0);
-		for (auto& counter : m_threadOpCounts)
+		for (auto& stats : m_threadStats)
+		{
+			stats.ops.store(0);
+			stats.inserts.store(0);
+			stats.removes.store(0);
+			stats.busyNs.store(0);
+		}
+		for (auto& metrics : m_opMetrics)
 		{
-			counter.store(0);
+			metrics.ops.store(0);
+			for (auto& row : metrics.latency)
+			{
+				for (auto& bin : row)
+					bin.store(0);
+			}
 		}
+		m_manualInserts = 0;
+		m_manualRemoves = 0;
+		m_totalInserts = 0;
+		m_totalRemoves = 0;
+		m_totalOps = 0;
+		m_nsPerOp = 0.0;
 		std::fill(m_lastThreadCounts.begin(), m_lastThreadCounts.end(), 0);
 		std::fill(m_threadOpsPerSec.begin(), m_threadOpsPerSec.end(), 0);
-		m_loadFactorHistory.clear();
+
 		m_pVisualTable->Reset();
+		m_historyNext = 0;
+		m_historySize = 0;
+		m_lastContention.clear();
+		resetTimeline();
+		StartSampler();
 	}
 
-	// @brief Get the last update time for operations.
-	// @return The last update time.
-	inline std::chrono::steady_clock::time_point GetLastOpsUpdateTime() const
+	// @brief Set the placement policy of workers started from now on.
+	// @param placement Index into PLACEMENT_NAMES.
+	inline void SetPlacement(int placement)
 	{
-		return m_lastOpsUpdateTime;
+		m_placement.store(placement);
 	}
 
-	// @brief Set the last update time for operations.
-	// @param time The time to set.
-	inline void SetLastOpsUpdateTime(std::chrono::steady_clock::time_point time)
+	// @brief Get the placement policy of new workers.
+	// @return One of PLACEMENT_NAMES.
+	inline const char* GetPlacement() const
 	{
-		m_lastOpsUpdateTime = time;
+		return PLACEMENT_NAMES[m_placement.load()];
+	}
+
+	// @brief Get the CPU a worker is pinned to.
+	// @param threadID The index of the thread.
+	// @return The CPU number, -1 if the worker is not pinned.
+	inline int GetWorkerCpu(int threadID) const
+	{
+		if (threadID < 0 || threadID >= m_maxThreads)
+			throw std::out_of_range("Thread ID out of range");
+		return m_threadStats[threadID].cpu.load(std::memory_order_relaxed);
+	}
+
+	// @brief Get the CPUs discovered at startup.
+	// @return One entry per logical CPU.
+	inline const std::vector<CpuInfo>& GetCpus() const
+	{
+		return m_cpus;
 	}
 
 	// @brief Set the key limit for operations.
@@ -289,18 +513,245 @@ public:
 
 private:
 	VisualLockFreeHashTable<int, std::string>* m_pVisualTable;
-	std::vector<std::atomic<int>> m_threadOpCounts;
+	std::vector<ThreadStats> m_threadStats;
+	std::vector<LiveOpMetrics> m_opMetrics;  // latencies of the timed operations, one per worker
+	std::vector<CpuInfo> m_cpus;
 	std::vector<std::thread> m_workers;
-	std::vector<float> m_loadFactorHistory;
-	std::vector<int> m_lastThreadCounts;
-	std::vector<int> m_threadOpsPerSec;
-	std::atomic<int> m_opInsertCount;
-	std::atomic<int> m_opRemoveCount;
+	std::thread m_sampler;
+	std::atomic<bool> m_runSampler;
+	std::atomic<int> m_sampleIntervalMs;
+	std::atomic<int> m_selectedBucket;  // set by the UI, read by the sampler
+	TripleBuffer<TableFrame> m_frames;
+	uint64_t m_samples;         // sampler thread only, like the history ring
+	float m_history[MAX_HISTORY_SIZE];
+	int m_historyNext;
+	int m_historySize;
+	std::vector<BucketContention> m_lastContention;  // sampler thread only, counters at the previous sample
+	size_t m_lastContentionResizes;                  // GetResizeCount() when m_lastContention was read
+	std::vector<uint32_t> m_bucketEvents;
+	std::chrono::steady_clock::time_point m_lastContentionTime;
+	TripleBuffer<TimelineFrame> m_timelines;
+	TimelineFrame m_timeline;   // sampler thread only, copied into m_timelines every tick
+	uint64_t m_lastLatency[TIMED_OP_COUNT][METRICS_LATENCY_BINS];
+	uint64_t m_lastTimedOps;
+	size_t m_lastResizes;
+	uint64_t m_lastScans;
+	size_t m_lastRetired;
+	std::vector<uint64_t> m_lastThreadCounts;
+	std::vector<uint64_t> m_threadOpsPerSec;
+	uint64_t m_manualInserts;   // UI thread only, like the aggregates below
+	uint64_t m_manualRemoves;
+	uint64_t m_totalInserts;
+	uint64_t m_totalRemoves;
+	uint64_t m_totalOps;
+	double m_nsPerOp;
 	std::atomic<bool> m_runWorkers;
 	std::atomic<bool> m_limitOps;
+	std::atomic<int> m_placement;  // index into PLACEMENT_NAMES, read by workers when they start
 	std::chrono::steady_clock::time_point m_lastOpsUpdateTime; 
 	int m_maxThreads;
 	int m_keyLimit;
 	int m_workerType;
+
+	// @brief Walk the table once and publish the result as the newest frame.
+	// Only the selected bucket's nodes are copied, the others are counted.
+	void sampleTable()
+	{
+		TableFrame& frame = m_frames.Back();
+		const int selected = m_selectedBucket.load(std::memory_order_relaxed);
+		m_pVisualTable->SampleBuckets(frame.activeCounts, frame.markedNodes,
+			selected < 0 ? SIZE_MAX : static_cast<size_t>(selected), frame.nodes);
+		frame.selectedBucket = selected < static_cast<int>(frame.activeCounts.size()) ? selected : -1;
+		frame.maxActive = 0.0f;
+		frame.activeNodes = 0;
+		for (float active : frame.activeCounts)
+		{
+			frame.maxActive = std::max(frame.maxActive, active);
+			frame.activeNodes += static_cast<size_t>(active);
+		}
+		summarizeBuckets(frame);
+		sampleContention(frame);
+		// Merging the sketches takes every thread's sketch lock, so not on the UI thread
+		frame.hotSpots = m_pVisualTable->GetHotSpots(10);
+		frame.loadFactor = m_pVisualTable->ComputeLoadFactor();
+
+		m_history[m_historyNext] = frame.loadFactor;
+		m_historyNext = (m_historyNext + 1) % MAX_HISTORY_SIZE;
+		m_historySize = std::min(m_historySize + 1, MAX_HISTORY_SIZE);
+		std::copy(std::begin(m_history), std::end(m_history), frame.loadFactorHistory);
+		frame.historySize = m_historySize;
+		frame.historyOffset = m_historySize < MAX_HISTORY_SIZE ? 0 : m_historyNext;
+
+		frame.sample = ++m_samples;
+		m_frames.Publish();
+	}
+
+	// @brief Fill the heat of a frame with the contention events of every bucket
+	// since the previous sample.
+	// @param frame The frame being built.
+	void sampleContention(TableFrame& frame)
+	{
+		auto now = std::chrono::steady_clock::now();
+		// Read before the counters: a resize publishes its array, then counts itself
+		const size_t resizes = m_pVisualTable->GetResizeCount();
+		std::vector<BucketContention> current = m_pVisualTable->GetBucketContention();
+		frame.contentionEnabled = !current.empty();
+		frame.heatIntervalSec = std::chrono::duration<double>(now - m_lastContentionTime).count();
+		m_lastContentionTime = now;
+		// Every resize publishes an array with new counters, even when a grow and a
+		// shrink between two samples leave the bucket count as it was. The size
+		// check catches an array published but not counted yet, and Reset().
+		if (resizes != m_lastContentionResizes || m_lastContention.size() != current.size())
+			m_lastContention.assign(current.size(), BucketContention());
+		m_lastContentionResizes = resizes;
+
+		const size_t buckets = current.size();
+		frame.heatBucketsPerCell = std::max<size_t>(1, (buckets + HEATMAP_CELLS - 1) / HEATMAP_CELLS);
+		const size_t cells = (buckets + frame.heatBucketsPerCell - 1) / frame.heatBucketsPerCell;
+		for (int m = 0; m < HEAT_METRICS; ++m)
+		{
+			frame.heat[m].assign(cells, 0.0f);
+			frame.heatTotal[m] = 0;
+		}
+		m_bucketEvents.clear();
+		for (size_t b = 0; b < buckets; ++b)
+		{
+			const size_t cell = b / frame.heatBucketsPerCell;
+			uint32_t all = 0;
+			for (size_t s = 0; s < BucketContention::COUNT; ++s)
+			{
+				const uint32_t delta = current[b].values[s] - m_lastContention[b].values[s];
+				frame.heat[s][cell] += static_cast<float>(delta);
+				frame.heatTotal[s] += delta;
+				all += delta;
+			}
+			frame.heat[HEAT_METRICS - 1][cell] += static_cast<float>(all);
+			frame.heatTotal[HEAT_METRICS - 1] += all;
+			m_bucketEvents.push_back(all);
+		}
+		m_lastContention.swap(current);
+
+		for (int m = 0; m < HEAT_METRICS; ++m)
+			frame.heatMax[m] = frame.heat[m].empty() ? 0.0f : *std::max_element(frame.heat[m].begin(), frame.heat[m].end());
+		frame.heatBuckets = buckets - std::count(m_bucketEvents.begin(), m_bucketEvents.end(), 0u);
+
+		// Few buckets holding most events point to hashing or key skew, an even
+		// spread to contention on what every operation shares
+		frame.heatTopShare = 0.0f;
+		if (frame.heatTotal[HEAT_METRICS - 1] > 0)
+		{
+			const size_t top = std::max<size_t>(1, buckets / 100);
+			std::nth_element(m_bucketEvents.begin(), m_bucketEvents.begin() + (top - 1), m_bucketEvents.end(), std::greater<uint32_t>());
+			uint64_t topEvents = 0;
+			for (size_t i = 0; i < top; ++i)
+				topEvents += m_bucketEvents[i];
+			frame.heatTopShare = static_cast<float>(topEvents) / frame.heatTotal[HEAT_METRICS - 1];
+		}
+	}
+
+	// @brief Clear the timeline and start counting from the current totals.
+	void resetTimeline()
+	{
+		m_timeline = TimelineFrame();
+		for (int type = 0; type < TIMED_OP_COUNT; ++type)
+		{
+			for (int bin = 0; bin < METRICS_LATENCY_BINS; ++bin)
+			{
+				uint64_t sum = 0;
+				for (const auto& metrics : m_opMetrics)
+					sum += metrics.latency[type][bin].load(std::memory_order_relaxed);
+				m_lastLatency[type][bin] = sum;
+			}
+		}
+		m_lastTimedOps = 0;
+		for (const auto& metrics : m_opMetrics)
+			m_lastTimedOps += metrics.ops.load(std::memory_order_relaxed);
+		m_lastResizes = m_pVisualTable->GetResizeCount();
+		m_lastScans = m_pVisualTable->GetStats()[TableStat::Scans];
+		m_lastRetired = m_pVisualTable->GetRetiredCount();
+	}
+
+	// @brief Add a point for the operations since the last tick and publish the timeline.
+	// @param intervalSec Time since the last tick.
+	void sampleTimeline(double intervalSec)
+	{
+		const int i = m_timeline.size < TIMELINE_POINTS ? m_timeline.size : m_timeline.offset;
+		for (int type = 0; type < TIMED_OP_COUNT; ++type)
+		{
+			uint64_t bins[METRICS_LATENCY_BINS];
+			for (int bin = 0; bin < METRICS_LATENCY_BINS; ++bin)
+			{
+				uint64_t sum = 0;
+				for (const auto& metrics : m_opMetrics)
+					sum += metrics.latency[type][bin].load(std::memory_order_relaxed);
+				bins[bin] = sum - m_lastLatency[type][bin];
+				m_lastLatency[type][bin] = sum;
+			}
+			m_timeline.p50[type][i] = static_cast<float>(MetricsPercentile(bins, 50.0));
+			m_timeline.p99[type][i] = static_cast<float>(MetricsPercentile(bins, 99.0));
+			m_timeline.p999[type][i] = static_cast<float>(MetricsPercentile(bins, 99.9));
+		}
+
+		uint64_t ops = 0;
+		for (const auto& metrics : m_opMetrics)
+			ops += metrics.ops.load(std::memory_order_relaxed);
+		m_timeline.opsPerSec[i] = intervalSec > 0.0 ? static_cast<float>((ops - m_lastTimedOps) / intervalSec) : 0.0f;
+		m_lastTimedOps = ops;
+
+		const size_t resizes = m_pVisualTable->GetResizeCount();
+		m_timeline.resizes[i] = static_cast<float>(resizes - m_lastResizes);
+		m_lastResizes = resizes;
+
+		// Scans are counted by stats builds; otherwise a drop of the retired count shows one
+		const TableStats stats = m_pVisualTable->GetStats();
+		const size_t retired = m_pVisualTable->GetRetiredCount();
+		if (stats.enabled)
+			m_timeline.scans[i] = static_cast<float>(stats[TableStat::Scans] - m_lastScans);
+		else
+			m_timeline.scans[i] = retired < m_lastRetired ? 1.0f : 0.0f;
+		m_lastScans = stats[TableStat::Scans];
+		m_lastRetired = retired;
+
+		if (m_timeline.size < TIMELINE_POINTS)
+			m_timeline.size++;
+		else
+			m_timeline.offset = (m_timeline.offset + 1) % TIMELINE_POINTS;
+
+		m_timelines.Back() = m_timeline;
+		m_timelines.Publish();
+	}
+
+	// @brief Fill the bucket groups and the chain length distribution of a frame
+	// from its activeCounts.
+	// @param frame The frame being built.
+	static void summarizeBuckets(TableFrame& frame)
+	{
+		const size_t buckets = frame.activeCounts.size();
+		frame.bucketsPerGroup = std::max<size_t>(1, (buckets + HISTOGRAM_COLUMNS - 1) / HISTOGRAM_COLUMNS);
+		frame.groupMin.clear();
+		frame.groupAvg.clear();
+		frame.groupMax.clear();
+		for (size_t begin = 0; begin < buckets; begin += frame.bucketsPerGroup)
+		{
+			const size_t end = std::min(buckets, begin + frame.bucketsPerGroup);
+			float lo = frame.activeCounts[begin];
+			float hi = lo;
+			float sum = 0.0f;
+			for (size_t b = begin; b < end; ++b)
+			{
+				lo = std::min(lo, frame.activeCounts[b]);
+				hi = std::max(hi, frame.activeCounts[b]);
+				sum += frame.activeCounts[b];
+			}
+			frame.groupMin.push_back(lo);
+			frame.groupAvg.push_back(sum / (end - begin));
+			frame.groupMax.push_back(hi);
+		}
+
+		std::fill(std::begin(frame.chainLengths), std::end(frame.chainLengths), 0.0f);
+		for (float count : frame.activeCounts)
+			frame.chainLengths[std::min(static_cast<int>(count), CHAIN_LENGTH_BINS - 1)] += 1.0f;
+		frame.maxChainBin = *std::max_element(std::begin(frame.chainLengths), std::end(frame.chainLengths));
+	}
 };
 
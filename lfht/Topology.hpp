@@ -0,0 +1,241 @@
+#pragma once
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#endif
+
+// One logical CPU as reported by /sys/devices/system/cpu, or on Windows by
+// GetLogicalProcessorInformationEx. Windows CPUs are numbered group * 64 + the
+// processor's number in its group.
+struct CpuInfo
+{
+	int cpu;
+	int core;     // core_id, shared by SMT siblings
+	int package;  // physical_package_id (socket)
+};
+
+#ifdef _WIN32
+// @brief Call a function for every logical CPU of a processor group mask.
+// @param masks The masks of a core or package record.
+// @param count Number of masks.
+// @param fn Called as fn(cpu).
+template <typename Fn>
+inline void ForEachGroupCpu(const GROUP_AFFINITY* masks, WORD count, Fn&& fn)
+{
+	for (WORD g = 0; g < count; ++g)
+	{
+		for (int bit = 0; bit < 64; ++bit)
+		{
+			if (masks[g].Mask & (KAFFINITY(1) << bit))
+				fn(masks[g].Group * 64 + bit);
+		}
+	}
+}
+#endif
+
+// @brief Read a single integer from a sysfs file.
+// @param path The file to read.
+// @param fallback Returned when the file is missing.
+inline int ReadSysInt(const std::string& path, int fallback)
+{
+	std::ifstream in(path);
+	int value;
+	if (in >> value)
+		return value;
+	return fallback;
+}
+
+// @brief List the CPUs this process may run on, with their core and socket.
+// @return One entry per logical CPU, by CPU number. Without sysfs or the
+// Windows topology every CPU is its own core.
+inline std::vector<CpuInfo> DiscoverCpus()
+{
+	std::vector<CpuInfo> cpus;
+#ifdef _WIN32
+	DWORD length = 0;
+	GetLogicalProcessorInformationEx(RelationAll, nullptr, &length);
+	std::vector<char> buffer(length);
+	if (length > 0 && GetLogicalProcessorInformationEx(RelationAll,
+		reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(buffer.data()), &length))
+	{
+		// Cores and packages are numbered in the order Windows reports them
+		int cores = 0;
+		int packages = 0;
+		std::vector<std::pair<int, int>> found;  // (cpu, core)
+		std::vector<std::pair<int, int>> packageOf;  // (cpu, package)
+		for (DWORD offset = 0; offset < length;)
+		{
+			const auto* info = reinterpret_cast<const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data() + offset);
+			if (info->Relationship == RelationProcessorCore)
+			{
+				ForEachGroupCpu(info->Processor.GroupMask, info->Processor.GroupCount,
+					[&](int cpu) { found.push_back({ cpu, cores }); });
+				cores++;
+			}
+			else if (info->Relationship == RelationProcessorPackage)
+			{
+				ForEachGroupCpu(info->Processor.GroupMask, info->Processor.GroupCount,
+					[&](int cpu) { packageOf.push_back({ cpu, packages }); });
+				packages++;
+			}
+			offset += info->Size;
+		}
+		for (const auto& f : found)
+		{
+			int package = 0;
+			for (const auto& p : packageOf)
+			{
+				if (p.first == f.first)
+					package = p.second;
+			}
+			cpus.push_back({ f.first, f.second, package });
+		}
+		std::sort(cpus.begin(), cpus.end(), [](const CpuInfo& a, const CpuInfo& b) { return a.cpu < b.cpu; });
+	}
+#elif defined(__linux__)
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0)
+	{
+		for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+		{
+			if (!CPU_ISSET(cpu, &allowed))
+				continue;
+			std::string base = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/";
+			cpus.push_back({ cpu, ReadSysInt(base + "core_id", cpu), ReadSysInt(base + "physical_package_id", 0) });
+		}
+	}
+#endif
+	if (cpus.empty())
+	{
+		int n = std::max(1u, std::thread::hardware_concurrency());
+		for (int cpu = 0; cpu < n; ++cpu)
+			cpus.push_back({ cpu, cpu, 0 });
+	}
+	return cpus;
+}
+
+// @brief Whether any physical core has more than one logical CPU.
+inline bool HasSmt(const std::vector<CpuInfo>& cpus)
+{
+	for (size_t i = 0; i < cpus.size(); ++i)
+	{
+		for (size_t j = i + 1; j < cpus.size(); ++j)
+		{
+			if (cpus[i].core == cpus[j].core && cpus[i].package == cpus[j].package)
+				return true;
+		}
+	}
+	return false;
+}
+
+// Thread placement policies, in the order of --placement's help text
+static const char* PLACEMENT_NAMES[] = { "none", "compact", "scatter", "cores", "smt" };
+
+// @brief Whether a name is one of PLACEMENT_NAMES.
+inline bool IsPlacementName(const std::string& name)
+{
+	for (const char* p : PLACEMENT_NAMES)
+	{
+		if (name == p)
+			return true;
+	}
+	return false;
+}
+
+// @brief Order in which worker threads are assigned to CPUs.
+// @param cpus The discovered CPUs.
+// @param placement One of PLACEMENT_NAMES:
+//                  none: not pinned.
+//                  compact: fill every logical CPU of a socket, in CPU number order, before the next socket.
+//                  scatter: one thread per physical core, alternating between sockets.
+//                  cores: one thread per physical core of a socket, then the next socket, before any SMT sibling.
+//                  smt: both SMT siblings of a core together, then the next core.
+// @return CPU numbers; worker t runs on order[t % order.size()]. Empty for none.
+inline std::vector<int> PlacementOrder(const std::vector<CpuInfo>& cpus, const std::string& placement)
+{
+	if (placement == "none")
+		return {};
+
+	std::vector<std::pair<std::vector<int>, int>> keyed;
+	for (const auto& c : cpus)
+	{
+		// Rank of the CPU among the siblings of its core, and of its core within its socket
+		int sibling = 0;
+		std::vector<int> cores;
+		for (const auto& o : cpus)
+		{
+			if (o.core == c.core && o.package == c.package && o.cpu < c.cpu)
+				sibling++;
+			if (o.package == c.package && o.core < c.core && std::find(cores.begin(), cores.end(), o.core) == cores.end())
+				cores.push_back(o.core);
+		}
+		const int core = static_cast<int>(cores.size());
+
+		std::vector<int> key;
+		if (placement == "compact")
+			key = { c.package, c.cpu };
+		else if (placement == "scatter")
+			key = { sibling, core, c.package };
+		else if (placement == "smt")
+			key = { c.package, core, sibling };
+		else
+			key = { sibling, c.package, core };
+		keyed.push_back({ key, c.cpu });
+	}
+	std::sort(keyed.begin(), keyed.end());
+
+	std::vector<int> order;
+	for (const auto& k : keyed)
+		order.push_back(k.second);
+	return order;
+}
+
+// @brief Describe the CPUs the first threads of a placement run on, e.g. "0,2,4,6".
+// @param order The placement order.
+// @param threads Number of threads.
+// @return The CPU list, "unpinned" for an empty order.
+inline std::string PlacementCpus(const std::vector<int>& order, int threads)
+{
+	if (order.empty())
+		return "unpinned";
+	std::string text;
+	for (int t = 0; t < threads; ++t)
+		text += (t ? "," : "") + std::to_string(order[t % order.size()]);
+	return text;
+}
+
+// @brief Pin the calling thread to one CPU.
+// @param cpu The CPU number.
+// @return True on success, always false where pinning is not supported.
+inline bool PinCurrentThread(int cpu)
+{
+#ifdef __linux__
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#elif defined(_WIN32)
+	GROUP_AFFINITY affinity = {};
+	affinity.Group = static_cast<WORD>(cpu / 64);
+	affinity.Mask = KAFFINITY(1) << (cpu % 64);
+	return SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr) != 0;
+#else
+	(void)cpu;
+	return false;
+#endif
+}
@@ -0,0 +1,212 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Operation kinds stored in a trace
+enum class TraceOp : uint8_t
+{
+	Contains,
+	Insert,
+	Remove
+};
+
+// One traced operation, 16 bytes on disk.
+// meta: [timestamp ns (48)][thread (10)][op (2)][result (1)][unused (3)]
+struct TraceRecord
+{
+	uint64_t keyHash;
+	uint64_t meta;
+
+	static constexpr int kThreadShift = 6;
+	static constexpr int kOpShift = 4;
+	static constexpr int kResultShift = 3;
+	static constexpr int kTimeShift = 16;
+	static constexpr uint64_t kMaxThreads = 1024;
+
+	TraceRecord() : keyHash(0), meta(0) {}
+	TraceRecord(uint64_t timeNs, uint32_t thread, TraceOp op, bool result, uint64_t hash) : keyHash(hash)
+	{
+		meta = (timeNs << kTimeShift) | (static_cast<uint64_t>(thread % kMaxThreads) << kThreadShift) |
+			(static_cast<uint64_t>(op) << kOpShift) | (static_cast<uint64_t>(result) << kResultShift);
+	}
+
+	uint64_t TimeNs() const { return meta >> kTimeShift; }
+	uint32_t Thread() const { return static_cast<uint32_t>((meta >> kThreadShift) & (kMaxThreads - 1)); }
+	TraceOp Op() const { return static_cast<TraceOp>((meta >> kOpShift) & 0x3); }
+	bool Result() const { return (meta >> kResultShift) & 0x1; }
+};
+
+static_assert(sizeof(TraceRecord) == 16, "TraceRecord must stay 16 bytes, it is the file format");
+
+// File header of a trace
+struct TraceFileHeader
+{
+	char magic[8];          // "LFHTTRC1"
+	uint32_t recordSize;
+	uint32_t reserved;
+};
+
+// Records table operations into per-thread ring buffers. A full buffer is
+// appended to the trace file by the thread that filled it, so recording
+// never blocks except for that one write per TRACE_BUFFER_RECORDS ops.
+// Records of different threads are interleaved by block; readers sort by time.
+class TraceRecorder
+{
+public:
+	static constexpr size_t TRACE_BUFFER_RECORDS = 1 << 16;
+
+	TraceRecorder() = default;
+	TraceRecorder(const TraceRecorder&) = delete;
+	TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+	~TraceRecorder()
+	{
+		Close();
+	}
+
+	// @brief Start a new trace file.
+	// @param path The file to write.
+	// @return False if the file could not be created.
+	bool Open(const std::string& path)
+	{
+		Close();
+		m_file = std::fopen(path.c_str(), "wb");
+		if (!m_file)
+			return false;
+		TraceFileHeader header = { { 'L', 'F', 'H', 'T', 'T', 'R', 'C', '1' }, sizeof(TraceRecord), 0 };
+		std::fwrite(&header, sizeof(header), 1, m_file);
+		m_begin = std::chrono::steady_clock::now();
+		m_generation++;
+		return true;
+	}
+
+	// @brief Record one finished operation of the calling thread.
+	// @param op The operation.
+	// @param keyHash Hash of the key, the key itself never leaves the process.
+	// @param result What the operation returned.
+	void Record(TraceOp op, uint64_t keyHash, bool result)
+	{
+		ThreadBuffer* buffer = threadBuffer();
+		if (!buffer)
+			return;
+		uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_begin).count();
+		buffer->records[buffer->used++] = TraceRecord(ns, buffer->thread, op, result, keyHash);
+		if (buffer->used == TRACE_BUFFER_RECORDS)
+			flush(*buffer);
+	}
+
+	// @brief Write what is left in every buffer and close the file.
+	// Recording threads must have stopped.
+	void Close()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_file)
+			return;
+		for (auto& buffer : m_buffers)
+		{
+			std::fwrite(buffer->records.data(), sizeof(TraceRecord), buffer->used, m_file);
+			m_written += buffer->used;
+			buffer->used = 0;
+		}
+		m_buffers.clear();
+		std::fclose(m_file);
+		m_file = nullptr;
+	}
+
+	// @brief Number of records written to the file so far.
+	uint64_t Written() const
+	{
+		return m_written;
+	}
+
+private:
+	struct ThreadBuffer
+	{
+		std::vector<TraceRecord> records;
+		size_t used = 0;
+		uint32_t thread = 0;
+	};
+
+	std::FILE* m_file = nullptr;
+	std::chrono::steady_clock::time_point m_begin;
+	std::mutex m_mutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+	uint64_t m_written = 0;
+	uint64_t m_generation = 0;
+
+	// @brief The calling thread's buffer, created on its first record.
+	ThreadBuffer* threadBuffer()
+	{
+		struct Cached
+		{
+			const TraceRecorder* owner = nullptr;
+			uint64_t generation = 0;
+			ThreadBuffer* buffer = nullptr;
+		};
+		thread_local Cached cached;
+		if (cached.owner == this && cached.generation == m_generation)
+			return cached.buffer;
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_file)
+			return nullptr;
+		m_buffers.push_back(std::make_unique<ThreadBuffer>());
+		ThreadBuffer* buffer = m_buffers.back().get();
+		buffer->records.resize(TRACE_BUFFER_RECORDS);
+		buffer->thread = static_cast<uint32_t>(m_buffers.size() - 1);
+		cached = { this, m_generation, buffer };
+		return buffer;
+	}
+
+	void flush(ThreadBuffer& buffer)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_file)
+			std::fwrite(buffer.records.data(), sizeof(TraceRecord), buffer.used, m_file);
+		m_written += buffer.used;
+		buffer.used = 0;
+	}
+};
+
+// Table wrapper that records every operation. Works with any table exposing
+// insert(key, value), remove(key) and contains(key).
+template <typename Table, typename K>
+class TracingTable
+{
+public:
+	TracingTable(Table& table, TraceRecorder& recorder) : m_table(table), m_recorder(recorder) {}
+
+	template <typename V>
+	bool insert(K key, V value)
+	{
+		bool ok = m_table.insert(key, value);
+		m_recorder.Record(TraceOp::Insert, std::hash<K>{}(key), ok);
+		return ok;
+	}
+
+	bool remove(K key)
+	{
+		bool ok = m_table.remove(key);
+		m_recorder.Record(TraceOp::Remove, std::hash<K>{}(key), ok);
+		return ok;
+	}
+
+	bool contains(K key)
+	{
+		bool ok = m_table.contains(key);
+		m_recorder.Record(TraceOp::Contains, std::hash<K>{}(key), ok);
+		return ok;
+	}
+
+	Table& Inner() { return m_table; }
+
+private:
+	Table& m_table;
+	TraceRecorder& m_recorder;
+};
@@ -0,0 +1,182 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "BenchConfig.hpp"
+#include "BenchDriver.hpp"
+#include "BenchEngines.hpp"
+#include "TraceRecorder.hpp"
+
+// The driver samples the wrapped table
+template <typename Table, typename K>
+struct TableProbe<TracingTable<Table, K>>
+{
+	static size_t Size(TracingTable<Table, K>& t) { return TableProbe<Table>::Size(t.Inner()); }
+	static size_t Resizes(TracingTable<Table, K>& t) { return TableProbe<Table>::Resizes(t.Inner()); }
+	static size_t Retired(TracingTable<Table, K>& t) { return TableProbe<Table>::Retired(t.Inner()); }
+	static size_t HazardRecords(TracingTable<Table, K>& t) { return TableProbe<Table>::HazardRecords(t.Inner()); }
+	static size_t Live(TracingTable<Table, K>& t) { return TableProbe<Table>::Live(t.Inner()); }
+	static size_t Buckets(TracingTable<Table, K>& t) { return TableProbe<Table>::Buckets(t.Inner()); }
+	static TableStats Stats(TracingTable<Table, K>& t) { return TableProbe<Table>::Stats(t.Inner()); }
+	static MemoryUsage Memory(TracingTable<Table, K>& t) { return TableProbe<Table>::Memory(t.Inner()); }
+	static HotSpots<uint64_t> Hot(TracingTable<Table, K>& t) { return TableProbe<Table>::Hot(t.Inner()); }
+	static std::vector<size_t> ChainLengths(TracingTable<Table, K>& t, size_t maxLength) { return TableProbe<Table>::ChainLengths(t.Inner(), maxLength); }
+};
+
+// @brief Run the configured workload on one engine and record every operation.
+// @param name One of ENGINE_NAMES.
+// @param config The benchmark settings.
+// @param path The trace file to write.
+// @param recorded Receives the number of records written.
+// @return The results of the run, or a result with 0 ops if the file could not be created.
+inline BenchResult RunRecorded(const std::string& name, const BenchConfig& config, const std::string& path, uint64_t& recorded)
+{
+	TraceRecorder recorder;
+	if (!recorder.Open(path))
+		return BenchResult();
+	BenchResult result = WithEngine(name, config, [&](auto& table)
+	{
+		TracingTable<std::remove_reference_t<decltype(table)>, uint64_t> traced(table, recorder);
+		return RunBenchmark(traced, config);
+	});
+	recorder.Close();
+	recorded = recorder.Written();
+	CheckFinalSize(name, result);
+	return result;
+}
+
+// @brief Read a trace file written by TraceRecorder.
+// @param path The file.
+// @param records Receives the records, sorted by time.
+// @param error Set on failure.
+// @return True on success.
+inline bool LoadTrace(const std::string& path, std::vector<TraceRecord>& records, std::string& error)
+{
+	std::FILE* f = std::fopen(path.c_str(), "rb");
+	if (!f)
+	{
+		error = "cannot open " + path;
+		return false;
+	}
+	TraceFileHeader header;
+	if (std::fread(&header, sizeof(header), 1, f) != 1 || std::memcmp(header.magic, "LFHTTRC1", 8) != 0 ||
+		header.recordSize != sizeof(TraceRecord))
+	{
+		std::fclose(f);
+		error = path + " is not a trace file";
+		return false;
+	}
+
+	TraceRecord chunk[4096];
+	size_t n;
+	while ((n = std::fread(chunk, sizeof(TraceRecord), 4096, f)) > 0)
+		records.insert(records.end(), chunk, chunk + n);
+	std::fclose(f);
+
+	std::stable_sort(records.begin(), records.end(),
+		[](const TraceRecord& a, const TraceRecord& b) { return a.TimeNs() < b.TimeNs(); });
+	return true;
+}
+
+// Results of a replay
+struct ReplayResult
+{
+	BenchResult result;
+	uint64_t mismatches = 0;  // ops whose outcome differs from the recorded one
+	double traceSec = 0.0;    // span of the recording
+};
+
+// @brief Re-issue a trace against a table. The key hashes are used as keys.
+// The operations of a recorded thread stay on one replay thread and in order.
+// @param table An empty table.
+// @param records The trace, sorted by time.
+// @param threads Replay threads; recorded thread t replays on thread t % threads.
+// @param fast True: issue back to back. False: keep the recorded timing and
+//             measure latency from the recorded start, as in the open loop.
+template <typename Table>
+ReplayResult ReplayTrace(Table& table, const std::vector<TraceRecord>& records, int threads, bool fast)
+{
+	using Clock = std::chrono::steady_clock;
+	ReplayResult replay;
+	if (records.empty())
+		return replay;
+	const uint64_t firstNs = records.front().TimeNs();
+	replay.traceSec = (records.back().TimeNs() - firstNs) / 1e9;
+
+	std::vector<std::vector<const TraceRecord*>> parts(threads);
+	for (const auto& r : records)
+		parts[r.Thread() % threads].push_back(&r);
+
+	std::vector<WorkerResult> results(threads);
+	std::vector<uint64_t> mismatches(threads);
+	std::atomic<bool> stop{ false };
+	std::vector<std::thread> workers;
+	const Clock::time_point begin = Clock::now() + std::chrono::milliseconds(10);
+	for (int t = 0; t < threads; ++t)
+	{
+		workers.emplace_back([&, t]()
+		{
+			WorkerResult& local = results[t];
+			WaitUntil(begin, stop);
+			for (const TraceRecord* r : parts[t])
+			{
+				Clock::time_point opStart;
+				if (fast)
+				{
+					opStart = Clock::now();
+				}
+				else
+				{
+					opStart = begin + std::chrono::nanoseconds(r->TimeNs() - firstNs);
+					WaitUntil(opStart, stop);
+				}
+
+				bool ok;
+				OpType op;
+				switch (r->Op())
+				{
+				case TraceOp::Insert: op = OpType::Insert; ok = table.insert(r->keyHash, r->keyHash); break;
+				case TraceOp::Remove: op = OpType::Remove; ok = table.remove(r->keyHash); break;
+				default: op = OpType::Read; ok = table.contains(r->keyHash); break;
+				}
+
+				uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - opStart).count();
+				local.latency[static_cast<int>(LatencyTypeOf(op, ok))].Record(ns);
+				local.opCounts[static_cast<int>(op)]++;
+				local.succeeded += ok ? 1 : 0;
+				local.ops++;
+				mismatches[t] += ok != r->Result() ? 1 : 0;
+			}
+			local.elapsedSec = std::chrono::duration<double>(Clock::now() - begin).count();
+		});
+	}
+	for (auto& w : workers)
+		w.join();
+	const double elapsed = std::chrono::duration<double>(Clock::now() - begin).count();
+
+	BenchResult& total = replay.result;
+	double threadSeconds = 0.0;
+	for (int t = 0; t < threads; ++t)
+	{
+		const WorkerResult& r = results[t];
+		total.ops += r.ops;
+		for (int i = 0; i < OP_TYPE_COUNT; ++i)
+			total.opCounts[i] += r.opCounts[i];
+		total.succeeded += r.succeeded;
+		threadSeconds += r.elapsedSec;
+		for (int i = 0; i < LATENCY_TYPE_COUNT; ++i)
+			total.latency[i].Merge(r.latency[i]);
+		replay.mismatches += mismatches[t];
+	}
+	total.elapsedSec = elapsed;
+	total.opsPerSec = elapsed > 0.0 ? total.ops / elapsed : 0.0;
+	total.nsPerOp = total.ops > 0 ? threadSeconds * 1e9 / total.ops : 0.0;
+	total.rssBytes = ReadRssBytes();
+	return replay;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <atomic>
+
+// Hands values from one writer thread to one reader thread without locks.
+// The writer fills Back() and publishes it; the reader takes the newest
+// published value with Front(). Neither side ever waits: the third buffer
+// is the one in between, swapped with an exchange.
+// Buffers are reused, so a T holding vectors keeps its capacity.
+template <typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer() : m_back(0), m_middle(1), m_front(2) {}
+	TripleBuffer(const TripleBuffer&) = delete;
+	TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+	// @brief The buffer the writer fills next. It still holds an older value.
+	T& Back()
+	{
+		return m_slots[m_back];
+	}
+
+	// @brief Make the back buffer the newest value. Writer only.
+	void Publish()
+	{
+		m_back = m_middle.exchange(m_back | FRESH, std::memory_order_acq_rel) & INDEX;
+	}
+
+	// @brief The newest published value. Reader only; valid until its next call.
+	const T& Front()
+	{
+		if (m_middle.load(std::memory_order_relaxed) & FRESH)
+			m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX;
+		return m_slots[m_front];
+	}
+
+private:
+	static constexpr int INDEX = 3;
+	static constexpr int FRESH = 4;  // set when the middle buffer was published after the reader's last swap
+
+	T m_slots[3];
+	alignas(64) int m_back;                 // writer only
+	alignas(64) std::atomic<int> m_middle;  // shared
+	alignas(64) int m_front;                // reader only
+};
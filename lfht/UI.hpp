@@ -5,9 +5,14 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <chrono>
+#include <cmath>
+#include <map>
+#include <string>
+#include "MetricsSegment.hpp"
 #include "TestSettings.hpp"
 
-static const char* TYPE_OPTIONS[] = { "Random", "Insert", "Remove" };
+static const char* TYPE_OPTIONS[] = { "Random", "Insert", "Remove", "Calibrate" };
+static const char* GROUPING_OPTIONS[] = { "Thread", "Core", "Socket" };
 
 class UI
 {
@@ -17,12 +22,23 @@ public:
 		m_pWindow(nullptr),
 		m_pTestSettings(setting),
 		m_keyInput(0),
-		m_limitOps(true),
-		m_keyRange(64)
+		m_keyRange(64),
+		m_limitOps(true)
 	{
 		m_numThreadsSlider = 4;
 		m_bucketCountSlider = m_pTestSettings->GetVisualTable()->GetBucketCount();
 		m_currentType = 0;
+		m_currentPlacement = 0;
+		m_sampleHz = 10;
+		m_findKey = 0;
+		m_selectedBucket = -1;
+		m_scrollToSelected = false;
+		m_findPending = false;
+		m_findSample = 0;
+		m_findBuckets = 0;
+		m_threadGrouping = 0;
+		m_heatMetric = HEAT_METRICS - 1;
+		m_lastRemoteFrame = 0;
 	}
 
 	~UI()
@@ -71,12 +87,27 @@ public:
 			ImGui_ImplGlfw_NewFrame();
 			ImGui::NewFrame();
 
-			simulationControls();
-			bucketListing();
-			loadFactorGraph();
-			bucketHistogram();
-			operations();
-			opsPerThread();
+			if (m_reader.IsAttached())
+			{
+				attachedProcess();
+				remoteBucketHistogram();
+				remoteLatency();
+				remoteStats();
+			}
+			else
+			{
+				m_pTestSettings->UpdateStats(std::chrono::steady_clock::now());
+				const TableFrame& frame = m_pTestSettings->GetFrame();
+				simulationControls();
+				bucketListing(frame);
+				loadFactorGraph(frame);
+				bucketHistogram(frame);
+				contentionHeatmap(frame);
+				operations();
+				opsPerThread();
+				latencyTimeline(m_pTestSettings->GetTimeline());
+				hotSpots(frame);
+			}
 
 			ImGui::Render();
 			int display_w, display_h;
@@ -89,6 +120,23 @@ public:
 		}
 	}
 
+	// @brief Watch another process instead of running the local table.
+	// The process must publish its metrics segment (lfht_bench --publish).
+	// @param pid The process.
+	// @param error Set on failure.
+	// @return True if the segment was mapped.
+	bool Attach(int pid, std::string& error)
+	{
+		if (!m_reader.Attach(pid, error))
+			return false;
+		if (m_pWindow)
+		{
+			std::string title = "LockFreeHashTable Visualization - PID " + std::to_string(pid);
+			glfwSetWindowTitle(m_pWindow, title.c_str());
+		}
+		return true;
+	}
+
 	void Cleanup()
 	{
 		m_pTestSettings->Reset();
@@ -112,6 +160,24 @@ private:
 	char m_valueInput[32] = "value";
 	bool m_limitOps;
 	int m_currentType;
+	int m_currentPlacement;
+	int m_sampleHz;
+	int m_findKey;
+	int m_selectedBucket;       // shown in the node pane of the bucket listing, -1 = none
+	bool m_scrollToSelected;
+	bool m_findPending;         // Find Key waits for a frame holding the selected bucket's nodes
+	uint64_t m_findSample;      // sample number of the frame Find Key was pressed on
+	size_t m_findBuckets;       // bucket count Find Key hashed m_findKey with
+	std::string m_findStatus;
+	int m_threadGrouping;       // index into GROUPING_OPTIONS
+	int m_heatMetric;           // index into HEAT_METRIC_NAMES
+
+	// Viewer mode (--attach PID)
+	MetricsReader m_reader;
+	MetricsFrame m_remote;
+	uint64_t m_lastRemoteFrame;
+	std::vector<float> m_remoteOpsHistory;
+	std::vector<float> m_remoteLoadHistory;
 
 	void simulationControls()
 	{
@@ -134,10 +200,14 @@ private:
 		}
 		ImGui::Separator();
 
-		if (ImGui::SliderInt("Key Range", &m_keyRange, 32, 1024))
+		// Samples count every node but copy only the selected bucket, so the
+		// range is bounded by the walk: about 0.5 s per sample at 2^24 keys
+		if (ImGui::SliderInt("Key Range", &m_keyRange, 32, 1 << 24, "%d", ImGuiSliderFlags_Logarithmic))
 		{
 			m_pTestSettings->SetKeyLimit(m_keyRange);
 		}
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Millions of keys slow the sampler down to a few samples per second");
 
 		ImGui::Separator();
 		ImGui::SetNextItemWidth(100);
@@ -146,7 +216,19 @@ private:
 			m_pTestSettings->SetWorkerType(m_currentType);
 		}
 
-		ImGui::SliderInt("Worker Threads", &m_numThreadsSlider, 1, 16);
+		ImGui::SetNextItemWidth(100);
+		if (ImGui::Combo("Placement", &m_currentPlacement, PLACEMENT_NAMES, IM_ARRAYSIZE(PLACEMENT_NAMES)))
+		{
+			m_pTestSettings->SetPlacement(m_currentPlacement);
+		}
+		ImGui::SameLine();
+		ImGui::Text("%d CPUs%s, applies to new workers", (int)m_pTestSettings->GetCpus().size(),
+			HasSmt(m_pTestSettings->GetCpus()) ? " with SMT" : "");
+
+		ImGui::SliderInt("Worker Threads", &m_numThreadsSlider, 1, m_pTestSettings->GetMaxThreads());
+		// Workers own the slots 0..n-1, so a second start would run two threads on one slot
+		const bool running = !m_pTestSettings->GetWorkers().empty();
+		ImGui::BeginDisabled(running);
 		if (ImGui::Button("Start Workers"))
 		{
 			m_pTestSettings->SetRunWorkers(true);
@@ -159,6 +241,7 @@ private:
 				);
 			}
 		}
+		ImGui::EndDisabled();
 		ImGui::SameLine();
 		if (ImGui::Button("Stop Workers"))
 		{
@@ -177,58 +260,141 @@ private:
 		{
 			m_pTestSettings->SetLimitOps(!m_limitOps);
 		}
+
+		ImGui::Separator();
+		if (ImGui::SliderInt("Sample Rate (Hz)", &m_sampleHz, 1, 60))
+		{
+			m_pTestSettings->SetSampleRate(m_sampleHz);
+		}
 		ImGui::End();
 	}
 	 
-	void bucketListing()
+	void bucketListing(const TableFrame& frame)
 	{
 		ImGui::Begin("Bucket Listing");
-		auto snapshot = m_pTestSettings->GetVisualTable()->GetSnapshot();
+		const int buckets = static_cast<int>(frame.activeCounts.size());
+		// A resize since Find Key moved the key to another bucket: look it up again in the new array
+		if (m_findPending && frame.sample > m_findSample && frame.activeCounts.size() != m_findBuckets)
+			findKey(frame);
+		if (m_selectedBucket >= buckets && frame.sample > 0 && !m_findPending)
+			selectBucket(-1);
+		const bool sampled = m_selectedBucket >= 0 && frame.selectedBucket == m_selectedBucket;
+		if (m_findPending && sampled && frame.sample > m_findSample)
+		{
+			m_findPending = false;
+			bool found = false;
+			for (const auto& node : frame.nodes)
+				found = found || (std::get<0>(node) == m_findKey && !std::get<2>(node));
+			m_findStatus = found ? "in bucket " + std::to_string(m_selectedBucket) : "not found";
+		}
 
-		for (size_t i = 0; i < snapshot.size(); ++i)
+		ImGui::SetNextItemWidth(120);
+		ImGui::InputInt("##FindKey", &m_findKey);
+		ImGui::SameLine();
+		if (ImGui::Button("Find Key"))
+			findKey(frame);
+		ImGui::SameLine();
+		ImGui::Text("%s", m_findStatus.c_str());
+
+		// Only the visible rows are submitted, so the listing stays cheap with millions of buckets
+		const float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+		ImGui::BeginChild("Buckets", ImVec2(260, 0), ImGuiChildFlags_Borders);
+		if (m_scrollToSelected && m_selectedBucket >= 0)
+		{
+			ImGui::SetScrollY(m_selectedBucket * rowHeight);
+			m_scrollToSelected = false;
+		}
+		ImGuiListClipper clipper;
+		clipper.Begin(buckets, rowHeight);
+		while (clipper.Step())
 		{
-			std::stringstream header;
-			int activeCount = 0;
-			for (const auto& node : snapshot[i])
+			for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i)
 			{
-				if (!std::get<2>(node))
-					activeCount++;
+				char label[64];
+				snprintf(label, sizeof(label), "Bucket %d (%d nodes)", i, static_cast<int>(frame.activeCounts[i]));
+				if (ImGui::Selectable(label, i == m_selectedBucket))
+				{
+					selectBucket(i);
+					m_findPending = false;
+				}
 			}
-			header << "Bucket " << i << " (" << activeCount << " nodes)";
-			if (ImGui::CollapsingHeader(header.str().c_str()))
+		}
+		ImGui::EndChild();
+
+		ImGui::SameLine();
+		ImGui::BeginChild("Nodes", ImVec2(0, 0), ImGuiChildFlags_Borders);
+		if (sampled)
+		{
+			ImGuiListClipper nodeClipper;
+			nodeClipper.Begin(static_cast<int>(frame.nodes.size()), rowHeight);
+			while (nodeClipper.Step())
 			{
-				for (const auto& node : snapshot[i])
+				for (int n = nodeClipper.DisplayStart; n < nodeClipper.DisplayEnd; ++n)
 				{
 					int key;
 					std::string val;
 					bool marked;
-					std::tie(key, val, marked) = node;
+					std::tie(key, val, marked) = frame.nodes[n];
 					std::stringstream nodeStr;
 					nodeStr << "Key: " << key << ", Val: " << val << (marked ? " [Marked]" : "");
-					ImGui::Text("%s", nodeStr.str().c_str());
+					if (key == m_findKey)
+						ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "%s", nodeStr.str().c_str());
+					else
+						ImGui::Text("%s", nodeStr.str().c_str());
 				}
 			}
 		}
+		else if (m_selectedBucket >= 0)
+		{
+			ImGui::Text("Reading bucket %d...", m_selectedBucket);
+		}
+		else
+		{
+			ImGui::Text("Select a bucket, or find a key.");
+		}
+		ImGui::EndChild();
 
 		ImGui::End();
 	}
 
-	void loadFactorGraph()
+	// @brief Select the bucket m_findKey hashes to in the live array. The next
+	// frame of an array that size holding the bucket's nodes tells whether the
+	// key is there.
+	// @param frame The newest frame, later frames answer the search.
+	void findKey(const TableFrame& frame)
 	{
-		ImGui::Begin("Load Factor Graph");
+		const size_t buckets = m_pTestSettings->GetVisualTable()->GetBucketCount();
+		if (buckets == 0)
+			return;
+		selectBucket(static_cast<int>(m_pTestSettings->GetVisualTable()->GetBucketOf(m_findKey, buckets)));
+		m_scrollToSelected = true;
+		m_findPending = true;
+		m_findSample = frame.sample;
+		m_findBuckets = buckets;
+		m_findStatus = "searching...";
+	}
 
-		m_pTestSettings->UpdateLoadFactorHistory();
-		const auto& loadFactorHistory = m_pTestSettings->GetLoadFactorHistory();
+	// @brief Show a bucket in the node pane, and have the sampler copy its nodes.
+	// @param bucket The bucket index, -1 for none.
+	void selectBucket(int bucket)
+	{
+		m_selectedBucket = bucket;
+		m_pTestSettings->SelectBucket(bucket);
+	}
 
-		if (!loadFactorHistory.empty())
+	void loadFactorGraph(const TableFrame& frame)
+	{
+		ImGui::Begin("Load Factor Graph");
+
+		if (frame.historySize > 0)
 		{
 			constexpr float lowerBound = 0.25f;
 			constexpr float upperBound = 2.0f;
-			const int numPoints = static_cast<int>(loadFactorHistory.size());
-			const float latestValue = loadFactorHistory.back();
+			const int numPoints = frame.historySize;
+			const float latestValue = frame.loadFactor;
 
 			ImVec2 graphSize = ImVec2(600, 200);
-			ImGui::PlotLines("Load Factor", loadFactorHistory.data(), numPoints, 0,
+			ImGui::PlotLines("Load Factor", frame.loadFactorHistory, numPoints, frame.historyOffset,
 				"Active Load Factor", 0.0f, 5.0f, graphSize);
 
 			ImDrawList* drawList = ImGui::GetWindowDrawList();
@@ -266,82 +432,529 @@ private:
 		ImGui::End();
 	}
 
-	void bucketHistogram()
+	void bucketHistogram(const TableFrame& frame)
 	{
 		ImGui::Begin("Bucket Histogram");
-		auto bucketInfos = m_pTestSettings->GetBucketInfoSnapshot();
-		std::vector<float> bucketCounts;
-		for (const auto& b : bucketInfos)
+		const float maxBucket = std::max(frame.maxActive, 1.0f);
+		if (frame.bucketsPerGroup == 1)
+		{
+			ImGui::PlotHistogram("Bucket Sizes", frame.activeCounts.data(), static_cast<int>(frame.activeCounts.size()),
+				0, "Active Nodes per Bucket", 0.0f, maxBucket + 1.0f, ImVec2(600, 200));
+		}
+		else
+		{
+			ImGui::Text("%zu buckets per column: max, average and min of their active nodes", frame.bucketsPerGroup);
+			rangeHistogram(frame, maxBucket + 1.0f, ImVec2(600, 200));
+		}
+		ImGui::Text("Total Buckets: %d", (int)frame.activeCounts.size());
+		ImGui::Text("Active Nodes: %zu, Marked: %zu", frame.activeNodes, frame.markedNodes);
+
+		ImGui::PlotHistogram("Chain Lengths", frame.chainLengths, CHAIN_LENGTH_BINS, 0, "Buckets by Active Nodes",
+			0.0f, std::max(frame.maxChainBin, 1.0f) * 1.1f, ImVec2(600, 150));
+		ImGui::Text("Chain length 0 .. %d, the last bar holds longer chains", CHAIN_LENGTH_BINS - 1);
+		ImGui::End();
+	}
+
+	// @brief Draw one column per bucket group, shaded up to the group's max, average and min.
+	// @param frame The frame with the groups.
+	// @param scaleMax Active nodes at the top of the plot.
+	// @param size Size of the plot.
+	void rangeHistogram(const TableFrame& frame, float scaleMax, ImVec2 size)
+	{
+		const ImVec2 pos = ImGui::GetCursorScreenPos();
+		ImGui::InvisibleButton("RangeHistogram", size);
+		ImDrawList* drawList = ImGui::GetWindowDrawList();
+		drawList->AddRectFilled(pos, ImVec2(pos.x + size.x, pos.y + size.y), ImGui::GetColorU32(ImGuiCol_FrameBg));
+
+		const int columns = static_cast<int>(frame.groupMax.size());
+		const float width = size.x / columns;
+		const float bottom = pos.y + size.y;
+		auto top = [&](float value) { return bottom - std::min(value / scaleMax, 1.0f) * size.y; };
+		for (int c = 0; c < columns; ++c)
 		{
-			bucketCounts.push_back(static_cast<float>(b.nodeCount));
+			const float x0 = pos.x + c * width;
+			const float x1 = x0 + std::max(width - 1.0f, 1.0f);
+			drawList->AddRectFilled(ImVec2(x0, top(frame.groupMax[c])), ImVec2(x1, bottom), IM_COL32(90, 110, 160, 255));
+			drawList->AddRectFilled(ImVec2(x0, top(frame.groupAvg[c])), ImVec2(x1, bottom), IM_COL32(230, 180, 60, 255));
+			drawList->AddRectFilled(ImVec2(x0, top(frame.groupMin[c])), ImVec2(x1, bottom), IM_COL32(160, 70, 40, 255));
 		}
-		float maxBucket = 1.0f;
-		if (!bucketCounts.empty())
+
+		if (ImGui::IsItemHovered() && columns > 0)
 		{
-			maxBucket = *std::max_element(bucketCounts.begin(), bucketCounts.end());
-			if (maxBucket < 1.0f)
-				maxBucket = 1.0f;
+			const int c = std::min(columns - 1, static_cast<int>((ImGui::GetIO().MousePos.x - pos.x) / width));
+			const size_t first = c * frame.bucketsPerGroup;
+			const size_t last = std::min(first + frame.bucketsPerGroup, frame.activeCounts.size()) - 1;
+			ImGui::SetTooltip("Buckets %zu .. %zu\nmin %.0f, avg %.2f, max %.0f", first, last,
+				frame.groupMin[c], frame.groupAvg[c], frame.groupMax[c]);
 		}
-		ImGui::PlotHistogram("Bucket Sizes", bucketCounts.data(), static_cast<int>(bucketCounts.size()),
-			0, "Active Nodes per Bucket", 0.0f, maxBucket + 1.0f, ImVec2(600, 200));
-		ImGui::Text("Total Buckets: %d", (int)bucketCounts.size());
+	}
+
+	void contentionHeatmap(const TableFrame& frame)
+	{
+		ImGui::Begin("Contention Heatmap");
+		if (!frame.contentionEnabled)
+		{
+			ImGui::Text("Build with LFHT_ENABLE_STATS to count contention per bucket.");
+			ImGui::End();
+			return;
+		}
+
+		ImGui::SetNextItemWidth(140);
+		ImGui::Combo("Metric", &m_heatMetric, HEAT_METRIC_NAMES, IM_ARRAYSIZE(HEAT_METRIC_NAMES));
+		ImGui::Text("%zu bucket%s per cell, events of the last %.2f s", frame.heatBucketsPerCell,
+			frame.heatBucketsPerCell == 1 ? "" : "s", frame.heatIntervalSec);
+
+		const std::vector<float>& heat = frame.heat[m_heatMetric];
+		const int cells = static_cast<int>(heat.size());
+		const int columns = std::max(1, static_cast<int>(std::ceil(std::sqrt(static_cast<double>(cells)))));
+		const int rows = std::max(1, (cells + columns - 1) / columns);
+		const float cellSize = std::max(2.0f, std::min(ImGui::GetContentRegionAvail().x, 600.0f) / columns);
+		const ImVec2 pos = ImGui::GetCursorScreenPos();
+		ImGui::InvisibleButton("Heat", ImVec2(cellSize * columns, cellSize * rows));
+		ImDrawList* drawList = ImGui::GetWindowDrawList();
+		const float maxHeat = std::max(frame.heatMax[m_heatMetric], 1.0f);
+		for (int c = 0; c < cells; ++c)
+		{
+			const ImVec2 cellPos(pos.x + (c % columns) * cellSize, pos.y + (c / columns) * cellSize);
+			drawList->AddRectFilled(cellPos, ImVec2(cellPos.x + cellSize - 1.0f, cellPos.y + cellSize - 1.0f),
+				heatColor(heat[c] / maxHeat));
+		}
+
+		if (ImGui::IsItemHovered() && cells > 0)
+		{
+			const ImVec2 mouse = ImGui::GetIO().MousePos;
+			const int c = static_cast<int>((mouse.y - pos.y) / cellSize) * columns + static_cast<int>((mouse.x - pos.x) / cellSize);
+			if (c >= 0 && c < cells)
+			{
+				const size_t first = c * frame.heatBucketsPerCell;
+				ImGui::SetTooltip("Buckets %zu .. %zu\nCAS failures %.0f\nHelp unlinks %.0f\nRetries %.0f", first,
+					first + frame.heatBucketsPerCell - 1, frame.heat[0][c], frame.heat[1][c], frame.heat[2][c]);
+			}
+		}
+
+		ImGui::Text("CAS failures %llu, help unlinks %llu, retries %llu", (unsigned long long)frame.heatTotal[0],
+			(unsigned long long)frame.heatTotal[1], (unsigned long long)frame.heatTotal[2]);
+		ImGui::Text("%zu of %zu buckets had events, the busiest 1%% of the buckets had %.0f%% of them",
+			frame.heatBuckets, frame.activeCounts.size(), frame.heatTopShare * 100.0f);
 		ImGui::End();
 	}
+
+	// @brief Color of a heatmap cell.
+	// @param t Heat relative to the hottest cell, in [0, 1].
+	static ImU32 heatColor(float t)
+	{
+		if (t <= 0.0f)
+			return IM_COL32(40, 44, 52, 255);
+		// sqrt so that cells with a few events still stand out next to a hot one
+		t = std::sqrt(std::min(t, 1.0f));
+		const int r = static_cast<int>(90 + 165 * std::min(1.0f, t * 2.0f));
+		const int g = static_cast<int>(t > 0.5f ? 220 * (t - 0.5f) * 2.0f : 20);
+		return IM_COL32(r, g, 30, 255);
+	}
+
 	void operations()
 	{
 		ImGui::Begin("Operations");
-		int insertOps = m_pTestSettings->GetOpInsertCount();
-		int removeOps = m_pTestSettings->GetOpRemoveCount();
-		ImGui::Text("Insert Ops: %d", insertOps);
-		ImGui::Text("Remove Ops: %d", removeOps);
-		ImGui::Text("Total Ops: %d", insertOps + removeOps);
+		uint64_t insertOps = m_pTestSettings->GetOpInsertCount();
+		uint64_t removeOps = m_pTestSettings->GetOpRemoveCount();
+		ImGui::Text("Insert Ops: %llu", (unsigned long long)insertOps);
+		ImGui::Text("Remove Ops: %llu", (unsigned long long)removeOps);
+		ImGui::Text("Total Ops: %llu", (unsigned long long)(insertOps + removeOps));
+		ImGui::Text("Worker Iterations: %llu", (unsigned long long)m_pTestSettings->GetWorkerOpCount());
+		// In the Calibrate mode no table operation runs, this is what the harness costs by itself
+		ImGui::Text("%s: %.0f ns/op", m_currentType == WORKER_CALIBRATE ? "Harness Overhead" : "Loop Cost",
+			m_pTestSettings->GetNsPerOp());
 		if (ImGui::Button("Reset Ops"))
 		{
 			m_pTestSettings->Reset();
 		}
 		ImGui::End();
 	}
-	void opsPerThread()
+	void hotSpots(const TableFrame& frame)
 	{
-		auto now = std::chrono::steady_clock::now();
-		if (std::chrono::duration_cast<std::chrono::seconds>(now - m_pTestSettings->GetLastOpsUpdateTime()).count() >= 1)
+		ImGui::Begin("Hot Spots");
+		const HotSpots<int>& spots = frame.hotSpots;
+		if (!spots.enabled)
+		{
+			ImGui::Text("Build with LFHT_ENABLE_STATS to sample hot keys and buckets.");
+			ImGui::End();
+			return;
+		}
+
+		ImGui::Text("Most used keys (1 in %u operations sampled)", spots.sample_rate);
+		if (ImGui::BeginTable("HotKeys", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+		{
+			ImGui::TableSetupColumn("Key");
+			ImGui::TableSetupColumn("Samples");
+			ImGui::TableSetupColumn("Error");
+			ImGui::TableHeadersRow();
+			for (const auto& k : spots.keys)
+			{
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::Text("%d", k.item);
+				ImGui::TableNextColumn();
+				ImGui::Text("%llu", (unsigned long long)k.count);
+				ImGui::TableNextColumn();
+				ImGui::Text("<= %llu", (unsigned long long)k.error);
+			}
+			ImGui::EndTable();
+		}
+
+		ImGui::Separator();
+		ImGui::Text("Buckets with the most failed CAS");
+		if (ImGui::BeginTable("HotBuckets", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
 		{
-			for (int i = 0; i < (int)m_pTestSettings->GetThreadOpCounts().size(); i++)
+			ImGui::TableSetupColumn("Bucket");
+			ImGui::TableSetupColumn("Of");
+			ImGui::TableSetupColumn("Failures");
+			ImGui::TableHeadersRow();
+			for (const auto& b : spots.buckets)
 			{
-				int currentCount = m_pTestSettings->GetThreadOpCounts()[i].load();
-				m_pTestSettings->SetThreadOpsPerSec(i, currentCount - m_pTestSettings->GetLastThreadCounts(i));
-				m_pTestSettings->SetLastThreadCounts(i, currentCount);
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::Text("%zu", b.item.index);
+				ImGui::TableNextColumn();
+				ImGui::Text("%zu", b.item.buckets);
+				ImGui::TableNextColumn();
+				ImGui::Text("%llu", (unsigned long long)b.count);
 			}
-			m_pTestSettings->SetLastOpsUpdateTime(now);
+			ImGui::EndTable();
 		}
+		ImGui::End();
+	}
 
+	void opsPerThread()
+	{
 		ImGui::Begin("Ops Per Thread (ops/sec)");
+		ImGui::Text("Placement: %s", m_pTestSettings->GetPlacement());
+		ImGui::SameLine();
+		ImGui::SetNextItemWidth(100);
+		ImGui::Combo("Group By", &m_threadGrouping, GROUPING_OPTIONS, IM_ARRAYSIZE(GROUPING_OPTIONS));
+
+		// One row per thread, or per core or socket the threads are pinned to
+		struct Row
+		{
+			std::string label;
+			float opsSec = 0.0f;
+			int threads = 0;
+		};
+		std::map<int, Row> rows;
+		const std::vector<CpuInfo>& cpus = m_pTestSettings->GetCpus();
+		const int nThreads = m_numThreadsSlider;
+		for (int i = 0; i < nThreads; i++)
+		{
+			const int cpu = m_pTestSettings->GetWorkerCpu(i);
+			const CpuInfo* info = nullptr;
+			for (const CpuInfo& c : cpus)
+			{
+				if (c.cpu == cpu)
+					info = &c;
+			}
+			int id = i;
+			char label[64];
+			if (m_threadGrouping == 0)
+			{
+				if (cpu >= 0)
+					snprintf(label, sizeof(label), "Thread %d (cpu %d)", i, cpu);
+				else
+					snprintf(label, sizeof(label), "Thread %d", i);
+			}
+			else if (!info)
+			{
+				id = -1;
+				snprintf(label, sizeof(label), "Unpinned");
+			}
+			else if (m_threadGrouping == 1)
+			{
+				id = info->package * 65536 + info->core;
+				snprintf(label, sizeof(label), "Socket %d core %d", info->package, info->core);
+			}
+			else
+			{
+				id = info->package;
+				snprintf(label, sizeof(label), "Socket %d", info->package);
+			}
+			Row& row = rows[id];
+			row.label = label;
+			row.opsSec += (float)m_pTestSettings->GetThreadOpsPerSec(i);
+			row.threads++;
+		}
+
+		std::vector<const Row*> ordered;
+		float maxOpsSec = 1.0f;
+		for (const auto& entry : rows)
+		{
+			ordered.push_back(&entry.second);
+			maxOpsSec = std::max(maxOpsSec, entry.second.opsSec);
+		}
+
+		ImGui::BeginChild("Rows");
+		ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(0.0f, 0.0f));  // rows exactly rowHeight apart, as the clipper assumes
 		ImVec2 avail = ImGui::GetContentRegionAvail();
 		if (avail.y < 100) avail.y = 100;
+		const float rowHeight = std::max(avail.y / std::max<int>(1, (int)ordered.size()), 20.0f);
+		const float barMaxWidth = avail.x;
+		const float padding = std::min(4.0f, rowHeight * 0.1f);
 		ImDrawList* draw_list = ImGui::GetWindowDrawList();
-		ImVec2 winPos = ImGui::GetCursorScreenPos();
+		ImGuiListClipper clipper;
+		clipper.Begin(static_cast<int>(ordered.size()), rowHeight);
+		while (clipper.Step())
+		{
+			for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
+			{
+				const Row& row = *ordered[i];
+				ImVec2 rowPos = ImGui::GetCursorScreenPos();
+				float barWidth = (row.opsSec / maxOpsSec) * barMaxWidth;
+				ImU32 col = IM_COL32(48, 89, 255, 255);
+				draw_list->AddRectFilled(ImVec2(rowPos.x, rowPos.y + padding),
+					ImVec2(rowPos.x + barWidth, rowPos.y + rowHeight - padding), col);
+				char buf[128];
+				if (m_threadGrouping == 0)
+					snprintf(buf, sizeof(buf), "%s: %.0f ops/sec", row.label.c_str(), row.opsSec);
+				else
+					snprintf(buf, sizeof(buf), "%s, %d threads: %.0f ops/sec", row.label.c_str(), row.threads, row.opsSec);
+				draw_list->AddText(ImVec2(rowPos.x + 4.0f, rowPos.y + (rowHeight - ImGui::GetTextLineHeight()) * 0.5f),
+					IM_COL32(255, 255, 255, 255), buf);
+				ImGui::Dummy(ImVec2(barMaxWidth, rowHeight));
+			}
+		}
+		ImGui::PopStyleVar();
+		ImGui::EndChild();
+		ImGui::End();
+	}
 
-		int nThreads = m_numThreadsSlider;
-		float rowHeight = avail.y / nThreads;
-		float maxOpsSec = 1.0f;
-		for (int i = 0; i < nThreads; i++)
+	void latencyTimeline(const TimelineFrame& timeline)
+	{
+		ImGui::Begin("Latency Timeline");
+		ImGui::Text("Last %d s at %d ms per point, newest on the right", TIMELINE_POINTS * TIMELINE_TICK_MS / 1000, TIMELINE_TICK_MS);
+		ImGui::TextColored(ImVec4(0.3f, 0.8f, 0.4f, 1.0f), "p50");
+		ImGui::SameLine();
+		ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.2f, 1.0f), "p99");
+		ImGui::SameLine();
+		ImGui::TextColored(ImVec4(0.9f, 0.2f, 0.2f, 1.0f), "p99.9");
+		ImGui::SameLine();
+		ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.3f, 1.0f), "| resize");
+		ImGui::SameLine();
+		ImGui::TextColored(ImVec4(0.3f, 0.8f, 1.0f, 1.0f), "| reclamation scan");
+
+		const ImU32 percentileColors[] = { IM_COL32(77, 204, 102, 255), IM_COL32(255, 153, 51, 255), IM_COL32(230, 51, 51, 255) };
+		const float width = std::max(ImGui::GetContentRegionAvail().x, 200.0f);
+		for (int type = 0; type < TIMED_OP_COUNT; ++type)
 		{
-			maxOpsSec = std::max(maxOpsSec, (float)m_pTestSettings->GetThreadOpsPerSec(i));
+			const float* series[] = { timeline.p50[type], timeline.p99[type], timeline.p999[type] };
+			float maxNs = 1.0f;
+			for (int i = 0; i < timeline.size; ++i)
+				maxNs = std::max(maxNs, timeline.p999[type][i]);
+			ImGui::Text("%s latency (ns, log scale, top %.0f)", TIMED_OP_NAMES[type], maxNs);
+			timelineChart(TIMED_OP_NAMES[type], timeline, series, percentileColors, 3, maxNs, true, ImVec2(width, 140));
 		}
-		float barMaxWidth = avail.x;
-		float padding = 4.0f;
-		for (int i = 0; i < nThreads; i++)
+
+		const float* throughput[] = { timeline.opsPerSec };
+		const ImU32 throughputColor[] = { IM_COL32(48, 89, 255, 255) };
+		float maxOps = 1.0f;
+		for (int i = 0; i < timeline.size; ++i)
+			maxOps = std::max(maxOps, timeline.opsPerSec[i]);
+		ImGui::Text("Throughput (ops/sec, top %.0f)", maxOps);
+		timelineChart("Throughput", timeline, throughput, throughputColor, 1, maxOps * 1.1f, false, ImVec2(width, 120));
+		ImGui::End();
+	}
+
+	// @brief Draw series of the timeline over a rolling time axis, with a vertical
+	// line at every point that had a resize or a reclamation scan.
+	// @param id ImGui id of the chart.
+	// @param timeline The timeline the series belong to.
+	// @param series Ring buffers laid out like the timeline's.
+	// @param colors Color of each series.
+	// @param seriesCount Number of series.
+	// @param maxValue Value at the top of the chart.
+	// @param logScale Scale the values by log2, for latencies that span several orders.
+	// @param size Size of the chart.
+	void timelineChart(const char* id, const TimelineFrame& timeline, const float* const* series, const ImU32* colors,
+		int seriesCount, float maxValue, bool logScale, ImVec2 size)
+	{
+		const ImVec2 pos = ImGui::GetCursorScreenPos();
+		ImGui::InvisibleButton(id, size);
+		ImDrawList* drawList = ImGui::GetWindowDrawList();
+		const ImVec2 end(pos.x + size.x, pos.y + size.y);
+		drawList->AddRectFilled(pos, end, ImGui::GetColorU32(ImGuiCol_FrameBg));
+		drawList->PushClipRect(pos, end, true);
+
+		const float dx = size.x / (TIMELINE_POINTS - 1);
+		auto xAt = [&](int i) { return end.x - (timeline.size - 1 - i) * dx; };
+		const float top = logScale ? std::log2(std::max(maxValue, 2.0f)) : maxValue;
+		auto yAt = [&](float v) {
+			float scaled = logScale ? (v >= 1.0f ? std::log2(v) : 0.0f) : v;
+			return end.y - std::min(scaled / top, 1.0f) * size.y;
+		};
+
+		for (int i = 0; i < timeline.size; ++i)
+		{
+			const int r = timeline.At(i);
+			if (timeline.resizes[r] > 0.0f)
+				drawList->AddLine(ImVec2(xAt(i), pos.y), ImVec2(xAt(i), end.y), IM_COL32(255, 255, 77, 160));
+			if (timeline.scans[r] > 0.0f)
+				drawList->AddLine(ImVec2(xAt(i), pos.y), ImVec2(xAt(i), end.y), IM_COL32(77, 204, 255, 90));
+		}
+		for (int s = 0; s < seriesCount; ++s)
+		{
+			for (int i = 1; i < timeline.size; ++i)
+			{
+				drawList->AddLine(ImVec2(xAt(i - 1), yAt(series[s][timeline.At(i - 1)])),
+					ImVec2(xAt(i), yAt(series[s][timeline.At(i)])), colors[s], 1.5f);
+			}
+		}
+		drawList->PopClipRect();
+
+		if (ImGui::IsItemHovered() && timeline.size > 0)
 		{
-			float ops = (float)m_pTestSettings->GetThreadOpsPerSec(i);
-			float barWidth = (ops / maxOpsSec) * barMaxWidth;
-			float barY = winPos.y + i * rowHeight;
-			ImU32 col = IM_COL32(48, 89, 255, 255);
-			ImVec2 barStart(winPos.x, barY + padding);
-			ImVec2 barEnd(winPos.x + barWidth, barY + rowHeight - padding);
-			draw_list->AddRectFilled(barStart, barEnd, col);
-			char buf[64];
-			sprintf_s(buf, "Thread %d: %.0f ops/sec", i, ops);
-			draw_list->AddText(ImVec2(winPos.x + (barWidth * 0.15f), barY + rowHeight * 0.35f), IM_COL32(255, 255, 255, 510), buf);
+			const int i = std::clamp(timeline.size - 1 - static_cast<int>((end.x - ImGui::GetIO().MousePos.x) / dx + 0.5f),
+				0, timeline.size - 1);
+			const int r = timeline.At(i);
+			std::string tip;
+			char line[96];
+			snprintf(line, sizeof(line), "%.1f s ago", (timeline.size - 1 - i) * TIMELINE_TICK_MS / 1000.0f);
+			tip += line;
+			for (int s = 0; s < seriesCount; ++s)
+			{
+				snprintf(line, sizeof(line), "\n%.0f", series[s][r]);
+				tip += line;
+			}
+			if (timeline.resizes[r] > 0.0f)
+				tip += "\nresize";
+			if (timeline.scans[r] > 0.0f)
+				tip += "\nreclamation scan";
+			ImGui::SetTooltip("%s", tip.c_str());
+		}
+	}
+
+	// @brief Read the latest frame of the attached process and extend the histories.
+	// @return False if nothing was published yet.
+	bool readRemote()
+	{
+		if (!m_reader.Read(m_remote))
+			return false;
+		if (m_remote.frame != m_lastRemoteFrame)
+		{
+			m_lastRemoteFrame = m_remote.frame;
+			m_remoteOpsHistory.push_back(static_cast<float>(m_remote.opsPerSec));
+			m_remoteLoadHistory.push_back(static_cast<float>(m_remote.loadFactor));
+			if (m_remoteOpsHistory.size() > MAX_HISTORY_SIZE)
+			{
+				m_remoteOpsHistory.erase(m_remoteOpsHistory.begin());
+				m_remoteLoadHistory.erase(m_remoteLoadHistory.begin());
+			}
+		}
+		return true;
+	}
+
+	void attachedProcess()
+	{
+		ImGui::Begin("Attached Process");
+		const bool alive = m_reader.IsAlive();
+		ImGui::Text("PID %d (%s)", m_reader.GetPid(), alive ? "running" : "exited");
+		if (!readRemote())
+		{
+			ImGui::Text("Waiting for the first frame...");
+			ImGui::End();
+			return;
+		}
+		ImGui::Text("%s", m_remote.label);
+		ImGui::Text("Frame %llu", (unsigned long long)m_remote.frame);
+		ImGui::Separator();
+		ImGui::Text("Ops: %llu (%.0f ops/sec)", (unsigned long long)m_remote.ops, m_remote.opsPerSec);
+		ImGui::Text("Live: %llu in %llu buckets, load factor %.2f", (unsigned long long)m_remote.live,
+			(unsigned long long)m_remote.buckets, m_remote.loadFactor);
+		ImGui::Text("Resizes: %llu", (unsigned long long)m_remote.resizes);
+		ImGui::Text("Retired: %llu, hazard records: %llu", (unsigned long long)m_remote.retired,
+			(unsigned long long)m_remote.hazardRecords);
+		ImGui::Text("Memory: %.1f KiB", m_remote.memoryBytes / 1024.0);
+
+		if (!m_remoteOpsHistory.empty())
+		{
+			float maxOps = *std::max_element(m_remoteOpsHistory.begin(), m_remoteOpsHistory.end());
+			ImGui::PlotLines("Ops/sec", m_remoteOpsHistory.data(), static_cast<int>(m_remoteOpsHistory.size()), 0,
+				nullptr, 0.0f, std::max(maxOps, 1.0f) * 1.1f, ImVec2(600, 120));
+			ImGui::PlotLines("Load Factor", m_remoteLoadHistory.data(), static_cast<int>(m_remoteLoadHistory.size()), 0,
+				nullptr, 0.0f, 5.0f, ImVec2(600, 120));
+		}
+		ImGui::End();
+	}
+
+	void remoteBucketHistogram()
+	{
+		ImGui::Begin("Bucket Histogram");
+		float counts[METRICS_CHAIN_BINS];
+		float maxCount = 1.0f;
+		for (int i = 0; i < METRICS_CHAIN_BINS; ++i)
+		{
+			counts[i] = static_cast<float>(m_remote.chainBins[i]);
+			maxCount = std::max(maxCount, counts[i]);
+		}
+		ImGui::PlotHistogram("Buckets", counts, METRICS_CHAIN_BINS, 0, "Buckets by Active Nodes",
+			0.0f, maxCount * 1.1f, ImVec2(600, 200));
+		ImGui::Text("Chain length 0 .. %d, the last bar holds longer chains", METRICS_CHAIN_BINS - 1);
+		ImGui::End();
+	}
+
+	void remoteLatency()
+	{
+		ImGui::Begin("Latency");
+		ImGui::Text("Operations of the last %.2f s, upper bounds in ns", m_remote.intervalSec);
+		if (ImGui::BeginTable("RemoteLatency", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+		{
+			ImGui::TableSetupColumn("Operation");
+			ImGui::TableSetupColumn("Count");
+			ImGui::TableSetupColumn("p50");
+			ImGui::TableSetupColumn("p99");
+			ImGui::TableSetupColumn("p99.9");
+			ImGui::TableHeadersRow();
+			for (int type = 0; type < m_reader.GetLatencyTypes(); ++type)
+			{
+				const uint64_t* bins = m_remote.latency[type];
+				uint64_t count = 0;
+				for (int i = 0; i < METRICS_LATENCY_BINS; ++i)
+					count += bins[i];
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::Text("%s", m_reader.GetLatencyName(type));
+				ImGui::TableNextColumn();
+				ImGui::Text("%llu", (unsigned long long)count);
+				ImGui::TableNextColumn();
+				ImGui::Text("%llu", (unsigned long long)MetricsPercentile(bins, 50.0));
+				ImGui::TableNextColumn();
+				ImGui::Text("%llu", (unsigned long long)MetricsPercentile(bins, 99.0));
+				ImGui::TableNextColumn();
+				ImGui::Text("%llu", (unsigned long long)MetricsPercentile(bins, 99.9));
+			}
+			ImGui::EndTable();
+		}
+		ImGui::End();
+	}
+
+	void remoteStats()
+	{
+		ImGui::Begin("Table Statistics");
+		if (!m_remote.statsEnabled)
+		{
+			ImGui::Text("The process was built without LFHT_ENABLE_STATS.");
+			ImGui::End();
+			return;
+		}
+		if (ImGui::BeginTable("RemoteStats", 2, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+		{
+			ImGui::TableSetupColumn("Counter");
+			ImGui::TableSetupColumn("Value");
+			ImGui::TableHeadersRow();
+			for (size_t i = 0; i < TableStats::COUNT; ++i)
+			{
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::Text("%s", TABLE_STAT_NAMES[i]);
+				ImGui::TableNextColumn();
+				ImGui::Text("%llu", (unsigned long long)m_remote.stats[i]);
+			}
+			ImGui::EndTable();
 		}
 		ImGui::End();
 	}
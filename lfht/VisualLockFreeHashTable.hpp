@@ -1,5 +1,4 @@
 ﻿#pragma once
-#include <mutex>
 #include <thread>
 #include <atomic>
 #include <vector>
@@ -10,30 +9,13 @@ template<typename K, typename V>
 class VisualLockFreeHashTable 
 {
 public:    
-    VisualLockFreeHashTable()
-    {
-		m_numBuckets = m_table.getBucketSize();
-        m_shadowBuckets.resize(m_numBuckets);
-        m_totalRemoved.store(0);
-
-    }
-
     // @brief Insert operation.
 	// @param key The key to insert.
 	// @param value The value to insert.
 	// @return True if the insert was successful, false if the key already exists.
     bool Insert(const K& key, const V& value)
     {
-        bool result = m_table.insert(key, value);
-        if (result) 
-        {
-            updateBucketCount();
-            size_t bucketIndex = key % m_numBuckets;
-            std::lock_guard<std::mutex> lock(m_shadowMutex);
-            m_shadowBuckets[bucketIndex].push_back(std::make_tuple(key, value, false));
-        }
-
-        return result;
+        return m_table.insert(key, value);
     }
 
     // @brief Remove operation.
@@ -41,91 +23,94 @@ public:
 	// @return True if the remove was successful, false if the key was not found.
     bool Remove(const K& key)
     {
-        bool result = m_table.remove(key);
-        if (result) 
-        {
-            updateBucketCount();
-            size_t bucketIndex = key % m_numBuckets;
-            std::lock_guard<std::mutex> lock(m_shadowMutex);
-            // Mark the first matching active node as removed.
-            for (auto& node : m_shadowBuckets[bucketIndex]) 
-            {
-                if (std::get<0>(node) == key && !std::get<2>(node)) 
-                {
-                    std::get<2>(node) = true;
-                    break;
-                }
-            }   
-        }
-        return result;
+        return m_table.remove(key);
     }
 
-	// @brief Collect removed nodes.
-	// @return The number of nodes collected.
-    int CollectRemovedNodes()
+    // @brief Contains operation.
+	// @param key The key to look up.
+	// @return True if the key is in the table.
+    bool Contains(const K& key)
     {
-        int collected = 0;
-        std::lock_guard<std::mutex> lock(m_shadowMutex);
-        for (auto& bucket : m_shadowBuckets) {
-            for (auto it = bucket.begin(); it != bucket.end(); ) 
-            {
-                if (std::get<2>(*it)) 
-                { 
-                    ++collected;
-                    it = bucket.erase(it);
-                }
-                else 
-                {
-                    ++it;
-                }
-            }
-        }
-        m_totalRemoved.fetch_add(collected);
-        return collected;
+        return m_table.contains(key);
     }
 
-	// @brief Get a snapshot of the current state of the shadow buckets.
-	// @return A vector of vectors, where each inner vector contains tuples of (key, value, marked).
-    std::vector<std::vector<std::tuple<K, V, bool>>> GetSnapshot()
+	// @brief Count the nodes of every bucket and copy the nodes of one, read from
+	// the table itself without stopping the workers. Marked nodes are removed
+	// ones not unlinked yet. The buffers keep their capacity between calls.
+	// @param live Receives the unmarked nodes of each bucket.
+	// @param marked Receives the marked nodes of all buckets.
+	// @param selected The bucket to copy, none if it is not below the bucket count.
+	// @param nodes Receives (key, value, marked) of the selected bucket's nodes.
+    void SampleBuckets(std::vector<float>& live, size_t& marked, size_t selected, std::vector<std::tuple<K, V, bool>>& nodes)
     {
-        std::lock_guard<std::mutex> lock(m_shadowMutex);
-        return m_shadowBuckets;
+        m_table.sample_buckets(live, marked, selected, nodes);
     }
 
-	// @brief Clear the shadow copy.
-	// This function clears the shadow copy of the hash table.
-    void ClearShadow()
+	// @brief Get the bucket a key hashes to.
+	// @param key The key.
+	// @param buckets The bucket count of the array, as sampled.
+	// @return The bucket index.
+    size_t GetBucketOf(const K& key, size_t buckets) const
     {
-        std::lock_guard<std::mutex> lock(m_shadowMutex);
-        for (auto& bucket : m_shadowBuckets) 
-        {
-            bucket.clear();
-        }
-        m_totalRemoved.store(0);
+        return m_table.bucket_of(key, buckets);
     }
 
 	// @brief Compute the load factor of active nodes in the hash table.
 	// @return The load factor as a float.
-    float ComputeLoadFactor()
+    float ComputeLoadFactor() const
     {
-        std::lock_guard<std::mutex> lock(m_shadowMutex);
-        int activeNodes = 0;
-        for (const auto& bucket : m_shadowBuckets) 
-        {
-            for (const auto& node : bucket) 
-            {
-                if (!std::get<2>(node))
-                    activeNodes++;
-            }
-        }
-        return (m_numBuckets > 0) ? static_cast<float>(activeNodes) / m_numBuckets : 0.0f;
+        size_t buckets = m_table.getBucketSize();
+        return (buckets > 0) ? static_cast<float>(m_table.getCount()) / buckets : 0.0f;
     }
 
+	// @brief Get the hot keys and buckets of the table.
+	// @param top Number of keys and buckets to return at most.
+	// @return The hot spots, empty unless built with LFHT_ENABLE_STATS.
+	HotSpots<K> GetHotSpots(size_t top) const
+	{
+		return m_table.hot_spots(top);
+	}
+
+	// @brief Get the operation statistics of the table.
+	// @return The counters, all 0 unless built with LFHT_ENABLE_STATS.
+	TableStats GetStats() const
+	{
+		return m_table.stats();
+	}
+
+	// @brief Get the contention counters of every bucket.
+	// @return One entry per bucket of the current array, empty unless built with LFHT_ENABLE_STATS.
+	std::vector<BucketContention> GetBucketContention() const
+	{
+		return m_table.bucket_contention();
+	}
+
+	// @brief Get the number of keys in the table.
+	// @return The element count maintained by the table.
+	size_t GetCount() const
+	{
+		return m_table.getCount();
+	}
+
+	// @brief Get the number of resizes since construction.
+	// @return The number of bucket arrays the table published.
+	size_t GetResizeCount() const
+	{
+		return m_table.getResizeCount();
+	}
+
+	// @brief Get the number of removed nodes waiting for reclamation.
+	// @return The retired count, shared by all tables with the same K and V.
+	size_t GetRetiredCount() const
+	{
+		return m_table.getRetiredCount();
+	}
+
 	// @brief Get the number buckets.
 	// @return The number of buckets.
 	size_t GetBucketCount() const
 	{
-		return m_numBuckets;
+		return m_table.getBucketSize();
 	}
 
 	// @brief Reset the hash table.
@@ -133,44 +118,8 @@ public:
 	void Reset()
 	{
 		m_table.reset();
-		ClearShadow();
-		updateBucketCount();
 	}
 	
 private:
     LockFreeHashTable<K, V> m_table;
-    std::vector<std::vector<std::tuple<K, V, bool>>> m_shadowBuckets;
-    std::mutex m_shadowMutex;
-    std::atomic<int> m_totalRemoved;
-    size_t m_numBuckets;
-
-    // @brief Adjust the number of buckets.
-    // @param newCount The new number of buckets.
-    inline void adjustBucketCount(size_t newCount)
-    {
-        std::lock_guard<std::mutex> lock(m_shadowMutex);
-        std::vector<std::vector<std::tuple<K, V, bool>>> newShadow(newCount);
-        for (const auto& bucket : m_shadowBuckets)
-        {
-            for (const auto& node : bucket)
-            {
-                int key = std::get<0>(node);
-                size_t newBucketIndex = key % newCount;
-                newShadow[newBucketIndex].push_back(node);
-            }
-        }
-        m_shadowBuckets = std::move(newShadow);
-        m_numBuckets = newCount;
-    }
-
-    // @brief Keep track of the number copied buckets.
-    inline void updateBucketCount()
-    {
-        auto bucketSize = m_table.getBucketSize();
-        if (bucketSize != m_numBuckets)
-        {
-            adjustBucketCount(bucketSize);
-        }
-    }
 };
-
@@ -0,0 +1,286 @@
+#pragma once
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <string>
+
+// Key distributions supported by the load generator
+enum class KeyDist
+{
+	Uniform,
+	Zipfian,
+	Hotspot,
+	Sequential,
+	Latest
+};
+
+static const char* KEY_DIST_NAMES[] = { "uniform", "zipfian", "hotspot", "sequential", "latest" };
+
+// Operation types issued by a worker
+enum class OpType
+{
+	Read,
+	Insert,
+	Remove,
+	Update,          // remove followed by insert of the same key
+	ReadModifyWrite  // contains followed by an update
+};
+
+// @brief Parse a key distribution name.
+// @param name One of KEY_DIST_NAMES.
+// @param dist Set to the matching distribution.
+// @return True if the name was known.
+inline bool ParseKeyDist(const std::string& name, KeyDist& dist)
+{
+	for (int i = 0; i < (int)(sizeof(KEY_DIST_NAMES) / sizeof(KEY_DIST_NAMES[0])); ++i)
+	{
+		if (name == KEY_DIST_NAMES[i])
+		{
+			dist = static_cast<KeyDist>(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+// @brief Name of a key distribution.
+inline const char* KeyDistName(KeyDist dist)
+{
+	return KEY_DIST_NAMES[static_cast<int>(dist)];
+}
+
+// @brief 64-bit finalizer from SplitMix64, also used to scramble keys.
+inline uint64_t Mix64(uint64_t x)
+{
+	x += 0x9E3779B97F4A7C15ULL;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+	return x ^ (x >> 31);
+}
+
+// Small per-thread PRNG (xorshift64*), a few cycles per draw.
+// Not for anything but load generation.
+struct FastRng
+{
+	uint64_t state;
+
+	FastRng(uint64_t seed) : state(Mix64(seed) | 1) {}
+
+	uint64_t Next()
+	{
+		state ^= state >> 12;
+		state ^= state << 25;
+		state ^= state >> 27;
+		return state * 0x2545F4914F6CDD1DULL;
+	}
+
+	// Uniform in [0, n) without a division
+	uint64_t NextBelow(uint64_t n)
+	{
+#ifdef __SIZEOF_INT128__
+		return static_cast<uint64_t>((static_cast<unsigned __int128>(Next()) * n) >> 64);
+#else
+		return Next() % n;
+#endif
+	}
+
+	// Uniform in [0, 1)
+	double NextDouble()
+	{
+		return (Next() >> 11) * (1.0 / 9007199254740992.0);
+	}
+};
+
+// Settings describing what the workers do. Percentages must add up to 100.
+struct WorkloadSpec
+{
+	int readPct = 50;
+	int insertPct = 25;
+	int removePct = 25;
+	int updatePct = 0;
+	int rmwPct = 0;
+	KeyDist dist = KeyDist::Uniform;
+	double zipfTheta = 0.99;
+	double hotKeyFraction = 0.2;  // share of the key range that is hot
+	double hotOpFraction = 0.8;   // share of the operations that go to hot keys
+	double prefill = 0.5;         // share of the key range inserted before measuring
+	uint64_t keyOffset = 0;       // added to every generated key, to move the key space
+};
+
+// @brief Apply a YCSB core workload preset (A-F) to a spec.
+// @param name The preset letter.
+// @param spec The spec to modify.
+// @return True if the preset exists.
+// @note E issues scans in YCSB. The table has no range scan, so they are run as lookups.
+inline bool ApplyYcsbPreset(const std::string& name, WorkloadSpec& spec)
+{
+	if (name.size() != 1)
+		return false;
+
+	spec = WorkloadSpec();
+	spec.dist = KeyDist::Zipfian;
+	spec.prefill = 1.0;
+	spec.readPct = spec.insertPct = spec.removePct = spec.updatePct = spec.rmwPct = 0;
+	switch (name[0] | 0x20)
+	{
+	case 'a': spec.readPct = 50; spec.updatePct = 50; break;
+	case 'b': spec.readPct = 95; spec.updatePct = 5; break;
+	case 'c': spec.readPct = 100; break;
+	case 'd': spec.readPct = 95; spec.insertPct = 5; spec.dist = KeyDist::Latest; break;
+	case 'e': spec.readPct = 95; spec.insertPct = 5; break;
+	case 'f': spec.readPct = 50; spec.rmwPct = 50; break;
+	default: return false;
+	}
+	return true;
+}
+
+// Zipfian item generator after Gray et al., "Quickly Generating Billion-Record
+// Synthetic Databases", as used by YCSB. Item 0 is the most popular.
+class ZipfianGenerator
+{
+public:
+	ZipfianGenerator() : m_items(1), m_theta(0.99), m_zetan(1), m_alpha(0), m_eta(0), m_half(0) {}
+
+	ZipfianGenerator(uint64_t items, double theta) : m_items(items), m_theta(theta)
+	{
+		m_zetan = zeta(items, theta);
+		double zeta2 = zeta(2, theta);
+		m_alpha = 1.0 / (1.0 - theta);
+		m_eta = (1.0 - std::pow(2.0 / items, 1.0 - theta)) / (1.0 - zeta2 / m_zetan);
+		m_half = 1.0 + std::pow(0.5, theta);
+	}
+
+	// @brief Draw the next item rank in [0, items).
+	uint64_t Next(FastRng& rng) const
+	{
+		double u = rng.NextDouble();
+		double uz = u * m_zetan;
+		if (uz < 1.0)
+			return 0;
+		if (uz < m_half)
+			return 1;
+		uint64_t item = static_cast<uint64_t>(m_items * std::pow(m_eta * u - m_eta + 1.0, m_alpha));
+		return item < m_items ? item : m_items - 1;
+	}
+
+private:
+	uint64_t m_items;
+	double m_theta;
+	double m_zetan;
+	double m_alpha;
+	double m_eta;
+	double m_half;
+
+	// O(items), only run once per workload
+	static double zeta(uint64_t n, double theta)
+	{
+		double sum = 0.0;
+		for (uint64_t i = 1; i <= n; ++i)
+			sum += 1.0 / std::pow(static_cast<double>(i), theta);
+		return sum;
+	}
+};
+
+// State shared by all workers of one workload: the precomputed Zipfian
+// constants and the insert cursor of the "latest" distribution.
+struct WorkloadShared
+{
+	WorkloadSpec spec;
+	uint64_t keyRange;
+	ZipfianGenerator zipf;
+	std::atomic<uint64_t> latest{ 0 };
+
+	WorkloadShared(const WorkloadSpec& s, uint64_t range) : spec(s), keyRange(range)
+	{
+		if (spec.dist == KeyDist::Zipfian || spec.dist == KeyDist::Latest)
+			zipf = ZipfianGenerator(keyRange, spec.zipfTheta);
+		latest.store(PrefillCount());
+	}
+
+	// @brief Number of keys the prefill phase inserts, keys [0, count).
+	uint64_t PrefillCount() const
+	{
+		double fraction = spec.prefill < 0.0 ? 0.0 : (spec.prefill > 1.0 ? 1.0 : spec.prefill);
+		return static_cast<uint64_t>(fraction * keyRange);
+	}
+};
+
+// Per-thread op and key generator. Keep one per worker.
+class WorkloadGenerator
+{
+public:
+	WorkloadGenerator(WorkloadShared& shared, uint64_t seed, int threadID, int threadCount)
+		: m_shared(shared), m_rng(seed)
+	{
+		const WorkloadSpec& s = shared.spec;
+		m_readEnd = s.readPct;
+		m_insertEnd = m_readEnd + s.insertPct;
+		m_removeEnd = m_insertEnd + s.removePct;
+		m_updateEnd = m_removeEnd + s.updatePct;
+
+		m_hotKeys = static_cast<uint64_t>(shared.keyRange * s.hotKeyFraction);
+		if (m_hotKeys < 1) m_hotKeys = 1;
+		if (m_hotKeys > shared.keyRange) m_hotKeys = shared.keyRange;
+
+		// Sequential workers start evenly spaced over the key range
+		m_cursor = shared.keyRange / threadCount * threadID;
+	}
+
+	// @brief Pick the type of the next operation.
+	OpType NextOp()
+	{
+		int r = static_cast<int>(m_rng.NextBelow(100));
+		if (r < m_readEnd) return OpType::Read;
+		if (r < m_insertEnd) return OpType::Insert;
+		if (r < m_removeEnd) return OpType::Remove;
+		if (r < m_updateEnd) return OpType::Update;
+		return OpType::ReadModifyWrite;
+	}
+
+	// @brief Pick the key of the next operation.
+	// @param op The operation the key is for. Inserts under "latest" create new keys.
+	uint64_t NextKey(OpType op)
+	{
+		return m_shared.spec.keyOffset + nextKey(op);
+	}
+
+private:
+	WorkloadShared& m_shared;
+	FastRng m_rng;
+	int m_readEnd;
+	int m_insertEnd;
+	int m_removeEnd;
+	int m_updateEnd;
+	uint64_t m_hotKeys;
+	uint64_t m_cursor;
+
+	uint64_t nextKey(OpType op)
+	{
+		const uint64_t range = m_shared.keyRange;
+		switch (m_shared.spec.dist)
+		{
+		case KeyDist::Zipfian:
+			// Scrambled so that popular items are spread over the buckets
+			return Mix64(m_shared.zipf.Next(m_rng)) % range;
+		case KeyDist::Hotspot:
+			if (m_rng.NextDouble() < m_shared.spec.hotOpFraction || m_hotKeys == range)
+				return m_rng.NextBelow(m_hotKeys);
+			return m_hotKeys + m_rng.NextBelow(range - m_hotKeys);
+		case KeyDist::Sequential:
+			m_cursor = m_cursor + 1 < range ? m_cursor + 1 : 0;
+			return m_cursor;
+		case KeyDist::Latest:
+		{
+			if (op == OpType::Insert)
+				return m_shared.latest.fetch_add(1, std::memory_order_relaxed);
+			uint64_t latest = m_shared.latest.load(std::memory_order_relaxed);
+			if (latest == 0)
+				return 0;
+			uint64_t back = m_shared.zipf.Next(m_rng) % latest;
+			return latest - 1 - back;
+		}
+		default:
+			return m_rng.NextBelow(range);
+		}
+	}
+};
@@ -1,15 +1,39 @@
 ﻿// main.cpp
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
 #include "UI.hpp"
 
-int main(int, char**)
+// lfht              run the table in this process
+// lfht --attach PID watch the metrics another process publishes (lfht_bench --publish)
+int main(int argc, char** argv)
 {
-	int maxThreads = 16;
+	int maxThreads = 256;
+	int attachPid = 0;
+	if (argc == 3 && std::strcmp(argv[1], "--attach") == 0)
+	{
+		attachPid = std::atoi(argv[2]);
+	}
+	else if (argc > 1)
+	{
+		std::fprintf(stderr, "usage: %s [--attach PID]\n", argv[0]);
+		return -1;
+	}
+
 	UI ui(new TestSettings(maxThreads));
 
 	if (!ui.Init())
 	{
 		return -1;
 	}
+	std::string error;
+	if (attachPid > 0 && !ui.Attach(attachPid, error))
+	{
+		std::fprintf(stderr, "error: %s\n", error.c_str());
+		ui.Cleanup();
+		return -1;
+	}
 	ui.Update();
 	ui.Cleanup();
 	return 0;